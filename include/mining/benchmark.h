@@ -0,0 +1,54 @@
+// benchmark.h
+// microbenchmarks for the hash kernels and the stratum helpers
+//
+// every benchmark runs a few warmup repetitions, then BENCH_REPS timed ones
+// of ops operations each, read off platform_cycles(). results are per
+// operation: the median, the 99th percentile and the fastest repetition.
+// a baseline file ("name cycles" per line, median cycles per operation)
+// turns them into a regression check, the same on the device (littlefs)
+// and on linux (settings dir)
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+#define BENCH_REPS 101                  // timed repetitions, odd so the median is one of them
+#define BENCH_WARMUP_REPS 8             // untimed, fill caches and branch predictors
+#define BENCH_MAX_RESULTS 24
+#define BENCH_BASELINE_PATH "/bench.base"
+#define BENCH_DEFAULT_TOLERANCE 10      // percent over baseline before a benchmark fails
+
+// one benchmark's numbers, cycles are per operation
+struct bench_result_t {
+    const char* name;
+    uint32_t ops;                       // operations per repetition
+    uint32_t reps;
+    float median_cycles;
+    float p99_cycles;
+    float min_cycles;
+    float median_ns;
+    float baseline_cycles;              // 0 = none loaded
+    uint8_t tolerance;                  // percent, noisier benchmarks get more
+    bool regressed;
+};
+
+// run every benchmark whose name contains filter (NULL or "" for all)
+// returns how many results were written
+uint8_t benchmark_run(const char* filter, bench_result_t* results, uint8_t max_results);
+
+// "[bench]" table on serial
+void benchmark_print(const bench_result_t* results, uint8_t count);
+
+// one json object per line, {"bench":...,"median_cyc":...}
+void benchmark_print_json(const bench_result_t* results, uint8_t count);
+
+// fill baseline_cycles from a saved baseline, false if the file is missing
+bool benchmark_load_baseline(const char* path, bench_result_t* results, uint8_t count);
+bool benchmark_save_baseline(const char* path, const bench_result_t* results, uint8_t count);
+
+// mark results slower than baseline + tolerance, returns how many are
+// extra_tolerance widens every benchmark's limit (percent), for noisy hosts
+uint8_t benchmark_check(bench_result_t* results, uint8_t count, uint8_t extra_tolerance);
+
+#endif
@@ -0,0 +1,77 @@
+// dns_cache.h
+// pool hostname cache - reconnects go straight to the last known address
+//
+// a cached address is used right away even when it is old, an old entry only
+// triggers a lookup in the background (lwip async dns). entries are mirrored
+// to nvs so the first connect after boot skips the lookup too. lwip does not
+// expose record ttls, so entries are refreshed after a fixed DNS_CACHE_TTL
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <atomic>
+
+#define DNS_CACHE_SIZE 4                // one per configured pool slot
+#define DNS_CACHE_HOST_SIZE 64
+#define DNS_CACHE_TTL 600000            // ms before an address is looked up again
+#define DNS_CACHE_RECHECK_AGE 60000     // ms, an address older than this is looked up again when it fails
+
+// state of a background lookup, written by the lookup thread
+enum class dns_refresh_t : uint8_t {
+    IDLE,
+    PENDING,        // query sent
+    DONE,           // refresh_ip holds the answer
+    FAILED
+};
+
+struct dns_cache_entry_t {
+    char host[DNS_CACHE_HOST_SIZE];     // "" = free slot
+    uint32_t ip;                        // ipv4, network byte order, 0 = unknown
+    uint32_t resolved_ms;               // millis() of the last answer
+    bool fresh;                         // resolved since boot, false for nvs records
+    std::atomic<uint8_t> refresh;       // dns_refresh_t
+    uint32_t refresh_ip;                // answer, valid once refresh is DONE
+};
+
+class DnsCache {
+public:
+    DnsCache();
+
+    // address for host - cached one right away, blocking lookup only on a miss
+    bool resolve(const char* host, IPAddress& out);
+
+    // connect through the cache, a cached address that stopped answering
+    // is dropped and the name looked up once more before giving up
+    bool connect(Client& client, const char* host, uint16_t port);
+
+    // start a background lookup, the answer lands in the cache
+    void prefetch(const char* host);
+
+    // forget the address of host
+    void invalidate(const char* host);
+
+    // call regularly from the main loop - applies finished background lookups
+    void process();
+
+private:
+    dns_cache_entry_t entries[DNS_CACHE_SIZE];
+    bool loaded;
+    bool dirty;                         // an address changed since the last nvs write
+
+    void load();
+    void save();
+    dns_cache_entry_t* find(const char* host);
+    dns_cache_entry_t* add(const char* host);
+    void store(dns_cache_entry_t* entry, uint32_t ip);
+    void start_refresh(dns_cache_entry_t* entry);
+
+    // runs in the lookup thread
+    static void lookup_done(uint32_t ip, void* arg);
+};
+
+// global instance shared by all work sources
+extern DnsCache dns_cache;
+
+#endif
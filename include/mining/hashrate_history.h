@@ -0,0 +1,75 @@
+// hashrate_history.h
+// fixed-size hashrate time series with ewma estimators
+//
+// keeps per-second hash counts for the last hour and per-minute counts for
+// the last day in static ring buffers, plus 1/5/15 minute ewma hashrates.
+// all storage is sized at compile time, nothing is allocated at runtime
+
+#ifndef HASHRATE_HISTORY_H
+#define HASHRATE_HISTORY_H
+
+#include <Arduino.h>
+
+// ring buffer sizes
+#define HASHRATE_HISTORY_SECONDS 3600   // per-second buckets (1 hour)
+#define HASHRATE_HISTORY_MINUTES 1440   // per-minute buckets (24 hours)
+
+// ewma averaging windows
+enum class hashrate_window_t {
+    EWMA_1M,        // 1 minute ewma
+    EWMA_5M,        // 5 minute ewma
+    EWMA_15M        // 15 minute ewma
+};
+
+class HashrateHistory {
+public:
+    HashrateHistory();
+
+    // clear history and start counting from the given hash total
+    void reset(uint64_t total_hashes, unsigned long now_ms);
+
+    // feed the current monotonic hash total - closes every whole second elapsed
+    // call at least once per second for accurate per-second buckets
+    void update(uint64_t total_hashes, unsigned long now_ms);
+
+    // queries
+    float get_ewma(hashrate_window_t window);       // hashes per second
+    float get_average(uint32_t seconds);            // mean h/s over last n seconds
+    uint32_t get_seconds_recorded();                // how many seconds of history we have
+
+    // copy most recent buckets into out (oldest first, newest last)
+    // returns number of buckets copied (may be less than count)
+    uint16_t get_second_history(uint32_t* out, uint16_t count);
+    uint16_t get_minute_history(uint64_t* out, uint16_t count);
+
+private:
+    // per-second hash counts (ring buffer)
+    uint32_t seconds[HASHRATE_HISTORY_SECONDS];
+    uint16_t second_head;           // index of next slot to write
+    uint16_t second_count;          // valid entries
+    uint32_t seconds_recorded;      // total seconds closed since reset
+
+    // per-minute hash counts (ring buffer), 64-bit - a minute at 72 mh/s
+    // overflows 32 bits
+    uint64_t minutes[HASHRATE_HISTORY_MINUTES];
+    uint16_t minute_head;
+    uint16_t minute_count;
+    uint64_t minute_accum;          // hashes in the minute being filled
+    uint8_t minute_seconds;         // seconds in the minute being filled
+
+    // ewma estimators (hashes per second)
+    float ewma_1m;
+    float ewma_5m;
+    float ewma_15m;
+
+    // open second tracking
+    uint64_t last_total;            // hash total when current second started
+    unsigned long second_start_ms;  // millis() when current second started
+
+    void push_second(uint32_t hashes);
+    template <typename T>
+    uint16_t copy_ring(const T* ring, uint16_t size, uint16_t head, uint16_t valid,
+                       T* out, uint16_t count);
+};
+
+#endif
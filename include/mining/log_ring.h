@@ -0,0 +1,184 @@
+// log_ring.h
+// asynchronous log for hot paths - producers never touch Serial
+//
+// LOG_INFO("[mining] share found! nonce: %X", nonce) copies the format
+// string's address and the raw arguments into a lock-free ring, a low
+// priority task formats and prints them later. when the host stops
+// draining usb cdc only that task blocks: the ring fills, further records
+// are dropped and counted instead of stalling the network loop or a
+// mining worker.
+//
+// the ring is 32-byte slots, a record claims as many consecutive slots as
+// it needs with one compare-and-swap on the head and is published by its
+// first slot's sequence number (bounded mpmc queue, one consumer).
+// arguments are tagged, so formatting does not depend on the caller's
+// integer widths: %d %i %u %x %X %o %c take any integer, %f %e %g any
+// float, %s a string (copied, LOG_MAX_STRING at most) or log_span().
+//
+// cost: about 19 ns per record on the producer side on an x86 host. the
+// firmware's test program (src/main.cpp, test 6) hashes with the ring at off
+// and at debug under pool-like traffic and prints the difference.
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+#define LOG_RING_SLOTS 256              // power of two, 32 bytes each
+#define LOG_SLOT_DATA 28                // record bytes per slot
+#define LOG_MAX_STRING 1024             // longer string arguments are cut
+#define LOG_LINE_SIZE 1280              // formatted line, longer lines are cut
+#define LOG_DRAIN_IDLE_MS 10            // drain task sleep when the ring is empty
+#define LOG_TASK_STACK_SIZE 4096
+#define LOG_TASK_PRIORITY 1             // lowest above idle
+
+enum class log_level_t : uint8_t {
+    OFF = 0,                            // nothing is copied or printed
+    ERROR = 1,
+    WARN = 2,
+    INFO = 3,
+    DEBUG = 4,                          // pool traffic line by line
+};
+
+// what each argument was, so the drain task can format it
+enum class log_arg_t : uint8_t {
+    I32, U32, I64, U64, F64, STR,
+};
+
+// string argument that is not null-terminated (a slice of a buffer)
+struct log_span_t {
+    const char* data;
+    size_t len;
+};
+
+static inline log_span_t log_span(const char* data, size_t len) {
+    log_span_t span = { data, len };
+    return span;
+}
+
+// start the drain task, safe to call more than once
+// records logged before this wait in the ring
+void log_begin();
+
+// records above level are skipped before anything is copied
+void log_set_level(log_level_t level);
+log_level_t log_get_level();
+
+// records lost to a full ring since boot
+uint32_t log_get_dropped();
+
+// wait until the drain task printed everything queued, false on timeout
+bool log_flush(uint32_t timeout_ms);
+
+extern std::atomic<uint8_t> log_level;
+
+static inline bool log_enabled(log_level_t level) {
+    return (uint8_t)level <= log_level.load(std::memory_order_relaxed);
+}
+
+// one record being sized or written into its claimed slots
+class LogWriter {
+public:
+    LogWriter() : size(0), pos(0), offset(0), slots(0), writing(false) {}
+
+    bool reserve(log_level_t level, const char* fmt);   // claims slots for size bytes of arguments
+    void commit();                                      // publishes the record
+
+    void put(const void* data, size_t len) {
+        if (writing) {
+            copy(data, len);
+        } else {
+            size += len;
+        }
+    }
+
+    template <typename T>
+    void put_value(log_arg_t tag, T value) {
+        put(&tag, 1);
+        put(&value, sizeof(value));
+    }
+
+    void put_string(const char* data, size_t len) {
+        log_arg_t tag = log_arg_t::STR;
+        uint16_t n = len > LOG_MAX_STRING ? LOG_MAX_STRING : (uint16_t)len;
+        put(&tag, 1);
+        put(&n, sizeof(n));
+        put(data, n);
+    }
+
+private:
+    uint32_t size;                      // argument bytes
+    uint32_t pos;                       // ring position of the first slot
+    uint32_t offset;                    // bytes written so far, header included
+    uint32_t slots;
+    bool writing;
+
+    void copy(const void* data, size_t len);
+};
+
+// ----- argument packing -----
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value>::type
+log_pack(LogWriter& w, T value) {
+    if (sizeof(T) <= 4) {
+        if (std::is_signed<T>::value) {
+            w.put_value(log_arg_t::I32, (int32_t)value);
+        } else {
+            w.put_value(log_arg_t::U32, (uint32_t)value);
+        }
+    } else if (std::is_signed<T>::value) {
+        w.put_value(log_arg_t::I64, (int64_t)value);
+    } else {
+        w.put_value(log_arg_t::U64, (uint64_t)value);
+    }
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+log_pack(LogWriter& w, T value) {
+    w.put_value(log_arg_t::F64, (double)value);
+}
+
+static inline void log_pack(LogWriter& w, const char* value) {
+    if (value == NULL) {
+        value = "(null)";
+    }
+    w.put_string(value, strlen(value));
+}
+
+static inline void log_pack(LogWriter& w, log_span_t value) {
+    w.put_string(value.data, value.len);
+}
+
+// size the arguments, claim slots, write them, publish
+// (the esp32 toolchain defaults to c++11, so no fold expressions)
+template <typename... Args>
+void log_write(log_level_t level, const char* fmt, const Args&... args) {
+    LogWriter w;
+    int sizing[] = { 0, (log_pack(w, args), 0)... };
+    if (!w.reserve(level, fmt)) {
+        return;
+    }
+    int writing[] = { 0, (log_pack(w, args), 0)... };
+    (void)sizing;
+    (void)writing;
+    w.commit();
+}
+
+// the format must be a string literal, its address is what gets stored
+#define LOG_AT(level, fmt, ...) \
+    do { \
+        if (log_enabled(level)) { \
+            log_write(level, "" fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(fmt, ...) LOG_AT(log_level_t::ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_AT(log_level_t::WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_AT(log_level_t::INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) LOG_AT(log_level_t::DEBUG, fmt, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,111 @@
+// profiler.h
+// scoped cycle timers for the hot paths, collected into log2 histograms
+//
+// PROFILE_SCOPE(ZONE) at the top of a function times it until return, on
+// platform_cycles() (ccount on the esp32, tsc on x86 linux). every zone has
+// a histogram per core (per thread on linux), bucket i counts calls of 2^i
+// to 2^(i+1)-1 cycles. MiningManager::process() and the firmware's loop()
+// print and clear them every PROFILE_REPORT_MS.
+//
+// only built with -DESP32BTCMINER_PROFILE (the *-profile envs), otherwise
+// the macros are empty and none of this ends up in the binary
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// timed code paths, zones may nest (update_work contains merkle_root)
+enum class profile_zone_t : uint8_t {
+    MINE_NONCE_RANGE,   // one batch of a mining worker
+    UPDATE_WORK,        // new job or target handed to the workers
+    MERKLE_ROOT,        // coinbase hash and merkle branches
+    PROCESS_LINE,       // one pool message through the json parser
+    SUBMIT_SHARE,       // share formatted and queued
+    UI_DRAW,            // a config screen's draw()
+    COUNT,
+};
+
+#if defined(ESP32BTCMINER_PROFILE)
+
+#include <atomic>
+#include "platform/platform.h"
+
+#define PROFILE_BUCKETS 32
+#define PROFILE_REPORT_MS 10000
+
+// linux threads are not pinned to a known set of cores, each gets its own
+// row in the order it first records - 64 workers plus the main thread,
+// threads past that share the last row
+#if defined(PLATFORM_NATIVE)
+#define PROFILE_ROWS 66
+#else
+#define PROFILE_ROWS portNUM_PROCESSORS
+#endif
+
+// calls of one zone on one core or thread, updated from any task without locks
+struct profile_histogram_t {
+    std::atomic<uint32_t> buckets[PROFILE_BUCKETS];
+    std::atomic<uint64_t> total_cycles;
+    std::atomic<uint32_t> max_cycles;
+};
+
+extern profile_histogram_t profile_histograms[PROFILE_ROWS][(int)profile_zone_t::COUNT];
+
+#if defined(PLATFORM_NATIVE)
+extern thread_local int profile_thread_row;     // -1 until the thread first records
+int profile_assign_row();
+#endif
+
+// histogram row of the calling task
+static inline int profile_row() {
+#if defined(PLATFORM_NATIVE)
+    return profile_thread_row >= 0 ? profile_thread_row : profile_assign_row();
+#else
+    return xPortGetCoreID();
+#endif
+}
+
+// one timed call - a few relaxed atomic adds
+static inline void profiler_record(profile_zone_t zone, uint32_t cycles) {
+    profile_histogram_t* h = &profile_histograms[profile_row()][(int)zone];
+    int bucket = cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+
+    h->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    h->total_cycles.fetch_add(cycles, std::memory_order_relaxed);
+
+    uint32_t max = h->max_cycles.load(std::memory_order_relaxed);
+    while (cycles > max && !h->max_cycles.compare_exchange_weak(max, cycles, std::memory_order_relaxed)) {
+    }
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(profile_zone_t zone_in) : zone(zone_in), start(platform_cycles()) {}
+    ~ProfileScope() { profiler_record(zone, platform_cycles() - start); }
+
+private:
+    profile_zone_t zone;
+    uint32_t start;
+};
+
+// per zone and core (thread): calls, share of the window, mean, p50, p99 and max
+void profiler_print(uint32_t window_ms);
+void profiler_reset();
+
+// print and reset once PROFILE_REPORT_MS have passed since the last report
+void profiler_report_if_due();
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(profile_zone_t::zone)
+#define PROFILE_REPORT() profiler_report_if_due()
+
+#else
+
+#define PROFILE_SCOPE(zone)
+#define PROFILE_REPORT()
+
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+// seqlock.h
+// single-writer sequence lock for sharing small structs between cores
+//
+// the writer never blocks: it bumps the sequence to odd, writes, then bumps it
+// back to even. readers copy the data and retry if the sequence was odd or
+// changed during the copy, so they always get a tear-free snapshot
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T>
+class SeqLock {
+public:
+    SeqLock() : seq(0) {
+        memset((void*)&data, 0, sizeof(T));
+    }
+
+    // publish a new value - only one task may ever write a given seqlock
+    void write(const T& value) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy((void*)&data, &value, sizeof(T));
+
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // read a consistent copy - spins only while a write is in progress
+    T read() const {
+        T copy;
+        uint32_t before;
+        uint32_t after;
+
+        do {
+            before = seq.load(std::memory_order_acquire);
+            memcpy(&copy, (const void*)&data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        return copy;
+    }
+
+private:
+    std::atomic<uint32_t> seq;  // odd while writer is updating
+    volatile T data;            // protected value
+};
+
+#endif
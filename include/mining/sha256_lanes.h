@@ -0,0 +1,60 @@
+// sha256_lanes.h
+// multi-lane sha256d nonce scanner for x86 linux builds
+//
+// hashes 4 (sse2), 8 (avx2) or 16 (avx512) consecutive nonces of one header
+// per call, every lane shares the midstate of the first 64 header bytes. the
+// second hash stops as soon as the most significant word is known, so a lane
+// only costs a full hash when it can be a share or a new best. the esp32
+// build has none of this, it hashes on the sha peripheral
+
+#ifndef SHA256_LANES_H
+#define SHA256_LANES_H
+
+#include <Arduino.h>
+
+#if defined(PLATFORM_NATIVE) && defined(__x86_64__)
+#define SHA256_LANES_AVAILABLE
+
+// most lanes a scan call hashes
+#define SHA256_LANES_MAX 16
+
+// instruction set a scan runs on, picked once at startup from cpuid
+// ordered, a lower value is always supported when a higher one is
+enum class sha256_lanes_isa_t : uint8_t {
+  NONE,             // scalar sha256d only
+  SSE2,             // 4 lanes, every x86-64 cpu has it
+  AVX2,             // 8 lanes
+  AVX512,           // 16 lanes, native rotates
+};
+
+// best isa this cpu supports, ESP32BTCMINER_LANES=avx512|avx2|sse2|off caps it
+sha256_lanes_isa_t sha256_lanes_detect();
+
+// lanes per scan call (0 for NONE)
+uint8_t sha256_lanes_count(sha256_lanes_isa_t isa);
+
+// short isa name for logs
+const char* sha256_lanes_name(sha256_lanes_isa_t isa);
+
+// midstate and tail words of an 80-byte header, the inputs of the two calls below
+void sha256_lanes_prepare(const uint8_t* header, uint32_t* midstate, uint32_t* tail);
+
+// top word of sha256d(header) for lanes consecutive nonces starting at first_nonce
+//
+// parameters:
+//   midstate: sha256 state after the first 64 header bytes
+//   tail: header words 16-18 (bytes 64-75) read big-endian like sha256 does
+//   first_nonce: nonce of lane 0, lane i hashes first_nonce + i
+//   top_words: output, one per lane, same value as best_share_t::top_word
+void sha256_lanes_scan(sha256_lanes_isa_t isa, const uint32_t* midstate, const uint32_t* tail,
+                       uint32_t first_nonce, uint32_t* top_words);
+
+// full sha256d(header) of every lane, all 64 rounds of the second hash
+// slower than the scan, for checking the kernel bit for bit against sha256d
+// (test/test_sha256_lanes). top_words is filled like the scan fills it
+void sha256_lanes_hash(sha256_lanes_isa_t isa, const uint32_t* midstate, const uint32_t* tail,
+                       uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]);
+
+#endif
+
+#endif
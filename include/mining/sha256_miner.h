@@ -6,6 +6,19 @@
 
 #include <Arduino.h>
 
+// running best hash for mine_nonce_range
+// the hot loop compares only the most significant 32-bit word of each hash
+// against top_word and does a full compare just when that word ties or wins
+struct best_share_t {
+    uint32_t top_word;          // most significant 32 bits of best hash
+    uint8_t hash[32];           // best hash so far (little-endian like targets)
+    uint32_t nonce;             // nonce that produced the best hash
+    bool improved;              // set by mine_nonce_range when it found a better hash
+};
+
+// reset best share tracker to "nothing found yet"
+void best_share_init(best_share_t* best);
+
 // initialize hardware sha256 engine
 // call this once during setup before any mining operations
 void miner_init();
@@ -19,6 +32,23 @@ void miner_init();
 //   output: buffer for result (must be 32 bytes)
 void sha256d(const uint8_t* data, size_t len, uint8_t* output);
 
+// sha256 kernels - a share found with one is re-checked with another before
+// it is submitted, so a faulty kernel cannot get invalid shares to the pool
+enum class sha256_kernel_t : uint8_t {
+  HARDWARE,         // platform_sha256 - esp32 sha peripheral (mbedtls on linux), used by mine_nonce_range
+  SOFTWARE,         // portable c implementation, shares no state with the peripheral
+};
+#define SHA256_KERNEL_COUNT 2
+
+// kernel mine_nonce_range hashes with
+#define MINER_KERNEL sha256_kernel_t::HARDWARE
+
+// double sha256 with a specific kernel
+void sha256d_with(sha256_kernel_t kernel, const uint8_t* data, size_t len, uint8_t* output);
+
+// short kernel name for logs
+const char* sha256_kernel_name(sha256_kernel_t kernel);
+
 // compare hash to target accounting for little-endian byte order
 // returns true if hash < target (valid share found)
 //
@@ -30,8 +60,18 @@ void sha256d(const uint8_t* data, size_t len, uint8_t* output);
 // comparison must start from most significant byte (index 31)
 bool hash_below_target(const uint8_t* hash, const uint8_t* target);
 
+// decode compact nbits into a full 32-byte target (little-endian like hashes)
+// nbits = 1 byte exponent + 3 byte mantissa, target = mantissa * 256^(exponent - 3)
+void nbits_to_target(uint32_t nbits, uint8_t* target_out);
+
+// compute share difficulty of a hash (diff1 target / hash value)
+// this is the figure pools and block explorers report as share difficulty
+double hash_to_difficulty(const uint8_t* hash);
+
 // mine a range of nonces and check for valid shares
 // modifies header bytes 76-79 in place with each nonce
+// x86 linux builds scan with the multi-lane kernel (sha256_lanes.h) once
+// miner_init() has checked it against sha256d
 //
 // parameters:
 //   header: 80-byte block header (will be modified)
@@ -40,6 +80,7 @@ bool hash_below_target(const uint8_t* hash, const uint8_t* target);
 //   target: 32-byte difficulty target
 //   found_nonce: output - set to winning nonce if found
 //   hashes_done: output - set to number of hashes computed
+//   best: optional running best hash, updated in place (NULL to skip)
 //
 // returns:
 //   true if valid share found (found_nonce contains winning value)
@@ -49,6 +90,7 @@ bool mine_nonce_range(uint8_t* header,
                       uint32_t nonce_count,
                       const uint8_t* target,
                       uint32_t* found_nonce,
-                      uint32_t* hashes_done);
+                      uint32_t* hashes_done,
+                      best_share_t* best);
 
 #endif
\ No newline at end of file
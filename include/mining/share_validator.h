@@ -0,0 +1,87 @@
+// share_validator.h
+// statistical check of reported hashrate against shares found and accepted
+//
+// every hash has a 1 / (difficulty * 2^32) chance of meeting the pool target,
+// so hashes done predict how many shares we should see. share counts are
+// poisson distributed, which gives a confidence bound on the hashrate the
+// pool is actually crediting. a broken kernel or header builder shows up as
+// a healthy reported hashrate with an effective hashrate far below it
+
+#ifndef SHARE_VALIDATOR_H
+#define SHARE_VALIDATOR_H
+
+#include <Arduino.h>
+
+// sliding window configuration
+#define SHARE_VALIDATOR_BUCKET_SECONDS 60   // width of one bucket
+#define SHARE_VALIDATOR_BUCKETS 60          // buckets kept (1 hour)
+#define SHARE_VALIDATOR_SHORT_WINDOW 15     // short window in buckets (15 minutes)
+
+// one-sided significance level for flagging a hashrate as suspect
+#define SHARE_VALIDATOR_ALPHA 0.001
+
+// how often the poisson bounds are re-evaluated (milliseconds)
+#define SHARE_VALIDATOR_EVAL_INTERVAL 10000
+
+// validation result for the long window, flags cover both windows
+struct share_validation_t {
+    float reported_hashrate;        // h/s derived from hashes done
+    float effective_hashrate;       // h/s derived from accepted share difficulty
+    float effective_hashrate_upper; // upper confidence bound on effective hashrate
+    double expected_shares;         // shares predicted from hashes and difficulty
+    uint32_t shares_found;          // shares our kernel reported
+    uint32_t shares_accepted;       // shares the pool accepted
+    uint32_t window_seconds;        // time covered by the long window
+    bool kernel_suspect;            // found shares far below expectation
+    bool hashrate_suspect;          // accepted shares far below expectation
+};
+
+// accumulated counts for one bucket
+struct share_bucket_t {
+    uint64_t hashes;                // hashes done
+    double expected;                // expected shares at the difficulty in effect
+    uint32_t found;                 // shares found locally
+    uint32_t accepted;              // shares accepted by pool
+    double accepted_work;           // sum of difficulty over accepted shares
+};
+
+class ShareValidator {
+public:
+    ShareValidator();
+
+    // clear all windows and start from the given monotonic counters
+    void reset(uint64_t total_hashes, uint32_t found, uint32_t accepted,
+               double accepted_work, unsigned long now_ms);
+
+    // feed monotonic counters and the pool difficulty currently in effect
+    void update(uint64_t total_hashes, uint32_t found, uint32_t accepted,
+                double accepted_work, double difficulty, unsigned long now_ms);
+
+    // latest evaluation result
+    share_validation_t get_result();
+
+private:
+    share_bucket_t buckets[SHARE_VALIDATOR_BUCKETS];
+    uint16_t bucket_head;           // bucket currently being filled
+    uint16_t bucket_count;          // closed buckets available
+    unsigned long bucket_start_ms;  // when the open bucket started
+
+    // counters at last update
+    uint64_t last_hashes;
+    uint32_t last_found;
+    uint32_t last_accepted;
+    double last_accepted_work;
+
+    unsigned long last_eval_ms;
+    share_validation_t result;
+
+    void evaluate(unsigned long now_ms);
+    void sum_window(uint16_t closed_buckets, share_bucket_t* sum_out);
+    bool is_suspect(uint32_t observed, double expected);
+
+    // poisson helpers
+    static double poisson_cdf(uint32_t k, double lambda);
+    static double poisson_upper_bound(uint32_t k, double alpha);
+};
+
+#endif
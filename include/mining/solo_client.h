@@ -0,0 +1,155 @@
+// solo_client.h
+// solo mining work source built from a local node's getblocktemplate
+//
+// talks json-rpc over plain http to bitcoind (or a regtest / stand-in server),
+// builds the coinbase paying our wallet, the merkle path and the header locally,
+// and hands found blocks back with submitblock
+
+#ifndef SOLO_CLIENT_H
+#define SOLO_CLIENT_H
+
+#include <Arduino.h>
+#include "platform/platform.h"
+#include <ArduinoJson.h>
+#include "work_source.h"
+#include "stratum_client.h"
+
+// template limits
+#define SOLO_MAX_TRANSACTIONS 4096          // txids kept for the merkle path (psram)
+#define SOLO_TEMPLATE_DOC_SIZE (1024 * 1024)// json document holding template incl. tx data (psram)
+#define SOLO_COINBASE_MAX 256               // max serialized coinbase size
+#define SOLO_SCRIPT_MAX 64                  // max output script size
+#define SOLO_EXTRANONCE1_SIZE 4             // random per-boot part of coinbase extranonce
+#define SOLO_EXTRANONCE2_SIZE 4             // rolling part of coinbase extranonce
+
+// timing
+#define SOLO_RPC_TIMEOUT_MS 10000           // http request timeout
+#define SOLO_TIP_POLL_INTERVAL 5000         // getbestblockhash poll (milliseconds)
+#define SOLO_TEMPLATE_REFRESH_INTERVAL 30000// refresh template for new transactions
+
+// json document allocated in psram - templates are far too big for internal ram
+struct SpiRamAllocator {
+    void* allocate(size_t size);
+    void deallocate(void* pointer);
+    void* reallocate(void* ptr, size_t new_size);
+};
+typedef BasicJsonDocument<SpiRamAllocator> SpiRamJsonDocument;
+
+class SoloClient : public WorkSource {
+public:
+    SoloClient();
+
+    // node credentials and payout address - set before connect()
+    void set_rpc_auth(const char* user, const char* password);
+    bool set_payout_address(const char* address);      // decodes address to output script
+
+    // connection management (http is per request, "connected" = node reachable)
+    bool connect(const char* host, uint16_t port);
+    void disconnect();
+    bool is_connected();
+
+    // polls the node for a new tip and refreshes the template
+    void process();
+
+    // work management
+    bool has_work();
+    uint32_t get_work_sequence();
+    void build_block_header(uint8_t* header_out);
+    void get_target(uint8_t* target_out);               // solo: share target is the network target
+    void get_network_target(uint8_t* target_out);
+    const char* get_current_job_id();
+    uint32_t get_current_ntime();
+    uint32_t get_current_extranonce2();
+    uint32_t get_current_nbits();
+    bool roll_extranonce2();
+
+    // block submission - job id must match the current template
+    bool submit_share(const char* job_id, uint32_t extranonce2, uint32_t ntime, uint32_t nonce);
+    uint32_t get_last_submit_id();
+    bool is_submit_pending(uint32_t id);                // submitblock is synchronous, never pending
+
+    // stats
+    uint32_t get_shares_accepted();                     // blocks accepted by node
+    uint32_t get_shares_rejected();                     // blocks rejected by node
+    double get_difficulty();                            // network difficulty
+    double get_accepted_difficulty();
+
+private:
+    // node connection
+    char host[64];
+    uint16_t port;
+    char auth_header[128];              // "Basic <base64>" or empty
+    bool node_reachable;
+
+    // payout
+    uint8_t payout_script[SOLO_SCRIPT_MAX];
+    uint8_t payout_script_len;
+
+    // current template
+    SpiRamJsonDocument* template_doc;   // keeps raw tx data alive for submitblock
+    bool template_valid;
+    bool include_transactions;          // cleared while refetching a template too big for the document (fees only)
+    char job_id[16];                    // template counter as hex, identifies the work
+    uint32_t template_counter;
+    uint32_t height;
+    uint32_t version;
+    uint8_t prev_hash[32];              // internal byte order (as in header)
+    uint32_t nbits;
+    uint32_t curtime;
+    uint8_t network_target[32];
+    uint64_t coinbase_value;            // payout, without the fees of transactions left out
+    uint8_t witness_commitment[SOLO_SCRIPT_MAX];    // output script from template
+    uint8_t witness_commitment_len;
+    char best_block_hash[65];           // tip the template builds on (hex, display order)
+
+    // transactions (psram), in template order, excluding coinbase
+    uint8_t (*txids)[32];
+    uint16_t tx_count;
+
+    // coinbase split around the extranonce, rebuilt once per template
+    uint8_t coinbase1[SOLO_COINBASE_MAX];
+    uint16_t coinbase1_len;
+    uint8_t coinbase2[SOLO_COINBASE_MAX];
+    uint16_t coinbase2_len;
+    uint8_t extranonce1[SOLO_EXTRANONCE1_SIZE];
+    uint32_t extranonce2_counter;
+
+    // cached merkle path for the coinbase (index 0) - extranonce changes only
+    // re-hash the coinbase and walk this path, never the whole tx list
+    uint8_t merkle_branches[STRATUM_MAX_MERKLE_BRANCHES][32];
+    uint8_t merkle_branch_count;
+
+    uint32_t work_sequence;
+    unsigned long last_tip_poll;
+    unsigned long last_template_fetch;
+
+    // stats
+    uint32_t submit_counter;
+    uint32_t blocks_accepted;
+    uint32_t blocks_rejected;
+
+    // rpc
+    bool open_rpc(TcpClient& client, const char* method, const char* params, size_t extra_len);
+    bool skip_http_headers(TcpClient& client);
+    bool fetch_template();
+    bool poll_tip(bool* changed);
+
+    // work construction
+    bool load_template(JsonObject result);
+    void build_coinbase();
+    void compute_merkle_branches();
+    void compute_merkle_root(uint32_t extranonce2, uint8_t* merkle_root_out);
+    size_t serialize_coinbase(uint32_t extranonce2, bool with_witness, uint8_t* out);
+
+    // helpers
+    static bool decode_address(const char* address, uint8_t* script_out, uint8_t* script_len_out);
+    static bool decode_bech32(const char* address, uint8_t* script_out, uint8_t* script_len_out);
+    static bool decode_base58check(const char* address, uint8_t* script_out, uint8_t* script_len_out);
+    static size_t write_varint(uint8_t* out, uint64_t value);
+    static size_t write_height_push(uint8_t* out, uint32_t height);
+    static void base64_encode(const uint8_t* data, size_t len, char* out);
+    static bool hex_to_bytes(const char* hex, uint8_t* bytes, size_t byte_len);
+    static void write_hex(TcpClient& client, const uint8_t* bytes, size_t len);
+};
+
+#endif
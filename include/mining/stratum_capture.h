@@ -0,0 +1,115 @@
+// stratum_capture.h
+// records the pool session of a StratumClient and plays it back through the parser
+//
+// capture format: "SCAP" and a version byte, then one record per line or event
+//   kind (1 byte) | microseconds since the previous record (varint) | length (varint) | bytes
+// varints are 7 bits per byte, low bits first, high bit set on all but the last.
+// a typical notify costs 4 bytes on top of its text, so a session fits on littlefs.
+// serial captures print every record as a "[capture] <hex>" line, a saved serial
+// log replays the same way as a capture file
+
+#ifndef STRATUM_CAPTURE_H
+#define STRATUM_CAPTURE_H
+
+#include <Arduino.h>
+#include "platform/platform.h"
+
+#define STRATUM_CAPTURE_VERSION 1
+#define STRATUM_CAPTURE_MAX_RECORD 1024     // longer lines are cut, stratum lines never are
+#define STRATUM_CAPTURE_MAX_BYTES 524288    // file capture stops here, keeps littlefs usable
+#define STRATUM_CAPTURE_PATH "/stratum.cap"
+
+class StratumClient;
+
+// what a record holds
+enum class capture_kind_t : uint8_t {
+    RECEIVED = 0,       // line from the pool, without the newline
+    SENT = 1,           // line to the pool, without the newline
+    CONNECTED = 2,      // transport connected, data is "host:port"
+    DISCONNECTED = 3,   // transport closed, no data
+};
+
+// where a capture goes
+enum class capture_mode_t : uint8_t {
+    OFF = 0,
+    SERIAL_LOG = 1,     // hex lines mixed into the normal log
+    FILE_LOG = 2,       // binary file STRATUM_CAPTURE_PATH
+};
+
+class StratumCapture {
+public:
+    StratumCapture();
+
+    bool begin(capture_mode_t mode, const char* path);  // starts a new capture, false if the file fails
+    void end();
+    bool is_active();
+    capture_mode_t get_mode();
+    uint32_t get_bytes();                   // bytes written so far
+
+    // one record, timestamped now
+    void record(capture_kind_t kind, const char* data, size_t len);
+    void flush();                           // file captures only, called on disconnect
+
+private:
+    capture_mode_t mode;
+    PlatformFile file;
+    uint32_t last_us;                       // micros() of the previous record
+    uint32_t bytes;
+
+    void emit(const uint8_t* data, size_t len);
+};
+
+// one record read back from a capture
+struct capture_record_t {
+    capture_kind_t kind;
+    uint32_t delta_us;                      // time since the previous record
+    uint16_t len;
+    char data[STRATUM_CAPTURE_MAX_RECORD + 1];  // null-terminated
+};
+
+class StratumReplay {
+public:
+    StratumReplay();
+
+    bool open(const char* path);            // capture file or saved serial log
+    bool next(capture_record_t* record);    // false at the end or on a damaged record
+    void close();
+
+private:
+    PlatformFile file;
+    bool text;                              // serial log, records come from "[capture]" lines
+
+    // serial log line decoded to bytes
+    uint8_t decoded[STRATUM_CAPTURE_MAX_RECORD + 16];
+    uint16_t decoded_len;
+    uint16_t decoded_pos;
+
+    // first bytes read while telling the formats apart
+    uint8_t pushback[8];
+    uint8_t pushback_len;
+    uint8_t pushback_pos;
+
+    int read_raw();
+    int read_byte();
+    bool read_varint(uint32_t* value);
+    bool next_text_line();
+};
+
+// replay timings, lines are the received lines fed to the parser
+struct replay_stats_t {
+    uint32_t lines;
+    uint32_t notifies;
+    uint32_t sessions;                      // connect records seen
+    uint32_t skipped;                       // sent lines, not replayed
+    uint64_t parse_us;                      // all received lines
+    uint32_t parse_max_us;
+    uint64_t switch_us;                     // notify lines plus the header built for the new job
+    uint32_t switch_max_us;
+    uint32_t elapsed_ms;                    // whole replay, including realtime waits
+};
+
+// feed every received line of a capture to client.replay_line()
+// realtime keeps the original gaps between lines, otherwise lines go back to back
+bool stratum_replay_run(StratumClient& client, const char* path, bool realtime, replay_stats_t* stats);
+
+#endif
@@ -5,28 +5,53 @@
 #define STRATUM_CLIENT_H
 
 #include <Arduino.h>
-#include <WiFiClient.h>
+#include "platform/platform.h"
+#include "work_source.h"
+#include "tls_client.h"
+#include "stratum_capture.h"
 
 // buffer sizes for stratum communication
 #define STRATUM_RECV_BUFFER_SIZE 1024   // incoming message buffer
 #define STRATUM_MAX_MERKLE_BRANCHES 16  // max merkle tree depth
+#define STRATUM_MAX_PENDING_SUBMITS 32  // submits awaiting a pool response, more than the share backlog holds
+#define STRATUM_SEND_BUFFER_SIZE 1024   // outbound messages coalesced into one segment
+#define STRATUM_SEND_FLUSH_MS 20        // longest a queued submit waits for a flush
+#define STRATUM_ERROR_DUPLICATE 22      // mining.submit error code for a share the pool already has
+#define STRATUM_MAX_EXTRANONCE2_SIZE 8  // larger extranonce2_size from a pool is refused at subscribe
 
 // job data received from pool via mining.notify
 struct stratum_job_t {
     char job_id[64];                    // pool's identifier for this job
-    uint8_t prev_hash[32];              // hash of previous block
+    uint8_t prev_hash[32];              // hash of previous block (header order)
     char coinbase1[256];                // first part of coinbase transaction (hex)
     char coinbase2[128];                // second part of coinbase transaction (hex)
     uint8_t merkle_branches[STRATUM_MAX_MERKLE_BRANCHES][32];  // merkle tree branches
     uint8_t merkle_branch_count;        // how many branches we received
     uint32_t version;                   // block version
     uint32_t nbits;                     // difficulty bits (compact format)
+    uint8_t network_target[32];         // block target decoded from nbits (little-endian)
     uint32_t ntime;                     // block timestamp
     bool clean_jobs;                    // if true, discard previous work
     bool valid;                         // true if we have received work
 };
 
-class StratumClient {
+// submit awaiting pool response - remembers difficulty the share was worth
+struct pending_submit_t {
+    uint32_t id;                        // json-rpc message id (0 = free slot)
+    double difficulty;                  // pool difficulty when submitted
+    uint32_t submitted_ms;              // millis() when it was queued
+};
+
+// receives pool traffic that belongs to downstream miners (see StratumProxy)
+class StratumRelay {
+public:
+    virtual ~StratumRelay() {}
+    virtual void relay_notify(const char* line) = 0;            // raw mining.notify line
+    virtual void relay_set_difficulty(const char* line) = 0;    // raw mining.set_difficulty line
+    virtual bool relay_submit_response(uint32_t id, bool accepted) = 0;  // true if id was relayed
+};
+
+class StratumClient : public WorkSource {
 public:
     StratumClient();
     
@@ -34,11 +59,19 @@ public:
     bool connect(const char* host, uint16_t port);
     void disconnect();
     bool is_connected();
+    void set_tls(bool enabled);                    // tls transport for the next connect
+    bool is_tls();
+    TlsClient* get_tls_client();                   // handshake stats
     
     // stratum protocol methods
     bool subscribe();
     bool authorize(const char* wallet_address, const char* worker_name);
-    bool submit_share(const char* job_id, uint32_t ntime, uint32_t nonce);
+    bool submit_share(const char* job_id, uint32_t extranonce2, uint32_t ntime, uint32_t nonce);
+    uint32_t submit_relayed(const char* job_id, const char* extranonce2_hex,
+                            const char* ntime_hex, const char* nonce_hex);  // returns message id, 0 on failure
+    uint32_t get_last_submit_id();                 // message id of last submit sent
+    bool is_submit_pending(uint32_t id);           // true until pool answers that submit
+    void flush();                                  // write queued submits as one segment
     
     // work management
     bool has_work();
@@ -46,6 +79,26 @@ public:
     void get_target(uint8_t* target_out);          // returns 32-byte difficulty target
     const char* get_current_job_id();              // returns job_id for share submission
     uint32_t get_current_ntime();                  // returns ntime for share submission
+    uint32_t get_current_extranonce2();            // extranonce2 used by build_block_header
+    uint32_t get_current_nbits();                  // network difficulty bits of current job
+    bool roll_extranonce2();                       // next extranonce2 for the current job
+    const char* get_session_id();                  // extranonce1, kept when the pool resumes our session
+    void get_network_target(uint8_t* target_out);  // 32-byte block target of current job
+    uint32_t get_work_sequence();                  // bumps on new job or difficulty change
+    
+    // extranonce space sharing
+    const char* get_extranonce1();                 // hex string from pool, empty before subscribe
+    uint32_t get_connection_count();               // bumps on every successful connect
+    uint8_t get_extranonce2_size();                // bytes of extranonce2 the pool expects
+    void set_extranonce2_prefix(bool enabled, uint8_t prefix);  // reserve first extranonce2 byte
+    void set_extranonce2_partition(bool enabled, uint16_t device_id);  // reserve last two bytes
+    bool is_extranonce2_partitioned();             // partition fits the pool's extranonce2 size
+    void set_relay(StratumRelay* relay);           // forward downstream traffic, NULL to stop
+    
+    // session capture and replay (see stratum_capture.h)
+    void set_capture(StratumCapture* capture);     // record every line and connect, NULL to stop
+    void replay_line(const char* line);            // handle a captured pool line as if it just arrived
+    void set_quiet(bool enabled);                  // no per-line logs, serial output would dominate timings
     
     // call regularly to process incoming pool messages
     void process();
@@ -53,50 +106,104 @@ public:
     // stats
     uint32_t get_shares_accepted();
     uint32_t get_shares_rejected();
+    uint32_t get_shares_duplicate();        // rejected because the pool already had them
+    uint32_t get_submits_evicted();         // unanswered submits forgotten for lack of pending slots
+    double get_difficulty();                // current pool difficulty
+    double get_accepted_difficulty();       // sum of difficulty over accepted shares
+    uint32_t get_submit_latency_ms();       // submit to pool answer, smoothed over the last few shares
     
 private:
-    WiFiClient tcp_client;              // tcp socket connection
+    TcpClient tcp_client;               // plain tcp connection
+    TlsClient tls_client;               // tls connection, keeps its session across reconnects
+    Client* transport;                  // one of the two, picked on connect
+    bool tls_enabled;
     
     // receive buffer for incoming data
     char recv_buffer[STRATUM_RECV_BUFFER_SIZE];
     uint16_t recv_buffer_pos;
     
+    // outbound buffer - submits queue here and go out together on flush
+    char send_buffer[STRATUM_SEND_BUFFER_SIZE];
+    uint16_t send_buffer_pos;
+    uint32_t send_queued_ms;            // millis() when the oldest queued message was added
+    
+    // subscription id from the pool, offered on reconnect to resume the session
+    char subscription_id[32];
+    char subscription_host[64];         // pool that issued it
+    
     // extranonce values assigned by pool
     char extranonce1[32];               // hex string from pool
     uint8_t extranonce1_bytes[16];      // binary version
     uint8_t extranonce1_len;            // length in bytes
     uint8_t extranonce2_len;            // length we must fill
     uint32_t extranonce2_counter;       // we increment this for each job
+    uint32_t job_extranonce2_start;     // counter value the current job started with
+    bool extranonce2_prefix_enabled;    // first extranonce2 byte is fixed
+    uint8_t extranonce2_prefix;         // value of that byte
+    bool extranonce2_partition_enabled; // last two extranonce2 bytes carry the device id
+    uint16_t extranonce2_partition;     // device id written there
+    
+    // downstream relay (proxy mode)
+    StratumRelay* relay;
+    
+    // session recorder, NULL when not capturing
+    StratumCapture* capture;
+    bool quiet;                         // per-line logging off
     
     // current job from pool
     stratum_job_t current_job;
+    uint32_t work_sequence;             // bumped whenever header or target inputs change
+    
+    // full worker name sent in authorize, reused for submits
+    char worker_full[128];
     
     // difficulty target
     double current_difficulty;
     uint8_t target[32];                 // 32-byte target computed from difficulty
     
-    // message id counter for json-rpc
+    // message id counter for json-rpc, never reset so an answer from an old
+    // connection can't be matched to a request of the current one
     uint32_t message_id;
+    uint32_t connection_count;
+    uint32_t authorize_id;              // id of pending mining.authorize request
+    uint32_t last_submit_id;            // id of most recent mining.submit
+    
+    // submits awaiting response, matched by message id
+    pending_submit_t pending_submits[STRATUM_MAX_PENDING_SUBMITS];
     
     // stats counters
     uint32_t shares_accepted;
     uint32_t shares_rejected;
+    uint32_t shares_duplicate;
+    uint32_t submits_evicted;
+    double accepted_difficulty;         // sum of difficulty credited by pool
+    uint32_t submit_latency_ms;         // ewma of submit round trips, 0 = none answered yet
     
     // internal methods
     bool send_message(const char* message);
+    bool queue_submit(uint32_t id, const char* job_id, const char* extranonce2_hex,
+                      const char* ntime_hex, const char* nonce_hex);
+    void append_raw(const char* str);
+    void append_json_string(const char* str);
     void process_line(const char* line);
     void handle_subscribe_response(const char* result);
     void handle_authorize_response(bool success);
-    void handle_submit_response(bool accepted);
+    void handle_submit_response(uint32_t id, bool accepted, int error_code);
+    pending_submit_t* claim_pending_submit();
+    pending_submit_t* find_pending_submit(uint32_t id);
     void handle_notify(const char* params);
     void handle_set_difficulty(double difficulty);
     
     // helper functions
     void compute_merkle_root(uint8_t* merkle_root_out);
+    void write_extranonce2(uint32_t value, uint8_t* out);
     void difficulty_to_target(double difficulty, uint8_t* target_out);
     void hex_to_bytes(const char* hex, uint8_t* bytes, size_t byte_len);
     void bytes_to_hex(const uint8_t* bytes, size_t byte_len, char* hex_out);
     void reverse_bytes(uint8_t* data, size_t len);
+    
+    // microbenchmarks time the helpers above directly
+    friend class StratumBenchmark;
 };
 
 #endif
\ No newline at end of file
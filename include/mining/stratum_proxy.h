@@ -0,0 +1,105 @@
+// stratum_proxy.h
+// lan stratum proxy - serves downstream miners over our single pool session
+//
+// each downstream miner gets its own slice of our extranonce2 space: the
+// first extranonce2 byte becomes part of its extranonce1, so it sees
+// extranonce1 = pool extranonce1 + slot byte and one byte less of extranonce2.
+// we keep slot byte 0 for our own mining. jobs and difficulty are relayed
+// verbatim, submits go upstream with the slot byte put back in front
+
+#ifndef STRATUM_PROXY_H
+#define STRATUM_PROXY_H
+
+#include <Arduino.h>
+#include "platform/platform.h"
+#include <ArduinoJson.h>
+#include "stratum_client.h"
+
+// lwip on the esp32 defaults to 10 sockets in total, the pool connection
+// and the listening socket take two of them
+#define STRATUM_PROXY_MAX_CLIENTS 8
+#define STRATUM_PROXY_DEFAULT_PORT 3333
+#define STRATUM_PROXY_RECV_BUFFER_SIZE 512     // downstream requests are short
+#define STRATUM_PROXY_MAX_PENDING 32            // relayed submits awaiting the pool
+#define STRATUM_PROXY_NOTIFY_SIZE STRATUM_RECV_BUFFER_SIZE
+
+// downstream connection
+struct proxy_client_t {
+    TcpClient tcp;
+    char recv_buffer[STRATUM_PROXY_RECV_BUFFER_SIZE];
+    uint16_t recv_buffer_pos;
+    uint32_t session;                   // bumped per connection, stale responses are dropped
+    bool subscribed;
+    bool authorized;
+    uint32_t shares_accepted;
+    uint32_t shares_rejected;
+};
+
+// relayed submit awaiting the pool's answer
+struct proxy_submit_t {
+    uint32_t upstream_id;               // message id we sent to the pool (0 = free)
+    uint32_t downstream_id;             // id the downstream miner used
+    uint8_t slot;                       // downstream client index
+    uint32_t session;                   // client session the submit belongs to
+};
+
+class StratumProxy : public StratumRelay {
+public:
+    StratumProxy(StratumClient* upstream);
+
+    // listen for downstream miners
+    bool begin(uint16_t port);
+    void end();
+    bool is_running();
+
+    // call regularly from main loop, after the upstream client processed
+    void process();
+
+    // stats
+    uint8_t get_client_count();
+    uint32_t get_shares_relayed();
+    uint32_t get_shares_accepted();
+    uint32_t get_shares_rejected();
+
+    // StratumRelay - called by the upstream client
+    void relay_notify(const char* line);
+    void relay_set_difficulty(const char* line);
+    bool relay_submit_response(uint32_t id, bool accepted);
+
+private:
+    StratumClient* upstream;
+    TcpServer* server;
+    bool running;
+
+    proxy_client_t clients[STRATUM_PROXY_MAX_CLIENTS];
+    uint32_t next_session;
+
+    // extranonce1 downstream miners were handed - they must reconnect if it changes
+    char session_extranonce1[32];
+    uint32_t upstream_connection;       // upstream connection count the pending submits belong to
+
+    // latest pool messages, replayed to new subscribers
+    char last_notify[STRATUM_PROXY_NOTIFY_SIZE];
+    char last_difficulty[128];
+
+    proxy_submit_t pending[STRATUM_PROXY_MAX_PENDING];
+    uint8_t pending_head;
+
+    // stats
+    uint32_t shares_relayed;
+    uint32_t shares_accepted;
+    uint32_t shares_rejected;
+
+    // internal methods
+    void accept_clients();
+    void check_upstream_session();
+    void read_client(uint8_t slot);
+    void process_line(uint8_t slot, const char* line);
+    void handle_subscribe(uint8_t slot, uint32_t id);
+    void handle_submit(uint8_t slot, uint32_t id, JsonArray params);
+    void send_result(uint8_t slot, uint32_t id, bool result, const char* error);
+    void send_line(uint8_t slot, const char* line);
+    void drop_client(uint8_t slot);
+};
+
+#endif
@@ -0,0 +1,163 @@
+// sv2_client.h
+// stratum v2 mining protocol client (standard channel, header-only work)
+//
+// the pool sends version, prev hash, merkle root, ntime and nbits as binary
+// fields, so there is no coinbase, merkle path or json on the device.
+// connections are unencrypted (local pools and test servers), the noise
+// handshake is not implemented
+
+#ifndef SV2_CLIENT_H
+#define SV2_CLIENT_H
+
+#include <Arduino.h>
+#include "platform/platform.h"
+#include "work_source.h"
+
+// frame layout: extension_type u16 | msg_type u8 | msg_length u24 | payload
+#define SV2_FRAME_HEADER_SIZE 6
+#define SV2_MAX_PAYLOAD 256                 // largest message we accept from the pool
+#define SV2_CHANNEL_MSG_BIT 0x8000          // extension_type flag for channel messages
+
+// mining protocol message types
+#define SV2_MSG_SETUP_CONNECTION 0x00
+#define SV2_MSG_SETUP_CONNECTION_SUCCESS 0x01
+#define SV2_MSG_SETUP_CONNECTION_ERROR 0x02
+#define SV2_MSG_OPEN_STANDARD_CHANNEL 0x10
+#define SV2_MSG_OPEN_STANDARD_CHANNEL_SUCCESS 0x11
+#define SV2_MSG_OPEN_CHANNEL_ERROR 0x12
+#define SV2_MSG_NEW_MINING_JOB 0x15
+#define SV2_MSG_SUBMIT_SHARES_STANDARD 0x1a
+#define SV2_MSG_SUBMIT_SHARES_SUCCESS 0x1c
+#define SV2_MSG_SUBMIT_SHARES_ERROR 0x1d
+#define SV2_MSG_SET_NEW_PREV_HASH 0x20
+#define SV2_MSG_SET_TARGET 0x21
+
+#define SV2_PROTOCOL_MINING 0
+#define SV2_PROTOCOL_VERSION 2
+#define SV2_SETUP_REQUIRES_STANDARD_JOBS 0x01
+
+#define SV2_MAX_JOBS 4                      // future jobs kept until their prev hash arrives
+#define SV2_MAX_PENDING_SUBMITS 32          // submits awaiting acknowledgement, more than the share backlog holds
+
+// header-only job from NewMiningJob
+struct sv2_job_t {
+    uint32_t job_id;
+    bool valid;
+    bool future;                            // waits for SetNewPrevHash with this job id
+    uint32_t version;
+    uint8_t merkle_root[32];
+    uint32_t min_ntime;
+};
+
+// submit awaiting acknowledgement
+struct sv2_pending_submit_t {
+    uint32_t sequence;                      // 0 = free slot
+    double difficulty;                      // channel difficulty when submitted
+};
+
+class Sv2Client : public WorkSource {
+public:
+    Sv2Client();
+
+    // identity for OpenStandardMiningChannel, set before connect()
+    void set_user_identity(const char* wallet_address, const char* worker_name);
+
+    // connection management - connect() sends SetupConnection and opens the channel
+    bool connect(const char* host, uint16_t port);
+    void disconnect();
+    bool is_connected();
+    bool is_channel_open();
+
+    // call regularly to process incoming frames
+    void process();
+
+    // work management
+    bool has_work();
+    uint32_t get_work_sequence();
+    void build_block_header(uint8_t* header_out);
+    void get_target(uint8_t* target_out);
+    void get_network_target(uint8_t* target_out);
+    const char* get_current_job_id();
+    uint32_t get_current_ntime();
+    uint32_t get_current_extranonce2();     // always 0, standard channels have no extranonce
+    uint32_t get_current_nbits();
+    const char* get_session_id();           // new per connection, channel jobs do not carry over
+
+    // share submission - SubmitSharesStandard
+    bool submit_share(const char* job_id, uint32_t extranonce2, uint32_t ntime, uint32_t nonce);
+    uint32_t get_last_submit_id();          // sequence number of last submit
+    bool is_submit_pending(uint32_t id);
+
+    // stats
+    uint32_t get_shares_accepted();
+    uint32_t get_shares_rejected();
+    uint32_t get_submits_evicted();         // unanswered submits overwritten by newer ones
+    double get_difficulty();
+    double get_accepted_difficulty();
+
+private:
+    TcpClient tcp_client;
+    char host[64];
+    uint16_t port;
+    char user_identity[160];
+    uint32_t connection_count;
+    char session_id[12];
+
+    // frame being received
+    uint8_t frame_header[SV2_FRAME_HEADER_SIZE];
+    uint8_t frame_payload[SV2_MAX_PAYLOAD];
+    uint32_t frame_length;                  // payload length from header
+    uint32_t frame_pos;                     // bytes of header + payload received
+    bool frame_oversized;                   // payload is skipped, not stored
+
+    // channel state
+    bool setup_done;
+    bool channel_open;
+    uint32_t channel_id;
+    uint32_t request_id;
+    uint8_t target[32];
+
+    // jobs and chain tip
+    sv2_job_t jobs[SV2_MAX_JOBS];
+    int8_t active_job;                      // index into jobs, -1 = none
+    bool prev_hash_valid;
+    uint8_t prev_hash[32];
+    uint32_t nbits;
+    uint32_t ntime;
+    uint8_t network_target[32];
+    char job_id_str[12];
+    uint32_t work_sequence;
+
+    // submits
+    uint32_t sequence_number;
+    sv2_pending_submit_t pending_submits[SV2_MAX_PENDING_SUBMITS];
+    uint32_t shares_accepted;
+    uint32_t shares_rejected;
+    uint32_t submits_evicted;
+    double accepted_difficulty;
+
+    // framing
+    bool send_frame(uint16_t extension_type, uint8_t msg_type, const uint8_t* payload, uint32_t len);
+    void handle_frame(uint8_t msg_type, const uint8_t* payload, uint32_t len);
+    bool send_setup_connection();
+    bool send_open_channel();
+
+    // message handlers
+    void handle_setup_success(const uint8_t* p, uint32_t len);
+    void handle_open_channel_success(const uint8_t* p, uint32_t len);
+    void handle_new_mining_job(const uint8_t* p, uint32_t len);
+    void handle_set_new_prev_hash(const uint8_t* p, uint32_t len);
+    void handle_set_target(const uint8_t* p, uint32_t len);
+    void handle_submit_success(const uint8_t* p, uint32_t len);
+    void handle_submit_error(const uint8_t* p, uint32_t len);
+    void activate_job(int8_t index);
+
+    // little-endian field helpers
+    static void put_u16(uint8_t* out, uint16_t value);
+    static void put_u32(uint8_t* out, uint32_t value);
+    static uint16_t get_u16(const uint8_t* in);
+    static uint32_t get_u32(const uint8_t* in);
+    static size_t put_str0_255(uint8_t* out, const char* str);
+};
+
+#endif
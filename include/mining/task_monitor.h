@@ -0,0 +1,85 @@
+// task_monitor.h
+// per-task cpu share, stack headroom and heap watermarks
+//
+// samples the scheduler every TASK_MONITOR_INTERVAL_MS from the main loop:
+// each task's share of one core over the last window, the least stack it
+// ever had left, and free / minimum free internal ram and psram. readers on
+// any core get the last sample through get_stats(). a task that gets close
+// to overflowing or a heap close to running out is logged once as a warning,
+// the full table is logged at debug level after every sample
+
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <Arduino.h>
+#include "platform/platform.h"
+#include "seqlock.h"
+
+#define TASK_MONITOR_INTERVAL_MS 5000
+#define TASK_MONITOR_STACK_WARN 512         // bytes of stack left before a task is reported
+#define TASK_MONITOR_HEAP_WARN 16384        // bytes of internal ram left before it is reported
+
+// cores with a load figure, linux tasks pinned past these only count per task
+#if defined(PLATFORM_NATIVE)
+#define TASK_MONITOR_MAX_CORES 16
+#else
+#define TASK_MONITOR_MAX_CORES portNUM_PROCESSORS
+#endif
+
+// one task over the last window
+struct task_stats_t {
+    char name[16];
+    float cpu_percent;                      // of one core, -1 = run-time stats unavailable
+    uint32_t stack_free;                    // lowest free stack since the task started (bytes, 0 = unknown)
+    int8_t core;                            // pinned core, -1 = any
+    uint8_t priority;
+};
+
+// one sample, published by the main loop
+struct system_stats_t {
+    uint32_t window_ms;                     // time the cpu shares cover, 0 = no sample yet
+    bool cpu_valid;                         // false without freertos run-time stats
+    uint8_t cores;
+    float core_load[TASK_MONITOR_MAX_CORES];// percent busy, from the idle tasks where there are any
+    uint8_t task_count;
+    task_stats_t tasks[PLATFORM_MAX_TASKS]; // in scheduler order
+    int8_t min_stack_task;                  // index of the task with the least stack left, -1 = none known
+    platform_heap_info_t heap;
+};
+
+class TaskMonitor {
+public:
+    TaskMonitor();
+
+    // main loop - samples once TASK_MONITOR_INTERVAL_MS have passed
+    void process();
+
+    // take a sample now, the cpu shares cover the time since the previous one
+    void sample();
+
+    // last sample, safe from any core
+    system_stats_t get_stats();
+
+    // one "[tasks]" line per task plus cores and heap, at debug level
+    static void log_stats(const system_stats_t& stats);
+
+private:
+    // previous snapshot, cpu shares are the difference to it
+    platform_task_info_t previous[PLATFORM_MAX_TASKS];
+    uint8_t previous_count;
+    uint32_t previous_elapsed;
+    unsigned long previous_ms;
+    bool have_previous;
+
+    // tasks already warned about, so each shows up once
+    uint32_t warned_ids[PLATFORM_MAX_TASKS];
+    uint8_t warned_count;
+    bool heap_warned;
+
+    SeqLock<system_stats_t> published;
+
+    const platform_task_info_t* find_previous(uint32_t id);
+    void warn_stack(const platform_task_info_t* task);
+};
+
+#endif
@@ -0,0 +1,181 @@
+// telemetry_frame.h
+// binary telemetry frames - shared by the firmware and tools/telemetry_decode.cpp
+//
+// a frame is a packed struct followed by its crc-32 (ieee, little-endian),
+// cobs-encoded and sent between two 0x00 bytes:
+//   00 | cobs(payload | crc32) | 00
+// cobs leaves no zero inside the frame, so a reader splits the serial stream
+// at zeros, text log lines in between end up in chunks that fail the crc.
+// the leading zero closes whatever text came before.
+//
+// fields are little-endian (the esp32 and x86 hosts both are). new fields
+// are only ever appended, a decoder accepts frames at least as long as the
+// version it knows and ignores the rest
+//
+// no arduino or platform headers, the host decoder builds with a plain g++
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_MAX_PAYLOAD 128                       // largest frame struct
+#define TELEMETRY_MAX_ENCODED (TELEMETRY_MAX_PAYLOAD + 4 + 2 + 2)   // + crc, cobs overhead, delimiters
+
+#define TELEMETRY_NO_TEMPERATURE INT16_MIN
+
+// first byte of every frame
+enum telemetry_type_t : uint8_t {
+    TELEMETRY_TYPE_STATS = 1,
+};
+
+// telemetry_stats_frame_t.flags
+#define TELEMETRY_FLAG_POOL_CONNECTED 0x01
+#define TELEMETRY_FLAG_HASHRATE_SUSPECT 0x02  // pool credits far less than we hash
+#define TELEMETRY_FLAG_KERNEL_SUSPECT 0x04    // we find far fewer shares than we hash
+
+// mining state, sent every TELEMETRY_INTERVAL_MS
+struct __attribute__((packed)) telemetry_stats_frame_t {
+    uint8_t type;                   // TELEMETRY_TYPE_STATS
+    uint8_t version;                // TELEMETRY_VERSION
+    uint16_t device_id;             // fleet id derived from the mac
+    uint32_t sequence;              // per boot, gaps are lost frames
+    uint32_t millis;                // device clock
+    uint8_t state;                  // mining_state_t
+    uint8_t flags;                  // TELEMETRY_FLAG_*
+    uint8_t workers;
+    uint8_t reserved;
+    uint32_t uptime_seconds;        // mining session
+    float hashrate_1m;              // hashes per second, ewmas
+    float hashrate_5m;
+    float hashrate_15m;
+    float hashrate_effective;       // credited by the pool
+    uint32_t shares_found;          // session counters
+    uint32_t shares_accepted;
+    uint32_t shares_rejected;
+    uint32_t shares_dropped;
+    uint32_t shares_replayed;
+    float pool_difficulty;
+    float best_difficulty;          // this session
+    uint32_t pool_latency_ms;       // submit round trip, 0 = not measured
+    uint32_t job_switch_us;         // new work to first nonce chunk claimed on it
+    int16_t temperature_centi;      // hundredths of a degree celsius, TELEMETRY_NO_TEMPERATURE if none
+    uint32_t heap_free;             // internal ram, bytes
+    uint32_t heap_min_free;
+    uint32_t psram_free;
+};
+
+static_assert(sizeof(telemetry_stats_frame_t) <= TELEMETRY_MAX_PAYLOAD, "telemetry frame too large");
+
+// crc-32 (ieee 802.3, the zlib one), four bits at a time from a 16-entry table
+static inline uint32_t telemetry_crc32(const uint8_t* data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// consistent overhead byte stuffing, out needs len + len / 254 + 1 bytes
+// returns the encoded length, no delimiters
+static inline size_t telemetry_cobs_encode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t code_at = 0;
+    size_t pos = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = pos++;
+            code = 1;
+            continue;
+        }
+        out[pos++] = in[i];
+        code++;
+        if (code == 0xFF) {
+            out[code_at] = code;
+            code_at = pos++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return pos;
+}
+
+// undo telemetry_cobs_encode() on one frame without its delimiters
+// returns the decoded length, 0 if it is not valid cobs or does not fit
+static inline size_t telemetry_cobs_decode(const uint8_t* in, size_t len, uint8_t* out, size_t out_size) {
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t j = 1; j < code; j++) {
+            if (in[i] == 0 || pos >= out_size) {
+                return 0;
+            }
+            out[pos++] = in[i++];
+        }
+        // a zero follows every block except full ones and the last
+        if (code != 0xFF && i < len) {
+            if (pos >= out_size) {
+                return 0;
+            }
+            out[pos++] = 0;
+        }
+    }
+    return pos;
+}
+
+// payload + crc, cobs-encoded between delimiters, into out (TELEMETRY_MAX_ENCODED bytes)
+// returns the bytes to send, 0 if the payload is too large
+static inline size_t telemetry_encode(const void* payload, size_t len, uint8_t* out) {
+    if (len > TELEMETRY_MAX_PAYLOAD) {
+        return 0;
+    }
+    uint8_t raw[TELEMETRY_MAX_PAYLOAD + 4];
+    const uint8_t* bytes = (const uint8_t*)payload;
+    for (size_t i = 0; i < len; i++) {
+        raw[i] = bytes[i];
+    }
+    uint32_t crc = telemetry_crc32(raw, len);
+    raw[len] = (uint8_t)crc;
+    raw[len + 1] = (uint8_t)(crc >> 8);
+    raw[len + 2] = (uint8_t)(crc >> 16);
+    raw[len + 3] = (uint8_t)(crc >> 24);
+
+    out[0] = 0;
+    size_t encoded = telemetry_cobs_encode(raw, len + 4, out + 1);
+    out[1 + encoded] = 0;
+    return encoded + 2;
+}
+
+// one cobs chunk (between two zeros) back to its payload, crc checked
+// returns the payload length, 0 for anything that is not a good frame
+static inline size_t telemetry_decode(const uint8_t* chunk, size_t len, uint8_t* payload, size_t payload_size) {
+    uint8_t raw[TELEMETRY_MAX_PAYLOAD + 4];
+    size_t decoded = telemetry_cobs_decode(chunk, len, raw, sizeof(raw));
+    if (decoded <= 4 || decoded - 4 > payload_size) {
+        return 0;
+    }
+    size_t n = decoded - 4;
+    uint32_t crc = (uint32_t)raw[n] | ((uint32_t)raw[n + 1] << 8) |
+                   ((uint32_t)raw[n + 2] << 16) | ((uint32_t)raw[n + 3] << 24);
+    if (telemetry_crc32(raw, n) != crc) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        payload[i] = raw[i];
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,101 @@
+// tls_client.h
+// tls transport for pool connections, mbedtls on top of a TcpClient
+//
+// a full handshake costs seconds of cpu on the esp32, so the session of the
+// last connection is kept and offered again on reconnect. the server then
+// resumes it from a session ticket or its session cache and skips the key
+// exchange. tls 1.2 only, that is where both resumption methods work the same
+// (test/test_tls_resume checks both against an in-process mbedtls server)
+//
+// the server certificate is checked only if a ca certificate was set,
+// pools rarely publish one and the firmware carries no ca bundle
+
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include "platform/platform.h"
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+#define TLS_HANDSHAKE_TIMEOUT 15000     // ms, a full handshake alone takes a few seconds
+
+class TlsClient : public Client {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    // pem ca certificate used to verify the pool, NULL = no verification
+    void set_ca_cert(const char* pem);
+
+    // host name for sni and session matching when connecting by address
+    void set_server_name(const char* name);
+
+    // forget the saved session, the next connect does a full handshake
+    void clear_session();
+
+    // Client interface
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char* host, uint16_t port);
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    operator bool();
+
+    // handshake stats
+    uint32_t get_last_handshake_ms();
+    bool was_resumed();                     // last handshake resumed a saved session
+    uint32_t get_full_handshakes();
+    uint32_t get_resumed_handshakes();
+    uint32_t get_full_handshake_ms_avg();
+    uint32_t get_resumed_handshake_ms_avg();
+
+private:
+    TcpClient tcp;
+
+    // long-lived state, set up on first connect
+    bool initialized;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt ca_cert;
+    bool ca_cert_loaded;
+
+    // per connection
+    mbedtls_ssl_context ssl;
+    bool ssl_active;
+    int peeked;                             // byte returned by peek(), -1 = none
+
+    // session kept for resumption, only offered to the host that issued it
+    mbedtls_ssl_session session;
+    bool session_saved;
+    char session_host[64];
+    char server_name[64];                   // used by connect(IPAddress, ...)
+
+    // stats
+    uint32_t last_handshake_ms;
+    bool last_resumed;
+    uint32_t full_handshakes;
+    uint32_t resumed_handshakes;
+    uint32_t full_handshake_ms_total;
+    uint32_t resumed_handshake_ms_total;
+
+    bool init_config();
+    bool handshake(const char* host);
+    void save_session(const char* host);
+
+    // mbedtls bio callbacks, ctx is the TcpClient
+    static int bio_send(void* ctx, const unsigned char* buf, size_t len);
+    static int bio_recv(void* ctx, unsigned char* buf, size_t len);
+};
+
+#endif
@@ -0,0 +1,60 @@
+// work_source.h
+// interface between MiningManager and whatever hands it work
+//
+// a work source owns the job, builds 80-byte headers for it and takes found
+// nonces back. StratumClient gets work from a pool, SoloClient builds it
+// locally from a node's getblocktemplate
+
+#ifndef WORK_SOURCE_H
+#define WORK_SOURCE_H
+
+#include <Arduino.h>
+
+class WorkSource {
+public:
+    virtual ~WorkSource() {}
+
+    // connection management
+    virtual bool connect(const char* host, uint16_t port) = 0;
+    virtual void disconnect() = 0;
+    virtual bool is_connected() = 0;
+
+    // call regularly to process incoming data
+    virtual void process() = 0;
+
+    // work management
+    virtual bool has_work() = 0;
+    virtual uint32_t get_work_sequence() = 0;               // bumps when header or target inputs change
+    virtual void build_block_header(uint8_t* header_out) = 0;  // builds 80-byte header from current job
+    virtual void get_target(uint8_t* target_out) = 0;       // 32-byte share target
+    virtual void get_network_target(uint8_t* target_out) = 0;  // 32-byte block target
+    virtual const char* get_current_job_id() = 0;
+    virtual uint32_t get_current_ntime() = 0;
+    virtual uint32_t get_current_extranonce2() = 0;         // extranonce2 used by build_block_header
+    virtual uint32_t get_current_nbits() = 0;
+
+    // move the current job to its next extranonce2 once every nonce is spent,
+    // bumps the work sequence. false when the source has nothing to roll
+    virtual bool roll_extranonce2() { return false; }
+
+    // shares are only valid in the session their job came from, a reconnect
+    // that resumes the session keeps the id ("" = jobs outlive the connection)
+    virtual const char* get_session_id() { return ""; }
+
+    // share submission - false when the submit could not be queued, it then
+    // gets no id and is never pending
+    virtual bool submit_share(const char* job_id, uint32_t extranonce2, uint32_t ntime, uint32_t nonce) = 0;
+    virtual uint32_t get_last_submit_id() = 0;              // id of last submit sent
+    virtual bool is_submit_pending(uint32_t id) = 0;        // true until that submit is answered
+    virtual void flush() {}                                 // send buffered submits now
+
+    // stats
+    virtual uint32_t get_shares_accepted() = 0;
+    virtual uint32_t get_shares_rejected() = 0;
+    virtual double get_difficulty() = 0;                    // difficulty of the share target
+    virtual double get_accepted_difficulty() = 0;           // sum of difficulty over accepted shares
+    virtual uint32_t get_submit_latency_ms() { return 0; }  // smoothed submit-to-response time, 0 = not measured
+    virtual uint32_t get_submits_evicted() { return 0; }    // unanswered submits forgotten to make room for new ones
+};
+
+#endif
@@ -0,0 +1,156 @@
+// platform.h
+// thin platform layer under the mining core - esp32 or a linux host
+//
+// the mining core talks to the hardware and the os only through this file
+// and the arduino basics (Serial, String, IPAddress, Client). on the esp32
+// everything maps straight onto arduino-esp32 and freertos. with
+// PLATFORM_NATIVE (pio env "native") the same core builds as a linux binary,
+// src/native holds the arduino subset and the posix side of this layer
+//
+// monotonic clock: millis(), micros() and delay() keep their arduino names,
+// on linux they run on CLOCK_MONOTONIC
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#if defined(PLATFORM_NATIVE)
+#include <platform_native.h>            // TcpClient, TcpServer, KvStore, PlatformFile, platform_task_t
+#else
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+#include <Preferences.h>
+#include <FS.h>
+
+// tcp sockets - the arduino classes are the reference api
+typedef WiFiClient TcpClient;
+typedef WiFiServer TcpServer;
+
+// key/value storage in nvs, linux keeps one file per namespace
+typedef Preferences KvStore;
+
+// files on littlefs, linux keeps them next to the key/value files
+typedef fs::File PlatformFile;
+
+typedef TaskHandle_t platform_task_t;
+#endif
+
+// ----- tasks -----
+
+typedef void (*platform_task_fn_t)(void* arg);
+
+// start fn(arg) as its own task, pinned to core (-1 = any)
+// stack_size and priority follow freertos, linux threads keep the default
+// stack (sanitizers need far more than the esp32 budget) and ignore priority
+bool platform_task_create(platform_task_fn_t fn, const char* name, uint32_t stack_size,
+                          void* arg, uint8_t priority, int core, platform_task_t* handle_out);
+
+// wake a task blocked in platform_task_wait()
+void platform_task_notify(platform_task_t task);
+
+// block the calling task until it is notified, consumes the notification
+void platform_task_wait();
+
+// end the calling task, its handle is invalid afterwards
+void platform_task_exit();
+
+// end the calling task but keep its handle valid until its owner calls
+// platform_task_delete(), notifying it in between is harmless
+// esp32: the task suspends itself, linux: the thread ends
+void platform_task_finish();
+
+// end another task and free its handle
+// a task parked in platform_task_finish() goes cleanly. one still running is
+// killed wherever it is on the esp32; linux can't kill a thread safely, it is
+// left running detached and its handle stays valid
+void platform_task_delete(platform_task_t task);
+
+// take the core out of the idle-task watchdog, for tasks that never yield
+void platform_disable_core_watchdog(int core);
+
+// cores tasks can be pinned to
+int platform_core_count();
+
+// ----- network -----
+
+// station is up and has an address
+bool platform_network_connected();
+
+// 6-byte hardware address identifying this unit
+void platform_mac_address(uint8_t* mac);
+
+// blocking ipv4 lookup
+bool platform_resolve(const char* host, IPAddress& out);
+
+// callback of platform_resolve_async, ip 0 = lookup failed
+// runs in another thread (lwip on the esp32), host must outlive the lookup
+typedef void (*platform_resolve_fn_t)(uint32_t ip, void* arg);
+
+// start a lookup in the background, false if it could not be started
+bool platform_resolve_async(const char* host, platform_resolve_fn_t done, void* arg);
+
+// ----- files -----
+
+// open "/name" with mode "r", "w" or "a", an empty file object on failure
+// the esp32 mounts littlefs (formatting it if needed) on first use
+PlatformFile platform_file_open(const char* path, const char* mode);
+
+// ----- cycle counter -----
+
+// free-running counter for microbenchmarks, differences survive the wrap
+// esp32: cpu clock cycles, x86 linux: tsc ticks (constant rate, not core
+// cycles under turbo), other linux: nanoseconds
+uint32_t platform_cycles();
+
+// counter ticks per microsecond, measured once on linux
+uint32_t platform_cycles_per_us();
+
+// ----- system statistics -----
+
+#define PLATFORM_MAX_TASKS 32           // tasks past this are left out of a snapshot
+
+// one task as the scheduler sees it
+struct platform_task_info_t {
+    char name[16];
+    uint32_t id;                        // freertos task number, linux thread id
+    uint32_t runtime;                   // cpu time in run-time counter ticks, wraps
+    uint32_t stack_free;                // stack never touched so far in bytes, 0 = unknown
+    int8_t core;                        // pinned core, -1 = any
+    uint8_t priority;
+};
+
+// every task with its cpu time so far, returns how many were written
+// *elapsed is the run-time counter itself (wall time in the same ticks,
+// wraps), so a task's share of one core is d(runtime) / d(elapsed).
+// esp32: needs configUSE_TRACE_FACILITY, the cpu times also
+// configGENERATE_RUN_TIME_STATS in the framework's sdkconfig, without it
+// runtime and *elapsed stay 0. linux: the process's threads from /proc,
+// no stack numbers
+uint8_t platform_task_snapshot(platform_task_info_t* tasks, uint8_t max_tasks, uint32_t* elapsed);
+
+// free heap in bytes, the minimums are the lowest since boot
+// linux leaves everything 0
+struct platform_heap_info_t {
+    uint32_t internal_free;
+    uint32_t internal_min_free;
+    uint32_t internal_largest_block;    // biggest single allocation that would still succeed
+    uint32_t psram_size;                // 0 = no psram
+    uint32_t psram_free;
+    uint32_t psram_min_free;
+};
+
+void platform_heap_snapshot(platform_heap_info_t* heap);
+
+// chip temperature in degrees celsius, NAN when there is no sensor
+// esp32: the internal sensor (a few degrees off, good for trends), linux:
+// the first thermal zone
+float platform_temperature();
+
+// ----- hashing -----
+
+// single sha256 - the esp32 sha peripheral, mbedtls in software on linux
+void platform_sha256(const uint8_t* data, size_t len, uint8_t* output);
+
+#endif
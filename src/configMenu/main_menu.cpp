@@ -1,6 +1,7 @@
 // main_menu.cpp
 
 #include "configMenu/main_menu.h"
+#include "mining/profiler.h"
 
 // constructor
 MainMenu::MainMenu() {
@@ -10,6 +11,7 @@ MainMenu::MainMenu() {
 
 // main draw function called every loop to render current state
 void MainMenu::draw(lgfx::LGFX_Device* lcd) {
+  PROFILE_SCOPE(UI_DRAW);
   UIUtils::draw_header(lcd, "Main menu");
   draw_menu_list(lcd);
 }
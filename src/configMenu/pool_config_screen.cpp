@@ -1,6 +1,7 @@
 // pool_config_screen.cpp
 
 #include "configMenu/pool_config_screen.h"
+#include "mining/profiler.h"
 
 // constructor
 PoolConfigScreen::PoolConfigScreen() {
@@ -21,6 +22,7 @@ PoolConfigScreen::PoolConfigScreen() {
 
 // main draw function called every loop to render current state
 void PoolConfigScreen::draw(lgfx::LGFX_Device* lcd) {
+  PROFILE_SCOPE(UI_DRAW);
   switch (current_state) {
     case pool_screen_state_t::STATE_LIST:
       // draw pool list view with header
@@ -2,6 +2,7 @@
 // theme selection screen for homepage appearance
 
 #include "configMenu/theme_config_screen.h"
+#include "mining/profiler.h"
 
 // constructor
 ThemeConfigScreen::ThemeConfigScreen() {
@@ -23,6 +24,7 @@ ThemeConfigScreen::ThemeConfigScreen() {
 
 // main draw function
 void ThemeConfigScreen::draw(lgfx::LGFX_Device* lcd) {
+    PROFILE_SCOPE(UI_DRAW);
     UIUtils::draw_header(lcd, "Themes");
     draw_list(lcd);
 }
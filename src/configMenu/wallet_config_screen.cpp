@@ -1,6 +1,7 @@
 // wallet_config_screen.cpp
 
 #include "configMenu/wallet_config_screen.h"
+#include "mining/profiler.h"
 
 // constructor
 WalletConfigScreen::WalletConfigScreen() {
@@ -20,6 +21,7 @@ WalletConfigScreen::WalletConfigScreen() {
 
 // main draw function called every loop to render current state
 void WalletConfigScreen::draw(lgfx::LGFX_Device* lcd) {
+  PROFILE_SCOPE(UI_DRAW);
   switch (current_state) {
     case wallet_screen_state_t::STATE_LIST:
       // draw wallet list view with header
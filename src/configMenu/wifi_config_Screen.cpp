@@ -1,6 +1,7 @@
 // wifi_config_screen.cpp
 #include "configMenu/wifi_config_screen.h"
 #include "configMenu/ui_utils.h"
+#include "mining/profiler.h"
 
 #include <Preferences.h>
 
@@ -59,6 +60,7 @@ WifiConfigScreen::WifiConfigScreen() {
 
 // main draw method - renders current state
 void WifiConfigScreen::draw(lgfx::LGFX_Device* lcd) {
+  PROFILE_SCOPE(UI_DRAW);
   switch (current_state) {
     case wifi_screen_state_t::STATE_SCANNING: {
       if (display_needs_redraw) {
@@ -3,6 +3,12 @@
 
 #include <Arduino.h>
 #include "mining/sha256_miner.h"
+#include "mining/benchmark.h"
+#include "mining/profiler.h"
+#include "mining/log_ring.h"
+
+// test 6: largest hashrate loss the log ring may cost, in percent
+#define LOG_IMPACT_TOLERANCE 1.0
 
 // helper function to print 32 bytes as hex string
 void print_hash(const uint8_t* hash) {
@@ -199,7 +205,7 @@ bool test_mine_nonce_range() {
   unsigned long start_time = millis();
   
   // run mining
-  bool found = mine_nonce_range(header, start_nonce, nonce_count, target, &found_nonce, &hashes_done);
+  bool found = mine_nonce_range(header, start_nonce, nonce_count, target, &found_nonce, &hashes_done, NULL);
   
   unsigned long elapsed = millis() - start_time;
   
@@ -262,25 +268,139 @@ void test_hashrate_benchmark() {
   uint32_t hashes_done = 0;
   uint32_t nonce_count = 100000;
   
-  // measure time for full batch
-  unsigned long start_time = millis();
+  // run once without and once with best share tracking to measure its cost
+  float hashrates[2] = {0, 0};
   
-  mine_nonce_range(header, 0, nonce_count, target, &found_nonce, &hashes_done);
+  for (int pass = 0; pass < 2; pass++) {
+    best_share_t best;
+    best_share_init(&best);
+    
+    Serial.println(pass == 0 ? "  without best share tracking:" : "  with best share tracking:");
+    
+    // measure time for full batch
+    unsigned long start_time = millis();
+    
+    mine_nonce_range(header, 0, nonce_count, target, &found_nonce, &hashes_done,
+                     pass == 0 ? NULL : &best);
+    
+    unsigned long elapsed = millis() - start_time;
+    
+    Serial.print("    hashes: ");
+    Serial.println(hashes_done);
+    Serial.print("    time: ");
+    Serial.print(elapsed);
+    Serial.println(" ms");
+    
+    if (elapsed > 0) {
+      hashrates[pass] = (float)hashes_done / ((float)elapsed / 1000.0);
+      Serial.print("    hash rate: ");
+      Serial.print(hashrates[pass] / 1000.0, 2);
+      Serial.println(" kh/s");
+    }
+    
+    if (pass == 1) {
+      Serial.print("    best share difficulty: ");
+      Serial.println(hash_to_difficulty(best.hash), 6);
+    }
+  }
   
-  unsigned long elapsed = millis() - start_time;
+  // throughput impact of the best share check
+  if (hashrates[0] > 0) {
+    Serial.print("  best share tracking impact: ");
+    Serial.print((hashrates[0] - hashrates[1]) * 100.0 / hashrates[0], 2);
+    Serial.println(" %");
+  }
+}
+
+// test 5: microbenchmarks, compared with the baseline on littlefs
+// the first run has nothing to compare with and saves its numbers as the baseline
+bool run_microbenchmarks() {
+  static bench_result_t results[BENCH_MAX_RESULTS];
   
-  Serial.print("  hashes: ");
-  Serial.println(hashes_done);
-  Serial.print("  time: ");
-  Serial.print(elapsed);
-  Serial.println(" ms");
+  Serial.println("\n[test] microbenchmarks");
   
-  if (elapsed > 0) {
-    float hashrate = (float)hashes_done / ((float)elapsed / 1000.0);
-    Serial.print("  hash rate: ");
-    Serial.print(hashrate / 1000.0, 2);
-    Serial.println(" kh/s");
+  uint8_t count = benchmark_run(NULL, results, BENCH_MAX_RESULTS);
+  bool have_baseline = benchmark_load_baseline(BENCH_BASELINE_PATH, results, count);
+  uint8_t regressions = benchmark_check(results, count, 0);
+  
+  benchmark_print(results, count);
+  benchmark_print_json(results, count);
+  
+  if (!have_baseline) {
+    Serial.println(benchmark_save_baseline(BENCH_BASELINE_PATH, results, count) ?
+                   "  no baseline yet, saved this run as the baseline" :
+                   "  no baseline yet, saving it failed");
+  }
+  return regressions == 0;
+}
+
+// hashes 100000 nonces in mining task sized batches and logs a pool line at
+// debug and a share line after every batch, far more than a pool session sends
+// returns hashes per second
+float hashrate_with_logging() {
+  uint8_t header[80];
+  for (int i = 0; i < 80; i++) {
+    header[i] = i * 3;
+  }
+  uint8_t target[32] = {0};
+  
+  // a mining.notify sized line
+  static const char pool_line[] =
+    "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"4f2a\",\"8d3c0b1e2f4a5b6c7d8e9f0a1b2c3d4e5f6a7b8c"
+    "9d0e1f2a3b4c5d6e\",\"01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff\","
+    "\"ffffffff0100f2052a010000001976a914\",[],\"20000000\",\"1d00ffff\",\"6553a2f1\",false]}";
+  
+  uint32_t found_nonce = 0;
+  uint32_t hashes_done = 0;
+  uint32_t total = 0;
+  
+  unsigned long start_time = micros();
+  for (uint32_t nonce = 0; nonce < 100000; nonce += 10000) {
+    mine_nonce_range(header, nonce, 10000, target, &found_nonce, &hashes_done, NULL);
+    total += hashes_done;
+    LOG_DEBUG("[stratum] recv: %s", pool_line);
+    LOG_INFO("[mining] share found! nonce: %X", nonce);
+  }
+  unsigned long elapsed = micros() - start_time;
+  
+  return elapsed > 0 ? (float)total / ((float)elapsed / 1000000.0) : 0;
+}
+
+// test 6: hashrate with the log ring at off vs debug
+// alternating rounds so thermal or clock drift hits both levels alike
+// setup() shares core 1 with the drain task here, the miner's workers run on
+// core 0 - so this is an upper bound for the real miner
+bool test_log_ring_impact() {
+  Serial.println("\n[test] hashrate with log ring off vs debug (5 x 100000 hashes each)");
+  
+  log_begin();
+  log_level_t saved = log_get_level();
+  
+  float sum[2] = {0, 0};
+  for (int round = 0; round < 5; round++) {
+    log_set_level(log_level_t::OFF);
+    sum[0] += hashrate_with_logging();
+    log_set_level(log_level_t::DEBUG);
+    sum[1] += hashrate_with_logging();
+    log_flush(1000);
   }
+  log_set_level(saved);
+  
+  float off = sum[0] / 5;
+  float debug = sum[1] / 5;
+  float impact = off > 0 ? (off - debug) * 100.0 / off : 0;
+  
+  Serial.print("  log off:   ");
+  Serial.print(off / 1000.0, 2);
+  Serial.println(" kh/s");
+  Serial.print("  log debug: ");
+  Serial.print(debug / 1000.0, 2);
+  Serial.println(" kh/s");
+  Serial.print("  log ring impact: ");
+  Serial.print(impact, 2);
+  Serial.println(" %");
+  
+  return impact < LOG_IMPACT_TOLERANCE;
 }
 
 void setup() {
@@ -300,8 +420,10 @@ void setup() {
   bool test2 = test_hash_below_target();
   bool test3 = test_mine_nonce_range();
   
-  // run benchmark
+  // run benchmarks
   test_hashrate_benchmark();
+  bool test5 = run_microbenchmarks();
+  bool test6 = test_log_ring_impact();
   
   // summary
   Serial.println("\n========================================");
@@ -313,8 +435,12 @@ void setup() {
   Serial.println(test2 ? "[pass]" : "[fail]");
   Serial.print("  mine_nonce_range:  ");
   Serial.println(test3 ? "[pass]" : "[fail]");
+  Serial.print("  microbenchmarks:   ");
+  Serial.println(test5 ? "[pass]" : "[regressed]");
+  Serial.print("  log ring impact:   ");
+  Serial.println(test6 ? "[pass]" : "[fail]");
   
-  if (test1 && test2 && test3) {
+  if (test1 && test2 && test3 && test5 && test6) {
     Serial.println("\n  all tests passed!");
   } else {
     Serial.println("\n  some tests failed - check output above");
@@ -325,5 +451,7 @@ void setup() {
 
 void loop() {
   // nothing to do - tests run once in setup
-  delay(10000);
+  // profiling builds print the hot path timings, MiningManager::process() is not called here
+  PROFILE_REPORT();
+  delay(1000);
 }
\ No newline at end of file
@@ -0,0 +1,365 @@
+// benchmark.cpp
+// microbenchmarks for the hash kernels and the stratum helpers
+
+#include "mining/benchmark.h"
+#include "mining/sha256_miner.h"
+#include "mining/sha256_lanes.h"
+#include "mining/stratum_client.h"
+#include "platform/platform.h"
+
+// deepest merkle branch list a notify benchmark builds
+#define BENCH_MAX_DEPTH 12
+
+// the stratum helpers are private, this is the one class allowed in
+class StratumBenchmark {
+public:
+    static void merkle_root(StratumClient* client, uint8_t* out) {
+        client->compute_merkle_root(out);
+    }
+    static void hex_to_bytes(StratumClient* client, const char* hex, uint8_t* out, size_t len) {
+        client->hex_to_bytes(hex, out, len);
+    }
+    static void bytes_to_hex(StratumClient* client, const uint8_t* bytes, size_t len, char* out) {
+        client->bytes_to_hex(bytes, len, out);
+    }
+};
+
+// one benchmark - setup returns false when it cannot run here (missing isa)
+struct bench_def_t {
+    const char* name;
+    uint32_t ops;
+    uint8_t tolerance;
+    bool (*setup)(uint8_t arg);
+    void (*run)(uint32_t ops, uint8_t arg);
+    uint8_t arg;
+};
+
+// inputs shared by the benchmarks, filled once
+static uint8_t bench_header[80];
+static uint8_t bench_hashes[16][32];
+static uint8_t bench_targets[16][32];
+static char bench_hex[65];
+static uint8_t bench_bytes[32];
+static StratumClient* bench_client = NULL;
+static char bench_notify[1536];
+
+// results go here so the compiler cannot drop the work
+static volatile uint32_t bench_sink;
+
+static void fill_random(uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)esp_random();
+    }
+}
+
+// ----- hashing -----
+
+static void run_sha256d(uint32_t ops, uint8_t kernel) {
+    uint8_t hash[32];
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_header[76] = (uint8_t)i;
+        sha256d_with((sha256_kernel_t)kernel, bench_header, 80, hash);
+        bench_sink += hash[31];
+    }
+}
+
+// the worker's loop: impossible target, best share tracking on
+static void run_mine_nonce_range(uint32_t ops, uint8_t arg) {
+    static uint32_t next_nonce = 0;
+    uint8_t target[32] = {0};
+    uint32_t found_nonce = 0;
+    uint32_t hashes_done = 0;
+    best_share_t best;
+    best_share_init(&best);
+
+    mine_nonce_range(bench_header, next_nonce, ops, target, &found_nonce, &hashes_done, &best);
+    next_nonce += ops;
+    bench_sink += hashes_done;
+}
+
+#if defined(SHA256_LANES_AVAILABLE)
+static uint32_t bench_midstate[8];
+static uint32_t bench_tail[3];
+
+static bool setup_lanes(uint8_t isa) {
+    fill_random((uint8_t*)bench_midstate, sizeof(bench_midstate));
+    fill_random((uint8_t*)bench_tail, sizeof(bench_tail));
+    return isa <= (uint8_t)sha256_lanes_detect();
+}
+
+// ops counts hashes, one scan call hashes a lane per nonce
+static void run_lanes(uint32_t ops, uint8_t isa) {
+    uint32_t top_words[SHA256_LANES_MAX];
+    uint8_t lanes = sha256_lanes_count((sha256_lanes_isa_t)isa);
+    for (uint32_t nonce = 0; nonce < ops; nonce += lanes) {
+        sha256_lanes_scan((sha256_lanes_isa_t)isa, bench_midstate, bench_tail, nonce, top_words);
+        bench_sink += top_words[0];
+    }
+}
+#endif
+
+// 16 hash/target pairs, mostly deciding in the top bytes like real shares
+static bool setup_below_target(uint8_t arg) {
+    for (int i = 0; i < 16; i++) {
+        fill_random(bench_hashes[i], 32);
+        fill_random(bench_targets[i], 32);
+        bench_targets[i][31] = 0;
+        bench_hashes[i][31] = i & 1 ? 0 : 1;
+    }
+    return true;
+}
+
+static void run_below_target(uint32_t ops, uint8_t arg) {
+    uint32_t below = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        below += hash_below_target(bench_hashes[i & 15], bench_targets[(i >> 4) & 15]);
+    }
+    bench_sink += below;
+}
+
+// ----- stratum -----
+
+static const char BENCH_SUBSCRIBE[] =
+    "{\"id\":1,\"result\":[[[\"mining.set_difficulty\",\"b1\"],[\"mining.notify\",\"b1\"]],\"f8002c90\",4],\"error\":null}";
+
+// a parsed client with extranonce1 from a subscribe response
+static bool setup_client(uint8_t arg) {
+    if (bench_client == NULL) {
+        bench_client = new StratumClient();
+        bench_client->set_quiet(true);
+        bench_client->replay_line(BENCH_SUBSCRIBE);
+    }
+    fill_random(bench_bytes, sizeof(bench_bytes));
+    for (int i = 0; i < 32; i++) {
+        sprintf(bench_hex + 2 * i, "%02x", bench_bytes[i]);
+    }
+    return true;
+}
+
+static void append_hex(char** pos, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        *pos += sprintf(*pos, "%02x", (uint8_t)esp_random());
+    }
+}
+
+// mining.notify with depth merkle branches, coinbase sizes of a typical pool
+static bool setup_notify(uint8_t depth) {
+    setup_client(0);
+
+    char* pos = bench_notify;
+    pos += sprintf(pos, "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"1f3a\",\"");
+    append_hex(&pos, 32);
+    pos += sprintf(pos, "\",\"");
+    append_hex(&pos, 53);
+    pos += sprintf(pos, "\",\"");
+    append_hex(&pos, 60);
+    pos += sprintf(pos, "\",[");
+    for (int i = 0; i < depth; i++) {
+        pos += sprintf(pos, i == 0 ? "\"" : ",\"");
+        append_hex(&pos, 32);
+        pos += sprintf(pos, "\"");
+    }
+    sprintf(pos, "],\"20000000\",\"17034219\",\"6710a3c4\",true]}");
+
+    // a notify the parser rejects leaves the previous job in place
+    uint32_t sequence = bench_client->get_work_sequence();
+    bench_client->replay_line(bench_notify);
+    return bench_client->get_work_sequence() != sequence;
+}
+
+static void run_merkle_root(uint32_t ops, uint8_t depth) {
+    uint8_t root[32];
+    for (uint32_t i = 0; i < ops; i++) {
+        StratumBenchmark::merkle_root(bench_client, root);
+        bench_sink += root[0];
+    }
+}
+
+static void run_notify(uint32_t ops, uint8_t depth) {
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_client->replay_line(bench_notify);
+    }
+    bench_sink += bench_client->get_work_sequence();
+}
+
+static void run_hex_to_bytes(uint32_t ops, uint8_t arg) {
+    for (uint32_t i = 0; i < ops; i++) {
+        StratumBenchmark::hex_to_bytes(bench_client, bench_hex, bench_bytes, 32);
+        bench_sink += bench_bytes[i & 31];
+    }
+}
+
+static void run_bytes_to_hex(uint32_t ops, uint8_t arg) {
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_bytes[0] = (uint8_t)i;
+        StratumBenchmark::bytes_to_hex(bench_client, bench_bytes, 32, bench_hex);
+        bench_sink += bench_hex[i & 63];
+    }
+}
+
+static const bench_def_t BENCHMARKS[] = {
+    { "sha256d_80",         16,   10, NULL,               run_sha256d,          (uint8_t)sha256_kernel_t::HARDWARE },
+    { "sha256d_80_soft",    16,   10, NULL,               run_sha256d,          (uint8_t)sha256_kernel_t::SOFTWARE },
+    { "mine_nonce_range",   1024, 10, NULL,               run_mine_nonce_range, 0 },
+#if defined(SHA256_LANES_AVAILABLE)
+    { "lanes_sse2",         256,  10, setup_lanes,        run_lanes,            (uint8_t)sha256_lanes_isa_t::SSE2 },
+    { "lanes_avx2",         256,  10, setup_lanes,        run_lanes,            (uint8_t)sha256_lanes_isa_t::AVX2 },
+    { "lanes_avx512",       256,  10, setup_lanes,        run_lanes,            (uint8_t)sha256_lanes_isa_t::AVX512 },
+#endif
+    { "hash_below_target",  4096, 15, setup_below_target, run_below_target,     0 },
+    { "hex_to_bytes_32",    1024, 15, setup_client,       run_hex_to_bytes,     0 },
+    { "bytes_to_hex_32",    1024, 15, setup_client,       run_bytes_to_hex,     0 },
+    { "merkle_root_0",      16,   10, setup_notify,       run_merkle_root,      0 },
+    { "merkle_root_1",      16,   10, setup_notify,       run_merkle_root,      1 },
+    { "merkle_root_4",      16,   10, setup_notify,       run_merkle_root,      4 },
+    { "merkle_root_8",      16,   10, setup_notify,       run_merkle_root,      8 },
+    { "merkle_root_12",     16,   10, setup_notify,       run_merkle_root,      BENCH_MAX_DEPTH },
+    { "notify_parse_0",     8,    20, setup_notify,       run_notify,           0 },
+    { "notify_parse_12",    8,    20, setup_notify,       run_notify,           BENCH_MAX_DEPTH },
+};
+
+static int compare_cycles(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// run every benchmark whose name contains filter
+uint8_t benchmark_run(const char* filter, bench_result_t* results, uint8_t max_results) {
+    uint32_t cycles[BENCH_REPS];
+    float ns_per_cycle = 1000.0f / platform_cycles_per_us();
+    uint8_t count = 0;
+
+    for (size_t b = 0; b < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]) && count < max_results; b++) {
+        const bench_def_t* def = &BENCHMARKS[b];
+        if (filter != NULL && filter[0] != '\0' && strstr(def->name, filter) == NULL) {
+            continue;
+        }
+
+        fill_random(bench_header, sizeof(bench_header));
+        if (def->setup != NULL && !def->setup(def->arg)) {
+            Serial.printf("[bench] %s skipped, not supported here\n", def->name);
+            continue;
+        }
+
+        for (int i = 0; i < BENCH_WARMUP_REPS; i++) {
+            def->run(def->ops, def->arg);
+        }
+        for (int i = 0; i < BENCH_REPS; i++) {
+            uint32_t start = platform_cycles();
+            def->run(def->ops, def->arg);
+            cycles[i] = platform_cycles() - start;
+        }
+
+        // nearest rank percentiles over the repetitions
+        qsort(cycles, BENCH_REPS, sizeof(cycles[0]), compare_cycles);
+        bench_result_t* result = &results[count++];
+        result->name = def->name;
+        result->ops = def->ops;
+        result->reps = BENCH_REPS;
+        result->median_cycles = (float)cycles[BENCH_REPS / 2] / def->ops;
+        result->p99_cycles = (float)cycles[(BENCH_REPS * 99 + 99) / 100 - 1] / def->ops;
+        result->min_cycles = (float)cycles[0] / def->ops;
+        result->median_ns = result->median_cycles * ns_per_cycle;
+        result->baseline_cycles = 0;
+        result->tolerance = def->tolerance;
+        result->regressed = false;
+    }
+
+    return count;
+}
+
+// "[bench]" table on serial
+void benchmark_print(const bench_result_t* results, uint8_t count) {
+    Serial.printf("[bench] %-18s %12s %12s %12s %12s  (cycles per op, %u reps, %lu cycles/us)\n",
+                  "name", "median", "p99", "min", "median ns", BENCH_REPS,
+                  (unsigned long)platform_cycles_per_us());
+    for (uint8_t i = 0; i < count; i++) {
+        const bench_result_t* r = &results[i];
+        Serial.printf("[bench] %-18s %12.1f %12.1f %12.1f %12.1f", r->name, r->median_cycles,
+                      r->p99_cycles, r->min_cycles, r->median_ns);
+        if (r->baseline_cycles > 0) {
+            Serial.printf("  %+6.1f%% vs baseline%s",
+                          (r->median_cycles / r->baseline_cycles - 1.0f) * 100.0f,
+                          r->regressed ? "  REGRESSED" : "");
+        }
+        Serial.println();
+    }
+}
+
+// one json object per line
+void benchmark_print_json(const bench_result_t* results, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        const bench_result_t* r = &results[i];
+        Serial.printf("{\"bench\":\"%s\",\"ops\":%lu,\"reps\":%lu,\"median_cyc\":%.2f,\"p99_cyc\":%.2f,"
+                      "\"min_cyc\":%.2f,\"median_ns\":%.2f,\"baseline_cyc\":%.2f,\"tolerance\":%u,\"regressed\":%s}\n",
+                      r->name, (unsigned long)r->ops, (unsigned long)r->reps, r->median_cycles,
+                      r->p99_cycles, r->min_cycles, r->median_ns, r->baseline_cycles, r->tolerance,
+                      r->regressed ? "true" : "false");
+    }
+}
+
+// baseline lines are "name cycles", unknown names are ignored
+bool benchmark_load_baseline(const char* path, bench_result_t* results, uint8_t count) {
+    PlatformFile file = platform_file_open(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[64];
+    size_t len = 0;
+    int c;
+    do {
+        c = file.read();
+        if (c >= 0 && c != '\n') {
+            if (len < sizeof(line) - 1) {
+                line[len++] = (char)c;
+            }
+            continue;
+        }
+
+        line[len] = '\0';
+        len = 0;
+        char name[40];
+        float cycles;
+        if (sscanf(line, "%39s %f", name, &cycles) != 2) {
+            continue;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            if (strcmp(results[i].name, name) == 0) {
+                results[i].baseline_cycles = cycles;
+            }
+        }
+    } while (c >= 0);
+
+    file.close();
+    return true;
+}
+
+bool benchmark_save_baseline(const char* path, const bench_result_t* results, uint8_t count) {
+    PlatformFile file = platform_file_open(path, "w");
+    if (!file) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%s %.2f\n", results[i].name, results[i].median_cycles);
+        file.write((const uint8_t*)line, len);
+    }
+    file.close();
+    return true;
+}
+
+// median above baseline + tolerance is a regression
+uint8_t benchmark_check(bench_result_t* results, uint8_t count, uint8_t extra_tolerance) {
+    uint8_t regressions = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        bench_result_t* r = &results[i];
+        float limit = r->baseline_cycles * (100 + r->tolerance + extra_tolerance) / 100.0f;
+        r->regressed = r->baseline_cycles > 0 && r->median_cycles > limit;
+        if (r->regressed) {
+            regressions++;
+        }
+    }
+    return regressions;
+}
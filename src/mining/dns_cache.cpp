@@ -0,0 +1,295 @@
+// dns_cache.cpp
+// pool hostname cache - reconnects go straight to the last known address
+
+#include "mining/dns_cache.h"
+#include "platform/platform.h"
+
+#define DNS_CACHE_NVS_NAMESPACE "esp32btcminer"
+#define DNS_CACHE_NVS_KEY "dns_cache"
+
+// nvs record - host and address only, age does not survive a reboot
+struct dns_cache_record_t {
+    char host[DNS_CACHE_HOST_SIZE];
+    uint32_t ip;
+};
+
+// global instance
+DnsCache dns_cache;
+
+// constructor - nvs records are read on first use, nvs is not ready this early
+DnsCache::DnsCache() {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        entries[i].host[0] = '\0';
+        entries[i].ip = 0;
+        entries[i].resolved_ms = 0;
+        entries[i].fresh = false;
+        entries[i].refresh.store((uint8_t)dns_refresh_t::IDLE);
+        entries[i].refresh_ip = 0;
+    }
+    loaded = false;
+    dirty = false;
+}
+
+// address for host - cached one right away, blocking lookup only on a miss
+bool DnsCache::resolve(const char* host, IPAddress& out) {
+    // literal addresses need no lookup
+    if (out.fromString(host)) {
+        return true;
+    }
+
+    load();
+
+    dns_cache_entry_t* entry = find(host);
+    if (entry != NULL && entry->ip != 0) {
+        out = IPAddress(entry->ip);
+
+        // old or from nvs: use it now, look it up again behind our back
+        if (!entry->fresh || millis() - entry->resolved_ms > DNS_CACHE_TTL) {
+            start_refresh(entry);
+        }
+        return true;
+    }
+
+    unsigned long start = millis();
+    if (!platform_resolve(host, out)) {
+        Serial.print("[dns] lookup failed: ");
+        Serial.println(host);
+        return false;
+    }
+
+    Serial.print("[dns] ");
+    Serial.print(host);
+    Serial.print(" -> ");
+    Serial.print(out.toString().c_str());
+    Serial.print(" (");
+    Serial.print(millis() - start);
+    Serial.println(" ms)");
+
+    if (entry == NULL) {
+        entry = add(host);
+    }
+    if (entry != NULL) {
+        store(entry, (uint32_t)out);
+    }
+    save();
+    return true;
+}
+
+// connect through the cache, retry once with a fresh lookup if a cached address fails
+bool DnsCache::connect(Client& client, const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!resolve(host, ip)) {
+        return false;
+    }
+
+    if (client.connect(ip, port)) {
+        return true;
+    }
+
+    // the address may have moved - unless it is a literal or was looked up
+    // recently, then the host itself is down and another lookup won't help
+    dns_cache_entry_t* entry = find(host);
+    if (entry == NULL || (entry->fresh && millis() - entry->resolved_ms < DNS_CACHE_RECHECK_AGE)) {
+        return false;
+    }
+
+    Serial.print("[dns] cached address for ");
+    Serial.print(host);
+    Serial.println(" failed, looking it up again");
+    invalidate(host);
+
+    if (!resolve(host, ip)) {
+        return false;
+    }
+    return client.connect(ip, port);
+}
+
+// start a background lookup, the answer lands in the cache
+void DnsCache::prefetch(const char* host) {
+    IPAddress literal;
+    if (literal.fromString(host)) {
+        return;
+    }
+
+    load();
+
+    dns_cache_entry_t* entry = find(host);
+    if (entry == NULL) {
+        entry = add(host);
+    }
+    if (entry != NULL) {
+        start_refresh(entry);
+    }
+}
+
+// forget the address of host, a lookup in flight still lands
+void DnsCache::invalidate(const char* host) {
+    dns_cache_entry_t* entry = find(host);
+    if (entry != NULL) {
+        entry->ip = 0;
+        entry->fresh = false;
+    }
+}
+
+// apply finished background lookups
+void DnsCache::process() {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_cache_entry_t* entry = &entries[i];
+        uint8_t state = entry->refresh.load(std::memory_order_acquire);
+
+        if (state == (uint8_t)dns_refresh_t::DONE) {
+            store(entry, entry->refresh_ip);
+            entry->refresh.store((uint8_t)dns_refresh_t::IDLE, std::memory_order_relaxed);
+        } else if (state == (uint8_t)dns_refresh_t::FAILED) {
+            // keep the old address, it is still the best guess
+            Serial.print("[dns] background lookup failed: ");
+            Serial.println(entry->host);
+            entry->resolved_ms = millis();
+            entry->refresh.store((uint8_t)dns_refresh_t::IDLE, std::memory_order_relaxed);
+        }
+    }
+
+    if (dirty) {
+        save();
+    }
+}
+
+// read nvs records once
+void DnsCache::load() {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+
+    dns_cache_record_t records[DNS_CACHE_SIZE];
+    memset(records, 0, sizeof(records));
+
+    KvStore prefs;
+    prefs.begin(DNS_CACHE_NVS_NAMESPACE, true);  // read-only mode
+    size_t len = prefs.getBytes(DNS_CACHE_NVS_KEY, records, sizeof(records));
+    prefs.end();
+
+    if (len != sizeof(records)) {
+        return;
+    }
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        records[i].host[DNS_CACHE_HOST_SIZE - 1] = '\0';
+        if (records[i].host[0] == '\0' || find(records[i].host) != NULL) {
+            continue;
+        }
+
+        // nvs records are used, but refreshed on first use
+        dns_cache_entry_t* entry = add(records[i].host);
+        if (entry != NULL) {
+            entry->ip = records[i].ip;
+            entry->fresh = false;
+        }
+    }
+
+    // nothing changed yet, these are what nvs already holds
+    dirty = false;
+}
+
+// write records to nvs - only when an address changed, to spare the flash
+void DnsCache::save() {
+    if (!dirty) {
+        return;
+    }
+    dirty = false;
+
+    dns_cache_record_t records[DNS_CACHE_SIZE];
+    memset(records, 0, sizeof(records));
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        memcpy(records[i].host, entries[i].host, DNS_CACHE_HOST_SIZE);
+        records[i].ip = entries[i].ip;
+    }
+
+    KvStore prefs;
+    prefs.begin(DNS_CACHE_NVS_NAMESPACE, false);  // read-write mode
+    prefs.putBytes(DNS_CACHE_NVS_KEY, records, sizeof(records));
+    prefs.end();
+}
+
+// find entry by host name
+dns_cache_entry_t* DnsCache::find(const char* host) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].host[0] != '\0' && strcmp(entries[i].host, host) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// take a free slot, or the least recently resolved one without a lookup in flight
+dns_cache_entry_t* DnsCache::add(const char* host) {
+    if (strlen(host) >= DNS_CACHE_HOST_SIZE) {
+        return NULL;
+    }
+
+    dns_cache_entry_t* slot = NULL;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_cache_entry_t* entry = &entries[i];
+        if (entry->refresh.load() == (uint8_t)dns_refresh_t::PENDING) {
+            continue;
+        }
+        if (entry->host[0] == '\0') {
+            slot = entry;
+            break;
+        }
+        if (slot == NULL || (int32_t)(entry->resolved_ms - slot->resolved_ms) < 0) {
+            slot = entry;
+        }
+    }
+
+    if (slot != NULL) {
+        strcpy(slot->host, host);
+        slot->ip = 0;
+        slot->resolved_ms = 0;
+        slot->fresh = false;
+        slot->refresh.store((uint8_t)dns_refresh_t::IDLE);
+        dirty = true;
+    }
+    return slot;
+}
+
+// record an answer, nvs is only rewritten when the address changed
+void DnsCache::store(dns_cache_entry_t* entry, uint32_t ip) {
+    if (entry->ip != ip) {
+        if (entry->ip != 0) {
+            Serial.print("[dns] ");
+            Serial.print(entry->host);
+            Serial.print(" moved to ");
+            Serial.println(IPAddress(ip).toString().c_str());
+        }
+        entry->ip = ip;
+        dirty = true;
+    }
+    entry->resolved_ms = millis();
+    entry->fresh = true;
+}
+
+// start a background lookup, entry->host stays put while it is PENDING
+void DnsCache::start_refresh(dns_cache_entry_t* entry) {
+    uint8_t expected = (uint8_t)dns_refresh_t::IDLE;
+    if (!entry->refresh.compare_exchange_strong(expected, (uint8_t)dns_refresh_t::PENDING)) {
+        return;
+    }
+
+    if (!platform_resolve_async(entry->host, lookup_done, entry)) {
+        entry->refresh.store((uint8_t)dns_refresh_t::IDLE);
+    }
+}
+
+// lookup thread (lwip on the esp32) - answered, or ip 0 on failure
+void DnsCache::lookup_done(uint32_t ip, void* arg) {
+    dns_cache_entry_t* entry = (dns_cache_entry_t*)arg;
+
+    if (ip == 0) {
+        entry->refresh.store((uint8_t)dns_refresh_t::FAILED, std::memory_order_release);
+        return;
+    }
+
+    entry->refresh_ip = ip;
+    entry->refresh.store((uint8_t)dns_refresh_t::DONE, std::memory_order_release);
+}
@@ -0,0 +1,162 @@
+// hashrate_history.cpp
+// fixed-size hashrate time series with ewma estimators
+
+#include "mining/hashrate_history.h"
+
+// ewma smoothing factors for one sample per second: 1 - exp(-1 / window_seconds)
+#define EWMA_ALPHA_1M 0.016529302f
+#define EWMA_ALPHA_5M 0.003327773f
+#define EWMA_ALPHA_15M 0.001110494f
+
+// constructor - start with empty history
+HashrateHistory::HashrateHistory() {
+    reset(0, 0);
+}
+
+// clear history and start counting from the given hash total
+void HashrateHistory::reset(uint64_t total_hashes, unsigned long now_ms) {
+    memset(seconds, 0, sizeof(seconds));
+    second_head = 0;
+    second_count = 0;
+    seconds_recorded = 0;
+
+    memset(minutes, 0, sizeof(minutes));
+    minute_head = 0;
+    minute_count = 0;
+    minute_accum = 0;
+    minute_seconds = 0;
+
+    ewma_1m = 0.0f;
+    ewma_5m = 0.0f;
+    ewma_15m = 0.0f;
+
+    last_total = total_hashes;
+    second_start_ms = now_ms;
+}
+
+// feed the current hash total and close every whole second that has elapsed
+void HashrateHistory::update(uint64_t total_hashes, unsigned long now_ms) {
+    unsigned long elapsed_ms = now_ms - second_start_ms;
+
+    if (elapsed_ms < 1000) {
+        return;
+    }
+
+    uint32_t elapsed_seconds = elapsed_ms / 1000;
+    uint64_t delta = total_hashes - last_total;
+
+    // if the caller stalled for several seconds, spread the hashes evenly
+    // anything older than the second ring is irrelevant, so cap the loop
+    uint32_t push_count = min(elapsed_seconds, (uint32_t)HASHRATE_HISTORY_SECONDS);
+    uint32_t per_second = delta / elapsed_seconds;
+    uint32_t remainder = delta - (uint64_t)per_second * elapsed_seconds;
+
+    for (uint32_t i = 0; i < push_count; i++) {
+        // last pushed second gets the rounding remainder
+        push_second(i == push_count - 1 ? per_second + remainder : per_second);
+    }
+
+    last_total = total_hashes;
+    second_start_ms += elapsed_seconds * 1000;
+}
+
+// record one closed second
+void HashrateHistory::push_second(uint32_t hashes) {
+    seconds[second_head] = hashes;
+    second_head = (second_head + 1) % HASHRATE_HISTORY_SECONDS;
+    if (second_count < HASHRATE_HISTORY_SECONDS) {
+        second_count++;
+    }
+
+    // seed estimators with the first sample so they don't ramp up from zero
+    float rate = (float)hashes;
+    if (seconds_recorded == 0) {
+        ewma_1m = rate;
+        ewma_5m = rate;
+        ewma_15m = rate;
+    } else {
+        ewma_1m += EWMA_ALPHA_1M * (rate - ewma_1m);
+        ewma_5m += EWMA_ALPHA_5M * (rate - ewma_5m);
+        ewma_15m += EWMA_ALPHA_15M * (rate - ewma_15m);
+    }
+    seconds_recorded++;
+
+    // roll seconds up into minute buckets
+    minute_accum += hashes;
+    minute_seconds++;
+
+    if (minute_seconds >= 60) {
+        minutes[minute_head] = minute_accum;
+        minute_head = (minute_head + 1) % HASHRATE_HISTORY_MINUTES;
+        if (minute_count < HASHRATE_HISTORY_MINUTES) {
+            minute_count++;
+        }
+        minute_accum = 0;
+        minute_seconds = 0;
+    }
+}
+
+// get ewma hashrate for the given window
+float HashrateHistory::get_ewma(hashrate_window_t window) {
+    switch (window) {
+        case hashrate_window_t::EWMA_1M:
+            return ewma_1m;
+        case hashrate_window_t::EWMA_5M:
+            return ewma_5m;
+        case hashrate_window_t::EWMA_15M:
+            return ewma_15m;
+    }
+    return 0.0f;
+}
+
+// get mean hashrate over the last n recorded seconds
+float HashrateHistory::get_average(uint32_t count) {
+    if (count > second_count) {
+        count = second_count;
+    }
+    if (count == 0) {
+        return 0.0f;
+    }
+
+    uint64_t sum = 0;
+    uint16_t index = second_head;
+    for (uint32_t i = 0; i < count; i++) {
+        index = (index + HASHRATE_HISTORY_SECONDS - 1) % HASHRATE_HISTORY_SECONDS;
+        sum += seconds[index];
+    }
+
+    return (float)sum / count;
+}
+
+// get how many seconds have been recorded since reset
+uint32_t HashrateHistory::get_seconds_recorded() {
+    return seconds_recorded;
+}
+
+// copy the newest entries of a ring buffer in chronological order
+template <typename T>
+uint16_t HashrateHistory::copy_ring(const T* ring, uint16_t size, uint16_t head, uint16_t valid,
+                                    T* out, uint16_t count) {
+    if (count > valid) {
+        count = valid;
+    }
+
+    // start count entries behind the write head
+    uint16_t index = (head + size - count) % size;
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = ring[index];
+        index = (index + 1) % size;
+    }
+
+    return count;
+}
+
+// copy most recent per-second buckets (oldest first)
+uint16_t HashrateHistory::get_second_history(uint32_t* out, uint16_t count) {
+    return copy_ring(seconds, HASHRATE_HISTORY_SECONDS, second_head, second_count, out, count);
+}
+
+// copy most recent per-minute buckets (oldest first)
+uint16_t HashrateHistory::get_minute_history(uint64_t* out, uint16_t count) {
+    return copy_ring(minutes, HASHRATE_HISTORY_MINUTES, minute_head, minute_count, out, count);
+}
@@ -0,0 +1,329 @@
+// log_ring.cpp
+// lock-free log ring, formatted and printed by a low priority task
+
+#include "mining/log_ring.h"
+#include "platform/platform.h"
+
+#define LOG_MAX_SLOTS (LOG_RING_SLOTS / 4)   // one record, larger ones are dropped
+#define LOG_RECORD_SIZE (LOG_MAX_SLOTS * LOG_SLOT_DATA)
+
+// a slot is free for ring position p while seq == p, holds the record
+// written at p once seq == p + 1, and is handed back as p + LOG_RING_SLOTS
+struct log_slot_t {
+    std::atomic<uint32_t> seq;
+    uint8_t data[LOG_SLOT_DATA];
+};
+
+// first bytes of every record, the arguments follow
+struct log_header_t {
+    const char* fmt;
+    uint16_t len;                       // argument bytes
+    uint8_t level;
+    uint8_t slots;
+};
+
+static_assert(sizeof(log_slot_t) == 32, "log slots should stay 32 bytes");
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+std::atomic<uint8_t> log_level((uint8_t)log_level_t::INFO);
+
+static log_slot_t ring[LOG_RING_SLOTS];
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> tail(0);   // written by the drain task only
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> started(false);
+
+// drain task only
+static uint8_t record[LOG_RECORD_SIZE];
+static char line[LOG_LINE_SIZE + 2];
+
+static struct log_ring_init_t {
+    log_ring_init_t() {
+        for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+            ring[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+} log_ring_init;
+
+// ----- producers -----
+
+bool LogWriter::reserve(log_level_t level, const char* fmt) {
+    uint32_t total = sizeof(log_header_t) + size;
+    slots = (total + LOG_SLOT_DATA - 1) / LOG_SLOT_DATA;
+    if (slots > LOG_MAX_SLOTS) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // the slots below the last one were freed before it, in ring order
+    uint32_t first = head.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t last = first + slots - 1;
+        uint32_t seq = ring[last & (LOG_RING_SLOTS - 1)].seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - last);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(first, first + slots, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the drain task is a full ring behind
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            first = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    pos = first;
+    offset = 0;
+    writing = true;
+
+    log_header_t header;
+    header.fmt = fmt;
+    header.len = (uint16_t)size;
+    header.level = (uint8_t)level;
+    header.slots = (uint8_t)slots;
+    copy(&header, sizeof(header));
+    return true;
+}
+
+void LogWriter::copy(const void* data, size_t len) {
+    const uint8_t* src = (const uint8_t*)data;
+    while (len > 0) {
+        uint32_t slot = pos + offset / LOG_SLOT_DATA;
+        uint32_t at = offset % LOG_SLOT_DATA;
+        size_t n = LOG_SLOT_DATA - at;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ring[slot & (LOG_RING_SLOTS - 1)].data + at, src, n);
+        src += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+// the first slot last, the drain task reads the record once it sees that one
+void LogWriter::commit() {
+    for (uint32_t i = 1; i < slots; i++) {
+        ring[(pos + i) & (LOG_RING_SLOTS - 1)].seq.store(pos + i + 1, std::memory_order_release);
+    }
+    ring[pos & (LOG_RING_SLOTS - 1)].seq.store(pos + 1, std::memory_order_release);
+}
+
+// ----- formatting -----
+
+// append one conversion, spec is the flags, width and precision between % and conv
+static size_t format_arg(char* out, size_t cap, const char* spec, size_t spec_len, char conv,
+                         log_arg_t tag, const uint8_t* value, uint16_t str_len) {
+    char f[24];
+    if (spec_len > sizeof(f) - 5) {
+        spec_len = sizeof(f) - 5;
+    }
+    f[0] = '%';
+    memcpy(f + 1, spec, spec_len);
+    size_t n = 1 + spec_len;
+
+    bool is_int = strchr("diuxXoc", conv) != NULL;
+    bool is_float = strchr("fFeEgG", conv) != NULL;
+    int written = -1;
+
+    if (tag == log_arg_t::STR && conv == 's') {
+        // the copy is not null-terminated, a precision bounds it
+        const char* dot = (const char*)memchr(spec, '.', spec_len);
+        int precision = str_len;
+        if (dot != NULL) {
+            int wanted = atoi(dot + 1);
+            precision = wanted < precision ? wanted : precision;
+            n = 1 + (dot - spec);
+        }
+        f[n++] = '.';
+        f[n++] = '*';
+        f[n++] = 's';
+        f[n] = '\0';
+        written = snprintf(out, cap, f, precision, (const char*)value);
+    } else if (is_int && tag != log_arg_t::STR && tag != log_arg_t::F64) {
+        bool wide = tag == log_arg_t::I64 || tag == log_arg_t::U64;
+        if (wide && conv != 'c') {
+            f[n++] = 'l';
+            f[n++] = 'l';
+        }
+        f[n++] = conv;
+        f[n] = '\0';
+        switch (tag) {
+            case log_arg_t::I32: { int32_t v; memcpy(&v, value, 4); written = snprintf(out, cap, f, (int)v); break; }
+            case log_arg_t::U32: { uint32_t v; memcpy(&v, value, 4); written = snprintf(out, cap, f, (unsigned)v); break; }
+            case log_arg_t::I64: { int64_t v; memcpy(&v, value, 8); written = snprintf(out, cap, f, (long long)v); break; }
+            default: { uint64_t v; memcpy(&v, value, 8); written = snprintf(out, cap, f, (unsigned long long)v); break; }
+        }
+    } else if (is_float && tag == log_arg_t::F64) {
+        double v;
+        memcpy(&v, value, 8);
+        f[n++] = conv;
+        f[n] = '\0';
+        written = snprintf(out, cap, f, v);
+    } else {
+        // argument does not fit the conversion
+        written = snprintf(out, cap, "?");
+    }
+
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < cap ? (size_t)written : cap - 1;
+}
+
+// rebuild the line from the format and the tagged arguments
+static size_t format_record(const log_header_t* header, const uint8_t* args, char* out, size_t cap) {
+    const char* p = header->fmt;
+    const uint8_t* arg = args;
+    const uint8_t* args_end = args + header->len;
+    size_t len = 0;
+
+    while (*p != '\0' && len + 1 < cap) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conv, lengths are ignored
+        const char* start = p;
+        const char* spec = ++p;
+        while (*p != '\0' && strchr("-+ #0", *p) != NULL) p++;
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p == '.') {
+            p++;
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        size_t spec_len = p - spec;
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) p++;
+        char conv = *p;
+        if (conv == '\0') {
+            break;
+        }
+        p++;
+
+        if (arg >= args_end) {
+            // more conversions than arguments, print the spec itself
+            size_t n = p - start;
+            if (n > cap - 1 - len) {
+                n = cap - 1 - len;
+            }
+            memcpy(out + len, start, n);
+            len += n;
+            continue;
+        }
+
+        log_arg_t tag = (log_arg_t)*arg++;
+        const uint8_t* value = arg;
+        uint16_t str_len = 0;
+        if (tag == log_arg_t::STR) {
+            memcpy(&str_len, arg, 2);
+            value = arg + 2;
+            arg += 2 + str_len;
+        } else if (tag == log_arg_t::I32 || tag == log_arg_t::U32) {
+            arg += 4;
+        } else {
+            arg += 8;
+        }
+        len += format_arg(out + len, cap - len, spec, spec_len, conv, tag, value, str_len);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// ----- drain task -----
+
+// print the oldest record, false when there is none ready
+static bool drain_one() {
+    uint32_t first = tail.load(std::memory_order_relaxed);
+    log_slot_t* slot = &ring[first & (LOG_RING_SLOTS - 1)];
+    if (slot->seq.load(std::memory_order_acquire) != first + 1) {
+        return false;
+    }
+
+    log_header_t header;
+    memcpy(&header, slot->data, sizeof(header));
+    size_t total = sizeof(header) + header.len;
+    for (uint32_t i = 0; i < header.slots; i++) {
+        size_t at = i * LOG_SLOT_DATA;
+        size_t n = total - at < LOG_SLOT_DATA ? total - at : LOG_SLOT_DATA;
+        memcpy(record + at, ring[(first + i) & (LOG_RING_SLOTS - 1)].data, n);
+    }
+
+    // hand the slots back before the slow part
+    for (uint32_t i = 0; i < header.slots; i++) {
+        uint32_t p = first + i;
+        ring[p & (LOG_RING_SLOTS - 1)].seq.store(p + LOG_RING_SLOTS, std::memory_order_release);
+    }
+
+    size_t len = format_record(&header, record + sizeof(header), line, LOG_LINE_SIZE);
+    line[len++] = '\r';
+    line[len++] = '\n';
+    Serial.write((const uint8_t*)line, len);
+
+    // log_flush() waits for this
+    tail.store(first + header.slots, std::memory_order_release);
+    return true;
+}
+
+static void log_task_function(void* parameter) {
+    uint32_t reported = 0;
+    for (;;) {
+        if (drain_one()) {
+            continue;
+        }
+        uint32_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reported) {
+            Serial.printf("[log] ring full, %lu messages dropped (%lu total)\n",
+                          (unsigned long)(lost - reported), (unsigned long)lost);
+            reported = lost;
+        }
+        delay(LOG_DRAIN_IDLE_MS);
+    }
+}
+
+void log_begin() {
+    if (started.exchange(true)) {
+        return;
+    }
+#if defined(PLATFORM_NATIVE)
+    int core = -1;
+#else
+    int core = platform_core_count() - 1;   // away from the first mining worker
+#endif
+    platform_task_t handle;
+    if (!platform_task_create(log_task_function, "log", LOG_TASK_STACK_SIZE, NULL,
+                              LOG_TASK_PRIORITY, core, &handle)) {
+        Serial.println("[log] failed to create drain task");
+        started.store(false);
+    }
+}
+
+void log_set_level(log_level_t level) {
+    log_level.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+log_level_t log_get_level() {
+    return (log_level_t)log_level.load(std::memory_order_relaxed);
+}
+
+uint32_t log_get_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+bool log_flush(uint32_t timeout_ms) {
+    unsigned long start = millis();
+    while (tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed)) {
+        if (!started.load() || millis() - start >= timeout_ms) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+// profiler.cpp
+// scoped cycle timers for the hot paths, collected into log2 histograms
+
+#include "mining/profiler.h"
+
+#if defined(ESP32BTCMINER_PROFILE)
+
+profile_histogram_t profile_histograms[PROFILE_ROWS][(int)profile_zone_t::COUNT];
+
+#if defined(PLATFORM_NATIVE)
+thread_local int profile_thread_row = -1;
+static std::atomic<int> profile_next_row(0);
+
+// first record of this thread - take the next free row
+int profile_assign_row() {
+    int row = profile_next_row.fetch_add(1, std::memory_order_relaxed);
+    profile_thread_row = row < PROFILE_ROWS ? row : PROFILE_ROWS - 1;
+    return profile_thread_row;
+}
+
+#define PROFILE_ROW_NAME "thread"
+#else
+#define PROFILE_ROW_NAME "core"
+#endif
+
+static const char* const ZONE_NAMES[(int)profile_zone_t::COUNT] = {
+    "mine_nonce_range",
+    "update_work",
+    "merkle_root",
+    "process_line",
+    "submit_share",
+    "ui_draw",
+};
+
+static unsigned long last_report_ms = 0;
+
+// smallest bucket bound with at least fraction of the calls below it (cycles)
+static uint64_t histogram_percentile(const uint32_t* buckets, uint32_t count, float fraction) {
+    uint32_t rank = (uint32_t)(count * fraction);
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    uint32_t seen = 0;
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return 2ull << i;
+        }
+    }
+    return 2ull << (PROFILE_BUCKETS - 1);
+}
+
+// one line per zone and core that ran, then the non-empty buckets
+// percentiles are bucket bounds, so read p99 "< 4.2 ms" as "under 4.2 ms"
+void profiler_print(uint32_t window_ms) {
+    float cycles_per_us = platform_cycles_per_us();
+    float window_cycles = window_ms * 1000.0f * cycles_per_us;
+
+    Serial.printf("[profile] last %lu ms, times in us\n", (unsigned long)window_ms);
+    for (int row = 0; row < PROFILE_ROWS; row++) {
+        for (int zone = 0; zone < (int)profile_zone_t::COUNT; zone++) {
+            profile_histogram_t* h = &profile_histograms[row][zone];
+
+            // a snapshot, calls that land meanwhile show up in the next window
+            uint32_t buckets[PROFILE_BUCKETS];
+            uint32_t count = 0;
+            int first = -1;
+            int last = -1;
+            for (int i = 0; i < PROFILE_BUCKETS; i++) {
+                buckets[i] = h->buckets[i].load(std::memory_order_relaxed);
+                count += buckets[i];
+                if (buckets[i] > 0) {
+                    first = first < 0 ? i : first;
+                    last = i;
+                }
+            }
+            if (count == 0) {
+                continue;
+            }
+            uint64_t total = h->total_cycles.load(std::memory_order_relaxed);
+            uint32_t max = h->max_cycles.load(std::memory_order_relaxed);
+
+            Serial.printf("[profile] %s%d %-16s n %-7lu busy %5.1f%%  mean %9.1f  p50 <%9.1f  p99 <%9.1f  max %9.1f\n",
+                          PROFILE_ROW_NAME, row, ZONE_NAMES[zone], (unsigned long)count,
+                          window_cycles > 0 ? total * 100.0f / window_cycles : 0.0f,
+                          total / cycles_per_us / count,
+                          histogram_percentile(buckets, count, 0.50f) / cycles_per_us,
+                          histogram_percentile(buckets, count, 0.99f) / cycles_per_us,
+                          max / cycles_per_us);
+
+            Serial.printf("[profile]   2^%d..2^%d cycles:", first, last);
+            for (int i = first; i <= last; i++) {
+                Serial.printf(" %lu", (unsigned long)buckets[i]);
+            }
+            Serial.println();
+        }
+    }
+}
+
+void profiler_reset() {
+    for (int row = 0; row < PROFILE_ROWS; row++) {
+        for (int zone = 0; zone < (int)profile_zone_t::COUNT; zone++) {
+            profile_histogram_t* h = &profile_histograms[row][zone];
+            for (int i = 0; i < PROFILE_BUCKETS; i++) {
+                h->buckets[i].store(0, std::memory_order_relaxed);
+            }
+            h->total_cycles.store(0, std::memory_order_relaxed);
+            h->max_cycles.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// main loop - print and start a new window
+void profiler_report_if_due() {
+    unsigned long now = millis();
+    if (now - last_report_ms < PROFILE_REPORT_MS) {
+        return;
+    }
+    profiler_print(now - last_report_ms);
+    profiler_reset();
+    last_report_ms = now;
+}
+
+#endif
@@ -0,0 +1,262 @@
+// sha256_lanes.cpp
+// multi-lane sha256d nonce scanner for x86 linux builds
+
+#include "mining/sha256_lanes.h"
+
+#if defined(SHA256_LANES_AVAILABLE)
+
+#include <stdlib.h>
+
+// round constants, shared with the software kernel in sha256_miner.cpp
+extern const uint32_t SHA256_K[64];
+
+static const uint32_t SHA256_IV[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// one uint32_t per lane, gcc vector extensions keep a single source for both widths
+typedef uint32_t lanes4_t __attribute__((vector_size(16)));
+typedef uint32_t lanes8_t __attribute__((vector_size(32)));
+typedef uint32_t lanes16_t __attribute__((vector_size(64)));
+
+// everything below is inlined into the isa specific scan functions, so the
+// 8-lane instantiation is compiled for avx2 only where the caller allows it
+#define LANES_INLINE static inline __attribute__((always_inline))
+
+// a macro, not a function: returning a wide vector from non-avx code changes the abi
+// avx512 compiles this to a single rotate, sse2 and avx2 need two shifts and an or
+#define LANES_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// rounds 0..rounds-1 of the compression function on the working state s[8]
+// w[16] is the message block, the schedule is expanded in place
+template <typename V>
+LANES_INLINE void lanes_rounds(V* s, V* w, int rounds) {
+  V a = s[0], b = s[1], c = s[2], d = s[3];
+  V e = s[4], f = s[5], g = s[6], h = s[7];
+
+#pragma GCC unroll 64
+  for (int i = 0; i < rounds; i++) {
+    if (i >= 16) {
+      V w15 = w[(i + 1) & 15];
+      V w2 = w[(i + 14) & 15];
+      V s0 = LANES_ROTR(w15, 7) ^ LANES_ROTR(w15, 18) ^ (w15 >> 3);
+      V s1 = LANES_ROTR(w2, 17) ^ LANES_ROTR(w2, 19) ^ (w2 >> 10);
+      w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+    }
+
+    V t1 = h + (LANES_ROTR(e, 6) ^ LANES_ROTR(e, 11) ^ LANES_ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+           SHA256_K[i] + w[i & 15];
+    V t2 = (LANES_ROTR(a, 2) ^ LANES_ROTR(a, 13) ^ LANES_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  s[0] = a; s[1] = b; s[2] = c; s[3] = d;
+  s[4] = e; s[5] = f; s[6] = g; s[7] = h;
+}
+
+// FULL runs all 64 rounds of the second hash and writes every lane's digest,
+// for checking the kernel against sha256d - mining only needs the top word
+template <typename V, int LANES, bool FULL>
+LANES_INLINE void lanes_scan(const uint32_t* midstate, const uint32_t* tail,
+                             uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]) {
+  V zero = {};
+  V state[8];
+  V w[16];
+
+  // second block of the header: bytes 64-79, padding, length 640 bits
+  // the nonce is little-endian in the header, sha256 reads it big-endian
+  w[0] = zero + tail[0];
+  w[1] = zero + tail[1];
+  w[2] = zero + tail[2];
+  for (int lane = 0; lane < LANES; lane++) {
+    w[3][lane] = __builtin_bswap32(first_nonce + lane);
+  }
+  w[4] = zero + 0x80000000;
+  for (int i = 5; i < 15; i++) {
+    w[i] = zero;
+  }
+  w[15] = zero + 640;
+
+  for (int i = 0; i < 8; i++) {
+    state[i] = zero + midstate[i];
+  }
+  lanes_rounds(state, w, 64);
+
+  // first hash becomes the message of the second, one padded block of 256 bits
+  for (int i = 0; i < 8; i++) {
+    w[i] = state[i] + midstate[i];
+  }
+  w[8] = zero + 0x80000000;
+  for (int i = 9; i < 15; i++) {
+    w[i] = zero;
+  }
+  w[15] = zero + 256;
+
+  for (int i = 0; i < 8; i++) {
+    state[i] = zero + SHA256_IV[i];
+  }
+  V top;
+  if (FULL) {
+    lanes_rounds(state, w, 64);
+    for (int i = 0; i < 8; i++) {
+      V word = state[i] + SHA256_IV[i];
+      for (int lane = 0; lane < LANES; lane++) {
+        uint32_t be = __builtin_bswap32(word[lane]);
+        memcpy(hashes[lane] + i * 4, &be, 4);
+      }
+    }
+    top = state[7] + SHA256_IV[7];
+  } else {
+    // early reject: the last state word is e after round 60, rounds 61-63 only
+    // shift it down to h, so three rounds and seven output words are skipped
+    lanes_rounds(state, w, 61);
+    top = state[4] + SHA256_IV[7];
+  }
+
+  // hash bytes 28-31 are this word big-endian, top_word reads them little-endian
+  for (int lane = 0; lane < LANES; lane++) {
+    top_words[lane] = __builtin_bswap32(top[lane]);
+  }
+}
+
+static void scan_sse2(const uint32_t* midstate, const uint32_t* tail,
+                      uint32_t first_nonce, uint32_t* top_words) {
+  lanes_scan<lanes4_t, 4, false>(midstate, tail, first_nonce, top_words, NULL);
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(const uint32_t* midstate, const uint32_t* tail,
+                      uint32_t first_nonce, uint32_t* top_words) {
+  lanes_scan<lanes8_t, 8, false>(midstate, tail, first_nonce, top_words, NULL);
+}
+
+__attribute__((target("avx512f")))
+static void scan_avx512(const uint32_t* midstate, const uint32_t* tail,
+                        uint32_t first_nonce, uint32_t* top_words) {
+  lanes_scan<lanes16_t, 16, false>(midstate, tail, first_nonce, top_words, NULL);
+}
+
+static void hash_sse2(const uint32_t* midstate, const uint32_t* tail,
+                      uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]) {
+  lanes_scan<lanes4_t, 4, true>(midstate, tail, first_nonce, top_words, hashes);
+}
+
+__attribute__((target("avx2")))
+static void hash_avx2(const uint32_t* midstate, const uint32_t* tail,
+                      uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]) {
+  lanes_scan<lanes8_t, 8, true>(midstate, tail, first_nonce, top_words, hashes);
+}
+
+__attribute__((target("avx512f")))
+static void hash_avx512(const uint32_t* midstate, const uint32_t* tail,
+                        uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]) {
+  lanes_scan<lanes16_t, 16, true>(midstate, tail, first_nonce, top_words, hashes);
+}
+
+// best isa this cpu supports, ESP32BTCMINER_LANES=avx512|avx2|sse2|off caps it
+sha256_lanes_isa_t sha256_lanes_detect() {
+  // cpuid leaf 7 plus the os xsave check, both done by the compiler runtime
+  __builtin_cpu_init();
+  sha256_lanes_isa_t isa = sha256_lanes_isa_t::SSE2;
+  if (__builtin_cpu_supports("avx512f")) {
+    isa = sha256_lanes_isa_t::AVX512;
+  } else if (__builtin_cpu_supports("avx2")) {
+    isa = sha256_lanes_isa_t::AVX2;
+  }
+
+  const char* cap = getenv("ESP32BTCMINER_LANES");
+  if (cap != NULL) {
+    sha256_lanes_isa_t limit = isa;
+    if (strcmp(cap, "off") == 0) {
+      limit = sha256_lanes_isa_t::NONE;
+    } else if (strcmp(cap, "sse2") == 0) {
+      limit = sha256_lanes_isa_t::SSE2;
+    } else if (strcmp(cap, "avx2") == 0) {
+      limit = sha256_lanes_isa_t::AVX2;
+    } else if (strcmp(cap, "avx512") == 0) {
+      limit = sha256_lanes_isa_t::AVX512;
+    }
+    if (limit < isa) {
+      isa = limit;
+    }
+  }
+
+  return isa;
+}
+
+// lanes per scan call
+uint8_t sha256_lanes_count(sha256_lanes_isa_t isa) {
+  switch (isa) {
+    case sha256_lanes_isa_t::AVX512: return 16;
+    case sha256_lanes_isa_t::AVX2: return 8;
+    case sha256_lanes_isa_t::SSE2: return 4;
+    case sha256_lanes_isa_t::NONE: return 0;
+  }
+  return 0;
+}
+
+// short isa name for logs
+const char* sha256_lanes_name(sha256_lanes_isa_t isa) {
+  switch (isa) {
+    case sha256_lanes_isa_t::AVX512: return "avx512";
+    case sha256_lanes_isa_t::AVX2: return "avx2";
+    case sha256_lanes_isa_t::SSE2: return "sse2";
+    case sha256_lanes_isa_t::NONE: return "off";
+  }
+  return "?";
+}
+
+// sha256 state after the first 64 header bytes and the big-endian words of bytes 64-75
+// the same for every nonce, the lane kernel starts from here
+void sha256_lanes_prepare(const uint8_t* header, uint32_t* midstate, uint32_t* tail) {
+  uint32_t w[16];
+  for (int i = 0; i < 16; i++) {
+    const uint8_t* p = header + i * 4;
+    w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  }
+  uint32_t state[8];
+  memcpy(state, SHA256_IV, sizeof(state));
+  lanes_rounds(state, w, 64);
+  for (int i = 0; i < 8; i++) {
+    midstate[i] = state[i] + SHA256_IV[i];
+  }
+
+  for (int i = 0; i < 3; i++) {
+    const uint8_t* p = header + 64 + i * 4;
+    tail[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  }
+}
+
+// top word of sha256d(header) for each lane's nonce
+void sha256_lanes_scan(sha256_lanes_isa_t isa, const uint32_t* midstate, const uint32_t* tail,
+                       uint32_t first_nonce, uint32_t* top_words) {
+  if (isa == sha256_lanes_isa_t::AVX512) {
+    scan_avx512(midstate, tail, first_nonce, top_words);
+  } else if (isa == sha256_lanes_isa_t::AVX2) {
+    scan_avx2(midstate, tail, first_nonce, top_words);
+  } else {
+    scan_sse2(midstate, tail, first_nonce, top_words);
+  }
+}
+
+// full sha256d of each lane's header, no early reject
+void sha256_lanes_hash(sha256_lanes_isa_t isa, const uint32_t* midstate, const uint32_t* tail,
+                       uint32_t first_nonce, uint32_t* top_words, uint8_t (*hashes)[32]) {
+  if (isa == sha256_lanes_isa_t::AVX512) {
+    hash_avx512(midstate, tail, first_nonce, top_words, hashes);
+  } else if (isa == sha256_lanes_isa_t::AVX2) {
+    hash_avx2(midstate, tail, first_nonce, top_words, hashes);
+  } else {
+    hash_sse2(midstate, tail, first_nonce, top_words, hashes);
+  }
+}
+
+#endif
@@ -2,8 +2,19 @@
 // bitcoin mining core using esp32 hardware sha256 acceleration
 
 #include "mining/sha256_miner.h"
+#include "mining/sha256_lanes.h"
+#include "platform/platform.h"
+#include "mining/profiler.h"
 
-#include "mbedtls/sha256.h"  // esp32 hardware-accelerated sha256
+#if defined(SHA256_LANES_AVAILABLE)
+// randomized headers the lane kernel is checked against scalar sha256d on at startup
+#define LANES_SELF_TEST_HEADERS 64
+
+// isa mine_nonce_range scans with, NONE = scalar sha256d per nonce
+static sha256_lanes_isa_t lanes_isa = sha256_lanes_isa_t::NONE;
+
+static bool lanes_self_test(sha256_lanes_isa_t isa);
+#endif
 
 // initialize hardware sha256 engine
 void miner_init() {
@@ -12,6 +23,25 @@ void miner_init() {
   // this function exists for future setup needs and startup confirmation
 
   Serial.println("[miner] hardware sha256 ready");
+
+#if defined(SHA256_LANES_AVAILABLE)
+  // a lane kernel that disagrees with sha256d would silently miss shares
+  lanes_isa = sha256_lanes_detect();
+  if (lanes_isa != sha256_lanes_isa_t::NONE && !lanes_self_test(lanes_isa)) {
+    Serial.print("[miner] ");
+    Serial.print(sha256_lanes_name(lanes_isa));
+    Serial.println(" lanes disagree with sha256d, scanning one nonce at a time");
+    lanes_isa = sha256_lanes_isa_t::NONE;
+  }
+
+  if (lanes_isa != sha256_lanes_isa_t::NONE) {
+    Serial.print("[miner] ");
+    Serial.print(sha256_lanes_name(lanes_isa));
+    Serial.print(" ");
+    Serial.print(sha256_lanes_count(lanes_isa));
+    Serial.println("-lane nonce scanner ready");
+  }
+#endif
 }
 
 // compute double sha256 hash (sha256(sha256(data)))
@@ -20,42 +50,130 @@ void sha256d(const uint8_t* data, size_t len, uint8_t* output) {
   // temporary buffer holds result of first hash
   uint8_t first_hash[32];
 
-  // context structure holds internal sha256 computation state
-  // mbedtls uses this pattern: init -> starts -> update -> finish -> free
-  mbedtls_sha256_context ctx;
+  // first pass hashes the input data, second pass the 32-byte result
+  // platform_sha256 is the sha peripheral on the esp32
+  platform_sha256(data, len, first_hash);
+  platform_sha256(first_hash, 32, output);
+}
+
+// round constants for the software kernel, the lane kernel uses them too
+extern const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
 
-  // ----- first sha256 pass: hash the input data -----
+static inline uint32_t rotr32(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
 
-  // initialize context to clean state
-  mbedtls_sha256_init(&ctx);
+// one 64-byte block through the compression function
+static void sha256_soft_block(uint32_t* state, const uint8_t* block) {
+  uint32_t w[64];
 
-  // begin sha256 computation
-  // second parameter: 0 = sha256, 1 = sha224
-  mbedtls_sha256_starts(&ctx, 0);
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+           ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
 
-  // feed input data into the hash computation
-  mbedtls_sha256_update(&ctx, data, len);
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
 
-  // finalize computation and write 32-byte result
-  mbedtls_sha256_finish(&ctx, first_hash);
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) +
+                  SHA256_K[i] + w[i];
+    uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
 
-  // release any resources held by context
-  mbedtls_sha256_free(&ctx);
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
 
-  // ----- second sha256 pass: hash the first result -----
+// single sha256 in software, no hardware or mbedtls involved
+static void sha256_soft(const uint8_t* data, size_t len, uint8_t* output) {
+  uint32_t state[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  uint8_t block[64];
+  size_t pos = 0;
 
-  // reinitialize context for second hash operation
-  mbedtls_sha256_init(&ctx);
-  mbedtls_sha256_starts(&ctx, 0);
+  for (; pos + 64 <= len; pos += 64) {
+    sha256_soft_block(state, data + pos);
+  }
 
-  // input is now the 32-byte result from first hash
-  mbedtls_sha256_update(&ctx, first_hash, 32);
+  // padding: 0x80, zeros, 64-bit big-endian bit length
+  size_t rest = len - pos;
+  memset(block, 0, 64);
+  memcpy(block, data + pos, rest);
+  block[rest] = 0x80;
+  if (rest >= 56) {
+    sha256_soft_block(state, block);
+    memset(block, 0, 64);
+  }
+  uint64_t bits = (uint64_t)len * 8;
+  for (int i = 0; i < 8; i++) {
+    block[63 - i] = (bits >> (8 * i)) & 0xFF;
+  }
+  sha256_soft_block(state, block);
 
-  // write final double-hashed result to output buffer
-  mbedtls_sha256_finish(&ctx, output);
+  for (int i = 0; i < 8; i++) {
+    output[i * 4] = state[i] >> 24;
+    output[i * 4 + 1] = state[i] >> 16;
+    output[i * 4 + 2] = state[i] >> 8;
+    output[i * 4 + 3] = state[i];
+  }
+}
 
-  // cleanup
-  mbedtls_sha256_free(&ctx);
+// double sha256 with a specific kernel
+void sha256d_with(sha256_kernel_t kernel, const uint8_t* data, size_t len, uint8_t* output) {
+  switch (kernel) {
+    case sha256_kernel_t::SOFTWARE: {
+      uint8_t first_hash[32];
+      sha256_soft(data, len, first_hash);
+      sha256_soft(first_hash, 32, output);
+      break;
+    }
+    case sha256_kernel_t::HARDWARE:
+    default:
+      sha256d(data, len, output);
+      break;
+  }
+}
+
+// short kernel name for logs
+const char* sha256_kernel_name(sha256_kernel_t kernel) {
+  switch (kernel) {
+    case sha256_kernel_t::HARDWARE: return "hw";
+    case sha256_kernel_t::SOFTWARE: return "sw";
+  }
+  return "?";
+}
+
+// reset best share tracker to "nothing found yet"
+void best_share_init(best_share_t* best) {
+  best->top_word = 0xFFFFFFFF;
+  memset(best->hash, 0xFF, 32);
+  best->nonce = 0;
+  best->improved = false;
 }
 
 // compare hash to target with little-endian byte order
@@ -82,6 +200,176 @@ bool hash_below_target(const uint8_t* hash, const uint8_t* target) {
   return true;
 }
 
+// decode compact nbits into a full 32-byte little-endian target
+void nbits_to_target(uint32_t nbits, uint8_t* target_out) {
+  memset(target_out, 0, 32);
+
+  uint32_t exponent = nbits >> 24;
+  uint32_t mantissa = nbits & 0x007FFFFF;
+
+  // sign bit set means a negative target, nothing can meet it
+  if (nbits & 0x00800000) {
+    return;
+  }
+
+  // mantissa bytes land at byte offsets exponent-3 .. exponent-1
+  // bytes that would fall below 0 are shifted out, above 31 overflow
+  for (int i = 0; i < 3; i++) {
+    int pos = (int)exponent - 3 + i;
+    uint8_t b = (mantissa >> (8 * i)) & 0xFF;
+
+    if (pos >= 0 && pos < 32) {
+      target_out[pos] = b;
+    } else if (pos >= 32 && b != 0) {
+      // overflow - treat as easiest possible target
+      memset(target_out, 0xFF, 32);
+      return;
+    }
+  }
+}
+
+// compute share difficulty of a hash
+// difficulty = diff1 target / hash, where diff1 target = 0xffff * 2^208
+double hash_to_difficulty(const uint8_t* hash) {
+  // convert little-endian 256-bit hash to double, most significant byte first
+  double value = 0.0;
+  for (int i = 31; i >= 0; i--) {
+    value = value * 256.0 + hash[i];
+  }
+
+  if (value == 0.0) {
+    // a zero hash would be infinitely difficult
+    return 1.0e300;
+  }
+
+  return ldexp(65535.0, 208) / value;
+}
+
+// write nonce into header bytes 76-79 in little-endian format
+// bitcoin block header structure places nonce at end (bytes 76-79)
+// little-endian means least significant byte at lowest address
+static inline void set_header_nonce(uint8_t* header, uint32_t nonce) {
+  header[76] = (nonce >> 0) & 0xFF;   // bits 0-7 (lsb)
+  header[77] = (nonce >> 8) & 0xFF;   // bits 8-15
+  header[78] = (nonce >> 16) & 0xFF;  // bits 16-23
+  header[79] = (nonce >> 24) & 0xFF;  // bits 24-31 (msb)
+}
+
+// best share check: one word compare rejects almost every hash
+// full 256-bit compare only when the top word ties or beats the best
+static inline void update_best_share(best_share_t* best, const uint8_t* hash, uint32_t nonce) {
+  uint32_t top_word = ((uint32_t)hash[31] << 24) | ((uint32_t)hash[30] << 16) |
+                      ((uint32_t)hash[29] << 8) | hash[28];
+
+  if (top_word <= best->top_word && hash_below_target(hash, best->hash)) {
+    best->top_word = top_word;
+    memcpy(best->hash, hash, 32);
+    best->nonce = nonce;
+    best->improved = true;
+  }
+}
+
+#if defined(SHA256_LANES_AVAILABLE)
+// every lane's top word must match scalar sha256d bit for bit
+// random headers and nonces, plus the lanes that cross the top of the nonce range
+static bool lanes_self_test(sha256_lanes_isa_t isa) {
+  uint8_t header[80];
+  uint8_t hash[32];
+  uint32_t midstate[8];
+  uint32_t tail[3];
+  uint32_t top_words[SHA256_LANES_MAX];
+  uint8_t lanes = sha256_lanes_count(isa);
+
+  for (int t = 0; t < LANES_SELF_TEST_HEADERS; t++) {
+    for (int i = 0; i < 80; i += 4) {
+      uint32_t r = esp_random();
+      memcpy(header + i, &r, 4);
+    }
+    uint32_t first_nonce = t == 0 ? 0xFFFFFFFF - lanes / 2 : esp_random();
+
+    sha256_lanes_prepare(header, midstate, tail);
+    sha256_lanes_scan(isa, midstate, tail, first_nonce, top_words);
+
+    for (int lane = 0; lane < lanes; lane++) {
+      set_header_nonce(header, first_nonce + lane);
+      sha256d(header, 80, hash);
+
+      uint32_t expected = ((uint32_t)hash[31] << 24) | ((uint32_t)hash[30] << 16) |
+                          ((uint32_t)hash[29] << 8) | hash[28];
+      if (top_words[lane] != expected) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// mine_nonce_range on the lane kernel
+// lanes only yield the top word of each hash, a lane that could be a share or a
+// new best is hashed again in full with sha256d, which also confirms it
+static bool mine_nonce_range_lanes(uint8_t* header,
+                                   uint32_t start_nonce,
+                                   uint32_t nonce_count,
+                                   const uint8_t* target,
+                                   uint32_t* found_nonce,
+                                   uint32_t* hashes_done,
+                                   best_share_t* best) {
+  uint32_t midstate[8];
+  uint32_t tail[3];
+  uint32_t top_words[SHA256_LANES_MAX];
+  uint8_t hash[32];
+  uint8_t lanes = sha256_lanes_count(lanes_isa);
+
+  sha256_lanes_prepare(header, midstate, tail);
+
+  // a hash below the target can't have a larger top word than the target's
+  uint32_t target_top = ((uint32_t)target[31] << 24) | ((uint32_t)target[30] << 16) |
+                        ((uint32_t)target[29] << 8) | target[28];
+
+  uint32_t i = 0;
+  while (i < nonce_count) {
+    sha256_lanes_scan(lanes_isa, midstate, tail, start_nonce + i, top_words);
+
+    // last call of an uneven range hashes a few lanes past the end, they are ignored
+    uint32_t count = nonce_count - i;
+    if (count > lanes) {
+      count = lanes;
+    }
+
+    for (uint32_t lane = 0; lane < count; lane++) {
+      uint32_t threshold = target_top;
+      if (best != NULL && best->top_word > threshold) {
+        threshold = best->top_word;
+      }
+      if (top_words[lane] > threshold) {
+        continue;
+      }
+
+      uint32_t nonce = start_nonce + i + lane;
+      set_header_nonce(header, nonce);
+      sha256d(header, 80, hash);
+
+      if (best != NULL) {
+        update_best_share(best, hash, nonce);
+      }
+
+      if (hash_below_target(hash, target)) {
+        *found_nonce = nonce;
+        *hashes_done = i + lane + 1;
+        return true;
+      }
+    }
+
+    i += count;
+  }
+
+  set_header_nonce(header, start_nonce + nonce_count - 1);
+  *hashes_done = nonce_count;
+  return false;
+}
+#endif
+
 // mine a range of nonces looking for valid shares
 // this is the core mining loop that tests candidate solutions
 bool mine_nonce_range(uint8_t* header,
@@ -89,25 +377,37 @@ bool mine_nonce_range(uint8_t* header,
                       uint32_t nonce_count,
                       const uint8_t* target,
                       uint32_t* found_nonce,
-                      uint32_t* hashes_done) {
+                      uint32_t* hashes_done,
+                      best_share_t* best) {
+  PROFILE_SCOPE(MINE_NONCE_RANGE);
+
   // buffer for hash output
   uint8_t hash[32];
 
+  if (best != NULL) {
+    best->improved = false;
+  }
+
+#if defined(SHA256_LANES_AVAILABLE)
+  if (lanes_isa != sha256_lanes_isa_t::NONE) {
+    return mine_nonce_range_lanes(header, start_nonce, nonce_count, target,
+                                  found_nonce, hashes_done, best);
+  }
+#endif
+
   // iterate through assigned nonce range
   for (uint32_t i = 0; i < nonce_count; i++) {
     uint32_t nonce = start_nonce + i;
 
-    // write nonce into header bytes 76-79 in little-endian format
-    // bitcoin block header structure places nonce at end (bytes 76-79)
-    // little-endian means least significant byte at lowest address
-    header[76] = (nonce >> 0) & 0xFF;   // bits 0-7 (lsb)
-    header[77] = (nonce >> 8) & 0xFF;   // bits 8-15
-    header[78] = (nonce >> 16) & 0xFF;  // bits 16-23
-    header[79] = (nonce >> 24) & 0xFF;  // bits 24-31 (msb)
+    set_header_nonce(header, nonce);
 
     // compute double sha256 of complete 80-byte block header
     sha256d(header, 80, hash);
 
+    if (best != NULL) {
+      update_best_share(best, hash, nonce);
+    }
+
     // check if hash meets difficulty target
     if (hash_below_target(hash, target)) {
       // found valid share - hash is below target difficulty
@@ -120,4 +420,4 @@ bool mine_nonce_range(uint8_t* header,
   // exhausted nonce range without finding valid share
   *hashes_done = nonce_count;
   return false;
-}
\ No newline at end of file
+}
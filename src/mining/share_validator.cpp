@@ -0,0 +1,209 @@
+// share_validator.cpp
+// statistical check of reported hashrate against shares found and accepted
+
+#include "mining/share_validator.h"
+#include "mining/log_ring.h"
+
+// 2^32 - hashes per share at difficulty 1
+#define HASHES_PER_DIFF1_SHARE 4294967296.0
+
+// above this mean the poisson cdf uses a normal approximation
+#define POISSON_NORMAL_THRESHOLD 1000.0
+
+// constructor - start with empty windows
+ShareValidator::ShareValidator() {
+    reset(0, 0, 0, 0.0, 0);
+}
+
+// clear all windows and start from the given monotonic counters
+void ShareValidator::reset(uint64_t total_hashes, uint32_t found, uint32_t accepted,
+                           double accepted_work, unsigned long now_ms) {
+    memset(buckets, 0, sizeof(buckets));
+    bucket_head = 0;
+    bucket_count = 0;
+    bucket_start_ms = now_ms;
+
+    last_hashes = total_hashes;
+    last_found = found;
+    last_accepted = accepted;
+    last_accepted_work = accepted_work;
+
+    last_eval_ms = now_ms;
+    memset(&result, 0, sizeof(result));
+}
+
+// feed monotonic counters and the difficulty currently in effect
+void ShareValidator::update(uint64_t total_hashes, uint32_t found, uint32_t accepted,
+                            double accepted_work, double difficulty, unsigned long now_ms) {
+    // roll the open bucket forward if its time is up
+    unsigned long elapsed_ms = now_ms - bucket_start_ms;
+    if (elapsed_ms >= SHARE_VALIDATOR_BUCKET_SECONDS * 1000UL) {
+        uint32_t elapsed_buckets = elapsed_ms / (SHARE_VALIDATOR_BUCKET_SECONDS * 1000UL);
+        uint32_t close_count = min(elapsed_buckets, (uint32_t)SHARE_VALIDATOR_BUCKETS);
+
+        for (uint32_t i = 0; i < close_count; i++) {
+            bucket_head = (bucket_head + 1) % SHARE_VALIDATOR_BUCKETS;
+            memset(&buckets[bucket_head], 0, sizeof(share_bucket_t));
+            if (bucket_count < SHARE_VALIDATOR_BUCKETS - 1) {
+                bucket_count++;
+            }
+        }
+
+        bucket_start_ms += elapsed_buckets * SHARE_VALIDATOR_BUCKET_SECONDS * 1000UL;
+    }
+
+    // add deltas to open bucket
+    share_bucket_t* bucket = &buckets[bucket_head];
+    uint64_t delta_hashes = total_hashes - last_hashes;
+
+    bucket->hashes += delta_hashes;
+    bucket->found += found - last_found;
+    bucket->accepted += accepted - last_accepted;
+    bucket->accepted_work += accepted_work - last_accepted_work;
+
+    // each hash meets a difficulty d target with probability 1 / (d * 2^32)
+    if (difficulty > 0) {
+        bucket->expected += (double)delta_hashes / (difficulty * HASHES_PER_DIFF1_SHARE);
+    }
+
+    last_hashes = total_hashes;
+    last_found = found;
+    last_accepted = accepted;
+    last_accepted_work = accepted_work;
+
+    if (now_ms - last_eval_ms >= SHARE_VALIDATOR_EVAL_INTERVAL) {
+        evaluate(now_ms);
+        last_eval_ms = now_ms;
+    }
+}
+
+// get latest evaluation result
+share_validation_t ShareValidator::get_result() {
+    return result;
+}
+
+// recompute bounds and flags for the short and long windows
+void ShareValidator::evaluate(unsigned long now_ms) {
+    uint32_t open_seconds = (now_ms - bucket_start_ms) / 1000;
+
+    // long window: every closed bucket plus the open one
+    share_bucket_t long_sum;
+    sum_window(bucket_count, &long_sum);
+    uint32_t long_seconds = bucket_count * SHARE_VALIDATOR_BUCKET_SECONDS + open_seconds;
+
+    // short window: most recent closed buckets plus the open one
+    share_bucket_t short_sum;
+    sum_window(min(bucket_count, (uint16_t)(SHARE_VALIDATOR_SHORT_WINDOW - 1)), &short_sum);
+
+    result.expected_shares = long_sum.expected;
+    result.shares_found = long_sum.found;
+    result.shares_accepted = long_sum.accepted;
+    result.window_seconds = long_seconds;
+
+    if (long_seconds > 0) {
+        result.reported_hashrate = (double)long_sum.hashes / long_seconds;
+        result.effective_hashrate = long_sum.accepted_work * HASHES_PER_DIFF1_SHARE / long_seconds;
+    } else {
+        result.reported_hashrate = 0.0f;
+        result.effective_hashrate = 0.0f;
+    }
+
+    // scale the upper bound on the share count back to a hashrate
+    if (long_sum.expected > 0) {
+        double upper_shares = poisson_upper_bound(long_sum.accepted, SHARE_VALIDATOR_ALPHA);
+        result.effective_hashrate_upper = result.reported_hashrate * (upper_shares / long_sum.expected);
+    } else {
+        result.effective_hashrate_upper = result.reported_hashrate;
+    }
+
+    // flag if either window makes the observed count implausible
+    bool was_suspect = result.kernel_suspect || result.hashrate_suspect;
+    result.kernel_suspect = is_suspect(long_sum.found, long_sum.expected) ||
+                            is_suspect(short_sum.found, short_sum.expected);
+    result.hashrate_suspect = is_suspect(long_sum.accepted, long_sum.expected) ||
+                              is_suspect(short_sum.accepted, short_sum.expected);
+
+    // log the edges only, the flag can stay set for many evaluations
+    bool suspect = result.kernel_suspect || result.hashrate_suspect;
+    if (suspect && !was_suspect) {
+        LOG_WARN("[validator] suspect hashrate - expected %.2f shares, found %u, accepted %u",
+                 long_sum.expected, long_sum.found, long_sum.accepted);
+    } else if (!suspect && was_suspect) {
+        LOG_WARN("[validator] hashrate plausible again - expected %.2f shares, found %u, accepted %u",
+                 long_sum.expected, long_sum.found, long_sum.accepted);
+    }
+}
+
+// sum the open bucket and the given number of most recent closed buckets
+void ShareValidator::sum_window(uint16_t closed_buckets, share_bucket_t* sum_out) {
+    memset(sum_out, 0, sizeof(share_bucket_t));
+
+    uint16_t index = bucket_head;
+    for (uint16_t i = 0; i <= closed_buckets; i++) {
+        const share_bucket_t* b = &buckets[index];
+        sum_out->hashes += b->hashes;
+        sum_out->expected += b->expected;
+        sum_out->found += b->found;
+        sum_out->accepted += b->accepted;
+        sum_out->accepted_work += b->accepted_work;
+
+        index = (index + SHARE_VALIDATOR_BUCKETS - 1) % SHARE_VALIDATOR_BUCKETS;
+    }
+}
+
+// true if seeing this few shares is implausible at the expected rate
+bool ShareValidator::is_suspect(uint32_t observed, double expected) {
+    // with few expected shares even zero observed is plausible,
+    // the cdf handles that: p(0) = e^-expected stays above alpha
+    return poisson_cdf(observed, expected) < SHARE_VALIDATOR_ALPHA;
+}
+
+// probability of observing k or fewer events with poisson mean lambda
+double ShareValidator::poisson_cdf(uint32_t k, double lambda) {
+    if (lambda <= 0) {
+        return 1.0;
+    }
+
+    // large means: normal approximation with continuity correction
+    if (lambda > POISSON_NORMAL_THRESHOLD) {
+        double z = ((double)k + 0.5 - lambda) / sqrt(lambda);
+        return 0.5 * erfc(-z / sqrt(2.0));
+    }
+
+    // exact sum computed in log space so e^-lambda cannot underflow
+    double log_lambda = log(lambda);
+    double sum = 0.0;
+    for (uint32_t i = 0; i <= k; i++) {
+        sum += exp(-lambda + i * log_lambda - lgamma(i + 1.0));
+        if (sum >= 1.0) {
+            return 1.0;
+        }
+    }
+
+    return sum;
+}
+
+// smallest poisson mean for which observing k or fewer has probability alpha
+// this is the one-sided upper confidence bound on the true mean
+double ShareValidator::poisson_upper_bound(uint32_t k, double alpha) {
+    double lo = (double)k;
+    double hi = (double)k + 10.0 * sqrt((double)k + 1.0) + 10.0;
+
+    // widen until the bound is bracketed
+    while (poisson_cdf(k, hi) > alpha) {
+        lo = hi;
+        hi *= 2.0;
+    }
+
+    // bisect, cdf decreases as lambda grows
+    for (int i = 0; i < 40; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (poisson_cdf(k, mid) > alpha) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return hi;
+}
@@ -0,0 +1,1042 @@
+// solo_client.cpp
+// solo mining work source built from a local node's getblocktemplate
+
+#include "mining/solo_client.h"
+#include "mining/sha256_miner.h"
+#include "mining/dns_cache.h"
+
+// tag written into the coinbase script after the extranonce
+#define SOLO_COINBASE_TAG "/esp32btcminer/"
+
+// bip141 witness reserved value, all zero
+#define WITNESS_RESERVED_VALUE_SIZE 32
+
+// psram allocator for the template document
+void* SpiRamAllocator::allocate(size_t size) {
+    return ps_malloc(size);
+}
+
+void SpiRamAllocator::deallocate(void* pointer) {
+    free(pointer);
+}
+
+void* SpiRamAllocator::reallocate(void* ptr, size_t new_size) {
+    return ps_realloc(ptr, new_size);
+}
+
+// constructor - initialize all state
+SoloClient::SoloClient() {
+    host[0] = '\0';
+    port = 0;
+    auth_header[0] = '\0';
+    node_reachable = false;
+
+    payout_script_len = 0;
+
+    template_doc = NULL;
+    template_valid = false;
+    include_transactions = true;
+    job_id[0] = '\0';
+    template_counter = 0;
+    height = 0;
+    version = 0;
+    memset(prev_hash, 0, 32);
+    nbits = 0;
+    curtime = 0;
+    memset(network_target, 0, 32);
+    coinbase_value = 0;
+    witness_commitment_len = 0;
+    best_block_hash[0] = '\0';
+
+    txids = NULL;
+    tx_count = 0;
+
+    coinbase1_len = 0;
+    coinbase2_len = 0;
+    memset(extranonce1, 0, sizeof(extranonce1));
+    extranonce2_counter = 0;
+    merkle_branch_count = 0;
+
+    work_sequence = 0;
+    last_tip_poll = 0;
+    last_template_fetch = 0;
+
+    submit_counter = 0;
+    blocks_accepted = 0;
+    blocks_rejected = 0;
+}
+
+// set rpc credentials (user/password from bitcoin.conf or the cookie file)
+void SoloClient::set_rpc_auth(const char* user, const char* password) {
+    if (user == NULL || strlen(user) == 0) {
+        auth_header[0] = '\0';
+        return;
+    }
+
+    char credentials[80];
+    snprintf(credentials, sizeof(credentials), "%s:%s", user, password ? password : "");
+
+    // "Basic " + base64 of credentials, 4 chars per 3 bytes
+    strcpy(auth_header, "Basic ");
+    base64_encode((const uint8_t*)credentials, strlen(credentials), auth_header + 6);
+}
+
+// decode payout address into the coinbase output script
+bool SoloClient::set_payout_address(const char* address) {
+    if (!decode_address(address, payout_script, &payout_script_len)) {
+        Serial.println("[solo] invalid payout address");
+        payout_script_len = 0;
+        return false;
+    }
+    return true;
+}
+
+// "connect" - check the node answers and fetch the first template
+bool SoloClient::connect(const char* host_in, uint16_t port_in) {
+    Serial.print("[solo] using node ");
+    Serial.print(host_in);
+    Serial.print(":");
+    Serial.println(port_in);
+
+    strncpy(host, host_in, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    port = port_in;
+
+    if (payout_script_len == 0) {
+        Serial.println("[solo] no payout address set");
+        return false;
+    }
+
+    // per-boot extranonce1 keeps coinbases unique across restarts
+    uint32_t r = esp_random();
+    memcpy(extranonce1, &r, SOLO_EXTRANONCE1_SIZE);
+    extranonce2_counter = 0;
+    include_transactions = true;
+    best_block_hash[0] = '\0';
+
+    node_reachable = fetch_template();
+    if (node_reachable) {
+        poll_tip(NULL);
+        last_tip_poll = millis();
+    }
+
+    return node_reachable;
+}
+
+// drop current template
+void SoloClient::disconnect() {
+    node_reachable = false;
+    template_valid = false;
+}
+
+// node answered the last request
+bool SoloClient::is_connected() {
+    return node_reachable;
+}
+
+// poll for a new tip, refresh template periodically for new transactions
+void SoloClient::process() {
+    if (!node_reachable) {
+        return;
+    }
+
+    unsigned long now = millis();
+    bool refresh = now - last_template_fetch >= SOLO_TEMPLATE_REFRESH_INTERVAL;
+
+    if (now - last_tip_poll >= SOLO_TIP_POLL_INTERVAL) {
+        last_tip_poll = now;
+
+        bool changed = false;
+        if (!poll_tip(&changed)) {
+            node_reachable = false;
+            return;
+        }
+
+        if (changed) {
+            Serial.println("[solo] new block on network");
+            refresh = true;
+        }
+    }
+
+    if (refresh && !fetch_template()) {
+        node_reachable = false;
+    }
+}
+
+// send http request line, headers and the json-rpc body up to and including params
+// content length covers extra_len bytes the caller writes afterwards plus the closing brace
+bool SoloClient::open_rpc(TcpClient& client, const char* method, const char* params, size_t extra_len) {
+    if (!dns_cache.connect(client, host, port)) {
+        Serial.println("[solo] node connection failed");
+        return false;
+    }
+
+    char body_start[128];
+    int body_len = snprintf(body_start, sizeof(body_start),
+                            "{\"jsonrpc\":\"1.0\",\"id\":\"esp32\",\"method\":\"%s\",\"params\":%s",
+                            method, params);
+
+    char headers[320];
+    int headers_len = snprintf(headers, sizeof(headers),
+                               "POST / HTTP/1.0\r\n"
+                               "Host: %s\r\n"
+                               "Content-Type: application/json\r\n"
+                               "%s%s%s"
+                               "Content-Length: %u\r\n\r\n",
+                               host,
+                               auth_header[0] ? "Authorization: " : "",
+                               auth_header,
+                               auth_header[0] ? "\r\n" : "",
+                               (unsigned)(body_len + extra_len + 1));
+
+    client.write((const uint8_t*)headers, headers_len);
+    client.write((const uint8_t*)body_start, body_len);
+    return true;
+}
+
+// consume status line and headers, leaves the stream at the json body
+// bitcoind answers rpc errors with 500 and a json body, so only auth failures are fatal
+bool SoloClient::skip_http_headers(TcpClient& client) {
+    unsigned long start = millis();
+    char status[16];
+    uint8_t status_len = 0;
+    uint8_t newlines = 0;
+    bool in_status = true;
+
+    while (newlines < 2) {
+        if (!client.available()) {
+            if (!client.connected() || millis() - start > SOLO_RPC_TIMEOUT_MS) {
+                Serial.println("[solo] node response timeout");
+                return false;
+            }
+            delay(1);
+            continue;
+        }
+
+        char c = client.read();
+        if (in_status) {
+            if (c == '\n') {
+                in_status = false;
+            } else if (status_len < sizeof(status) - 1) {
+                status[status_len++] = c;
+            }
+        }
+
+        // header block ends with an empty line
+        if (c == '\n') {
+            newlines++;
+        } else if (c != '\r') {
+            newlines = 0;
+        }
+    }
+    status[status_len] = '\0';
+
+    // "HTTP/1.1 401 Unauthorized"
+    if (strstr(status, " 401") || strstr(status, " 403")) {
+        Serial.println("[solo] node rejected rpc credentials");
+        return false;
+    }
+
+    return true;
+}
+
+// fetch and load a new block template
+bool SoloClient::fetch_template() {
+    last_template_fetch = millis();
+
+    if (template_doc == NULL) {
+        template_doc = new SpiRamJsonDocument(SOLO_TEMPLATE_DOC_SIZE);
+    }
+
+    // only keep what the header, coinbase and submitblock need
+    StaticJsonDocument<512> filter;
+    JsonVariant result = filter["result"];
+    result["version"] = true;
+    result["previousblockhash"] = true;
+    result["coinbasevalue"] = true;
+    result["bits"] = true;
+    result["curtime"] = true;
+    result["height"] = true;
+    result["default_witness_commitment"] = true;
+    if (include_transactions) {
+        result["transactions"][0]["data"] = true;
+        result["transactions"][0]["txid"] = true;
+    }
+    // fees always, a coinbase-only block has to take them off coinbasevalue
+    result["transactions"][0]["fee"] = true;
+    filter["error"] = true;
+
+    TcpClient client;
+    if (!open_rpc(client, "getblocktemplate", "[{\"rules\":[\"segwit\"]}]", 0)) {
+        return false;
+    }
+    client.print("}");
+
+    if (!skip_http_headers(client)) {
+        client.stop();
+        return false;
+    }
+
+    template_doc->clear();
+    DeserializationError err = deserializeJson(*template_doc, client,
+                                               DeserializationOption::Filter(filter));
+    client.stop();
+
+    // template does not fit, mine an empty block until the next one does
+    // the refetch keeps only the fees, so the coinbase can leave them out
+    if (err.code() == DeserializationError::NoMemory && include_transactions) {
+        Serial.println("[solo] template too large, mining coinbase-only block");
+        include_transactions = false;
+        bool ok = fetch_template();
+        include_transactions = true;
+        return ok;
+    }
+
+    if (err) {
+        Serial.print("[solo] template parse error: ");
+        Serial.println(err.c_str());
+        return false;
+    }
+
+    if (!(*template_doc)["error"].isNull()) {
+        Serial.print("[solo] getblocktemplate error: ");
+        Serial.println((const char*)((*template_doc)["error"]["message"] | "unknown"));
+        return false;
+    }
+
+    return load_template((*template_doc)["result"].as<JsonObject>());
+}
+
+// check the node's best block hash, sets changed if it moved since the template
+bool SoloClient::poll_tip(bool* changed) {
+    TcpClient client;
+    if (!open_rpc(client, "getbestblockhash", "[]", 0)) {
+        return false;
+    }
+    client.print("}");
+
+    if (!skip_http_headers(client)) {
+        client.stop();
+        return false;
+    }
+
+    StaticJsonDocument<256> doc;
+    DeserializationError err = deserializeJson(doc, client);
+    client.stop();
+
+    if (err) {
+        return false;
+    }
+
+    const char* hash = doc["result"] | "";
+    if (changed) {
+        *changed = strcmp(hash, best_block_hash) != 0;
+    }
+
+    return true;
+}
+
+// parse template fields, rebuild coinbase and merkle path
+bool SoloClient::load_template(JsonObject result) {
+    const char* prev_hex = result["previousblockhash"] | "";
+    const char* bits_hex = result["bits"] | "";
+
+    if (strlen(prev_hex) != 64 || strlen(bits_hex) != 8) {
+        Serial.println("[solo] template missing fields");
+        return false;
+    }
+
+    // node gives display order, header wants internal order
+    hex_to_bytes(prev_hex, prev_hash, 32);
+    for (int i = 0; i < 16; i++) {
+        uint8_t temp = prev_hash[i];
+        prev_hash[i] = prev_hash[31 - i];
+        prev_hash[31 - i] = temp;
+    }
+    strcpy(best_block_hash, prev_hex);
+
+    version = result["version"] | 0x20000000;
+    nbits = strtoul(bits_hex, NULL, 16);
+    curtime = result["curtime"] | 0;
+    height = result["height"] | 0;
+    coinbase_value = result["coinbasevalue"].as<uint64_t>();
+    nbits_to_target(nbits, network_target);
+
+    const char* commitment = result["default_witness_commitment"] | "";
+    size_t commitment_len = strlen(commitment) / 2;
+    if (commitment_len > 0 && commitment_len <= SOLO_SCRIPT_MAX) {
+        hex_to_bytes(commitment, witness_commitment, commitment_len);
+        witness_commitment_len = commitment_len;
+    } else {
+        witness_commitment_len = 0;
+    }
+
+    // txids in internal byte order for the merkle tree
+    JsonArray transactions = result["transactions"].as<JsonArray>();
+    size_t count = transactions.isNull() ? 0 : transactions.size();
+
+    if (!include_transactions) {
+        count = 0;                      // fees-only refetch, already reported
+    } else if (count > SOLO_MAX_TRANSACTIONS) {
+        Serial.println("[solo] too many transactions, mining coinbase-only block");
+        count = 0;
+    }
+
+    if (txids == NULL) {
+        txids = (uint8_t (*)[32])ps_malloc(SOLO_MAX_TRANSACTIONS * 32);
+        if (txids == NULL) {
+            count = 0;
+        }
+    }
+
+    tx_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* txid = transactions[i]["txid"] | "";
+        if (strlen(txid) != 64) {
+            Serial.println("[solo] bad txid in template, mining coinbase-only block");
+            tx_count = 0;
+            break;
+        }
+        hex_to_bytes(txid, txids[tx_count], 32);
+        for (int j = 0; j < 16; j++) {
+            uint8_t temp = txids[tx_count][j];
+            txids[tx_count][j] = txids[tx_count][31 - j];
+            txids[tx_count][31 - j] = temp;
+        }
+        tx_count++;
+    }
+
+    compute_merkle_branches();
+
+    // coinbasevalue is subsidy plus the fees of every template transaction,
+    // a block that leaves them out may only claim the subsidy
+    if (tx_count == 0 && !transactions.isNull() && transactions.size() > 0) {
+        uint64_t fees = 0;
+        for (JsonVariant tx : transactions) {
+            if (!tx["fee"].is<uint64_t>()) {
+                Serial.println("[solo] template without fees, cannot mine coinbase-only block");
+                return false;
+            }
+            fees += tx["fee"].as<uint64_t>();
+        }
+        if (fees > coinbase_value) {
+            Serial.println("[solo] template fees exceed coinbase value");
+            return false;
+        }
+        coinbase_value -= fees;
+        Serial.print("[solo] coinbase-only block, ");
+        Serial.print((uint32_t)fees);
+        Serial.println(" sat of fees left out");
+    }
+
+    // the default commitment covers the template's transactions, a coinbase-only
+    // block has no witness data and must not carry it
+    if (tx_count == 0) {
+        witness_commitment_len = 0;
+    }
+
+    build_coinbase();
+
+    template_counter++;
+    snprintf(job_id, sizeof(job_id), "%x", template_counter);
+    template_valid = true;
+    work_sequence++;
+
+    Serial.print("[solo] template for height ");
+    Serial.print(height);
+    Serial.print(", ");
+    Serial.print(tx_count);
+    Serial.println(" transactions");
+
+    return true;
+}
+
+// build coinbase parts around the extranonce
+// coinbase1: version | input count | null prevout | script len | bip34 height
+// coinbase2: tag | sequence | outputs | locktime
+void SoloClient::build_coinbase() {
+    uint8_t height_push[8];
+    size_t height_push_len = write_height_push(height_push, height);
+    size_t tag_len = strlen(SOLO_COINBASE_TAG);
+    size_t script_len = height_push_len + SOLO_EXTRANONCE1_SIZE + SOLO_EXTRANONCE2_SIZE + tag_len;
+
+    size_t pos = 0;
+
+    // version 1
+    coinbase1[pos++] = 0x01;
+    coinbase1[pos++] = 0x00;
+    coinbase1[pos++] = 0x00;
+    coinbase1[pos++] = 0x00;
+
+    // one input spending the null outpoint
+    coinbase1[pos++] = 0x01;
+    memset(coinbase1 + pos, 0x00, 32);
+    pos += 32;
+    memset(coinbase1 + pos, 0xFF, 4);
+    pos += 4;
+
+    coinbase1[pos++] = script_len;
+    memcpy(coinbase1 + pos, height_push, height_push_len);
+    pos += height_push_len;
+    coinbase1_len = pos;
+
+    pos = 0;
+    memcpy(coinbase2 + pos, SOLO_COINBASE_TAG, tag_len);
+    pos += tag_len;
+
+    // sequence
+    memset(coinbase2 + pos, 0xFF, 4);
+    pos += 4;
+
+    // outputs: payout, then witness commitment if the template has one
+    coinbase2[pos++] = witness_commitment_len > 0 ? 2 : 1;
+
+    for (int i = 0; i < 8; i++) {
+        coinbase2[pos++] = (coinbase_value >> (8 * i)) & 0xFF;
+    }
+    coinbase2[pos++] = payout_script_len;
+    memcpy(coinbase2 + pos, payout_script, payout_script_len);
+    pos += payout_script_len;
+
+    if (witness_commitment_len > 0) {
+        memset(coinbase2 + pos, 0x00, 8);
+        pos += 8;
+        coinbase2[pos++] = witness_commitment_len;
+        memcpy(coinbase2 + pos, witness_commitment, witness_commitment_len);
+        pos += witness_commitment_len;
+    }
+
+    // locktime
+    memset(coinbase2 + pos, 0x00, 4);
+    pos += 4;
+    coinbase2_len = pos;
+}
+
+// serialize the full coinbase for a given extranonce2
+// the txid uses the legacy form, submitblock needs the witness form when segwit is active
+size_t SoloClient::serialize_coinbase(uint32_t extranonce2, bool with_witness, uint8_t* out) {
+    size_t pos = 0;
+
+    memcpy(out + pos, coinbase1, 4);
+    pos += 4;
+
+    // segwit marker and flag go between version and inputs
+    if (with_witness) {
+        out[pos++] = 0x00;
+        out[pos++] = 0x01;
+    }
+
+    memcpy(out + pos, coinbase1 + 4, coinbase1_len - 4);
+    pos += coinbase1_len - 4;
+
+    memcpy(out + pos, extranonce1, SOLO_EXTRANONCE1_SIZE);
+    pos += SOLO_EXTRANONCE1_SIZE;
+
+    for (int i = 0; i < SOLO_EXTRANONCE2_SIZE; i++) {
+        out[pos++] = (extranonce2 >> (8 * i)) & 0xFF;
+    }
+
+    memcpy(out + pos, coinbase2, coinbase2_len - 4);
+    pos += coinbase2_len - 4;
+
+    // witness for the single input: one 32-byte reserved value, before locktime
+    if (with_witness) {
+        out[pos++] = 0x01;
+        out[pos++] = WITNESS_RESERVED_VALUE_SIZE;
+        memset(out + pos, 0x00, WITNESS_RESERVED_VALUE_SIZE);
+        pos += WITNESS_RESERVED_VALUE_SIZE;
+    }
+
+    memcpy(out + pos, coinbase2 + coinbase2_len - 4, 4);
+    pos += 4;
+
+    return pos;
+}
+
+// compute the merkle path of the coinbase (leaf 0) once per template
+// each level's sibling of the coinbase node is the only hash that does not
+// depend on the coinbase, so the rest of the tree never needs rehashing
+void SoloClient::compute_merkle_branches() {
+    merkle_branch_count = 0;
+
+    if (tx_count == 0) {
+        return;
+    }
+
+    // working level without the coinbase: level[i] is node i + 1, one spare
+    // entry for duplicating the last node of an odd level
+    uint8_t (*level)[32] = (uint8_t (*)[32])ps_malloc((tx_count + 1) * 32);
+    if (level == NULL) {
+        Serial.println("[solo] out of memory for merkle path, mining coinbase-only block");
+        tx_count = 0;
+        return;
+    }
+    memcpy(level, txids, tx_count * 32);
+
+    // nodes at this level including the coinbase side
+    size_t width = tx_count + 1;
+
+    while (width > 1 && merkle_branch_count < STRATUM_MAX_MERKLE_BRANCHES) {
+        // sibling of the coinbase side is always node 1
+        memcpy(merkle_branches[merkle_branch_count++], level[0], 32);
+
+        // odd width duplicates the last node
+        if (width % 2 == 1) {
+            memcpy(level[width - 1], level[width - 2], 32);
+            width++;
+        }
+
+        // node k of the next level hashes nodes 2k and 2k+1, node 0 is the coinbase side
+        for (size_t k = 1; k < width / 2; k++) {
+            uint8_t concat[64];
+            memcpy(concat, level[2 * k - 1], 32);
+            memcpy(concat + 32, level[2 * k], 32);
+            sha256d(concat, 64, level[k - 1]);
+        }
+
+        width /= 2;
+    }
+
+    free(level);
+}
+
+// merkle root for a given extranonce2: hash the coinbase and walk the cached path
+void SoloClient::compute_merkle_root(uint32_t extranonce2, uint8_t* merkle_root_out) {
+    uint8_t coinbase[SOLO_COINBASE_MAX];
+    size_t coinbase_len = serialize_coinbase(extranonce2, false, coinbase);
+
+    uint8_t current_hash[32];
+    sha256d(coinbase, coinbase_len, current_hash);
+
+    for (int i = 0; i < merkle_branch_count; i++) {
+        uint8_t concat[64];
+        memcpy(concat, current_hash, 32);
+        memcpy(concat + 32, merkle_branches[i], 32);
+        sha256d(concat, 64, current_hash);
+    }
+
+    memcpy(merkle_root_out, current_hash, 32);
+}
+
+// build 80-byte block header from the current template
+void SoloClient::build_block_header(uint8_t* header_out) {
+    if (!template_valid) {
+        memset(header_out, 0, 80);
+        return;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        header_out[i] = (version >> (8 * i)) & 0xFF;
+    }
+    memcpy(header_out + 4, prev_hash, 32);
+    compute_merkle_root(extranonce2_counter, header_out + 36);
+    for (int i = 0; i < 4; i++) {
+        header_out[68 + i] = (curtime >> (8 * i)) & 0xFF;
+        header_out[72 + i] = (nbits >> (8 * i)) & 0xFF;
+        header_out[76 + i] = 0;
+    }
+}
+
+// submitblock - stream header, coinbase and template transactions as one hex string
+bool SoloClient::submit_share(const char* job_id_in, uint32_t extranonce2, uint32_t ntime, uint32_t nonce) {
+    if (!template_valid || strcmp(job_id_in, job_id) != 0) {
+        Serial.println("[solo] block is for a stale template, not submitted");
+        return false;
+    }
+
+    submit_counter++;
+
+    // header with the winning values
+    uint8_t header[80];
+    for (int i = 0; i < 4; i++) {
+        header[i] = (version >> (8 * i)) & 0xFF;
+        header[68 + i] = (ntime >> (8 * i)) & 0xFF;
+        header[72 + i] = (nbits >> (8 * i)) & 0xFF;
+        header[76 + i] = (nonce >> (8 * i)) & 0xFF;
+    }
+    memcpy(header + 4, prev_hash, 32);
+    compute_merkle_root(extranonce2, header + 36);
+
+    uint8_t coinbase[SOLO_COINBASE_MAX];
+    size_t coinbase_len = serialize_coinbase(extranonce2, witness_commitment_len > 0, coinbase);
+
+    uint8_t tx_count_varint[9];
+    size_t varint_len = write_varint(tx_count_varint, (uint64_t)tx_count + 1);
+
+    JsonArray transactions = (*template_doc)["result"]["transactions"].as<JsonArray>();
+
+    // hex length of the whole block, tx data is already hex in the template
+    size_t block_hex_len = (80 + varint_len + coinbase_len) * 2;
+    for (uint16_t i = 0; i < tx_count; i++) {
+        block_hex_len += strlen(transactions[i]["data"] | "");
+    }
+
+    TcpClient client;
+    if (!open_rpc(client, "submitblock", "[\"", block_hex_len + 2)) {
+        blocks_rejected++;
+        return false;
+    }
+
+    write_hex(client, header, 80);
+    write_hex(client, tx_count_varint, varint_len);
+    write_hex(client, coinbase, coinbase_len);
+    for (uint16_t i = 0; i < tx_count; i++) {
+        const char* data = transactions[i]["data"] | "";
+        client.write((const uint8_t*)data, strlen(data));
+    }
+    client.print("\"]}");
+
+    if (!skip_http_headers(client)) {
+        client.stop();
+        blocks_rejected++;
+        return false;
+    }
+
+    StaticJsonDocument<256> doc;
+    DeserializationError err = deserializeJson(doc, client);
+    client.stop();
+
+    // null result means the node took the block, a string is the reject reason
+    if (!err && doc["result"].isNull() && doc["error"].isNull()) {
+        Serial.println("[solo] block accepted by node");
+        blocks_accepted++;
+    } else {
+        Serial.print("[solo] block rejected: ");
+        Serial.println((const char*)(doc["result"] | "rpc error"));
+        blocks_rejected++;
+    }
+
+    // whatever happened, the tip is worth checking right away
+    last_tip_poll = 0;
+
+    return true;
+}
+
+// check if we have a template to mine on
+bool SoloClient::has_work() {
+    return template_valid;
+}
+
+// get work sequence - changes on every new template
+uint32_t SoloClient::get_work_sequence() {
+    return work_sequence;
+}
+
+// solo mining only cares about blocks, share target is the network target
+void SoloClient::get_target(uint8_t* target_out) {
+    memcpy(target_out, network_target, 32);
+}
+
+// get 32-byte block target of current template
+void SoloClient::get_network_target(uint8_t* target_out) {
+    memcpy(target_out, network_target, 32);
+}
+
+// get template id for submission
+const char* SoloClient::get_current_job_id() {
+    return job_id;
+}
+
+// get template time
+uint32_t SoloClient::get_current_ntime() {
+    return curtime;
+}
+
+// get extranonce2 value build_block_header() uses
+uint32_t SoloClient::get_current_extranonce2() {
+    return extranonce2_counter;
+}
+
+// next extranonce2 for the current template, the coinbase changes so the
+// merkle root does too
+bool SoloClient::roll_extranonce2() {
+    if (!template_valid) {
+        return false;
+    }
+    extranonce2_counter++;
+    work_sequence++;
+    return true;
+}
+
+// get network difficulty bits of current template
+uint32_t SoloClient::get_current_nbits() {
+    return nbits;
+}
+
+// get request number of the most recent submitblock
+uint32_t SoloClient::get_last_submit_id() {
+    return submit_counter;
+}
+
+// submitblock waits for the node's answer, nothing is ever pending
+bool SoloClient::is_submit_pending(uint32_t id) {
+    return false;
+}
+
+// get blocks accepted by the node
+uint32_t SoloClient::get_shares_accepted() {
+    return blocks_accepted;
+}
+
+// get blocks rejected by the node
+uint32_t SoloClient::get_shares_rejected() {
+    return blocks_rejected;
+}
+
+// get network difficulty of current template
+double SoloClient::get_difficulty() {
+    if (!template_valid) {
+        return 0.0;
+    }
+    return hash_to_difficulty(network_target);
+}
+
+// accepted blocks each count the difficulty they were found at
+double SoloClient::get_accepted_difficulty() {
+    return blocks_accepted * get_difficulty();
+}
+
+// decode a mainnet/testnet/regtest address into its output script
+bool SoloClient::decode_address(const char* address, uint8_t* script_out, uint8_t* script_len_out) {
+    if (strncasecmp(address, "bc1", 3) == 0 || strncasecmp(address, "tb1", 3) == 0 ||
+        strncasecmp(address, "bcrt1", 5) == 0) {
+        return decode_bech32(address, script_out, script_len_out);
+    }
+    return decode_base58check(address, script_out, script_len_out);
+}
+
+// bech32 polymod checksum step (bip173)
+static uint32_t bech32_polymod_step(uint32_t chk) {
+    uint8_t top = chk >> 25;
+    chk = (chk & 0x1ffffff) << 5;
+    if (top & 1) chk ^= 0x3b6a57b2;
+    if (top & 2) chk ^= 0x26508e6d;
+    if (top & 4) chk ^= 0x1ea119fa;
+    if (top & 8) chk ^= 0x3d4233dd;
+    if (top & 16) chk ^= 0x2a1462b3;
+    return chk;
+}
+
+// segwit address: witness v0 uses bech32 (bip173), v1+ bech32m (bip350)
+bool SoloClient::decode_bech32(const char* address, uint8_t* script_out, uint8_t* script_len_out) {
+    static const char* charset = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+    size_t len = strlen(address);
+    const char* separator = strrchr(address, '1');
+    if (separator == NULL || len > 90) {
+        return false;
+    }
+
+    size_t hrp_len = separator - address;
+    size_t data_len = len - hrp_len - 1;
+    if (hrp_len == 0 || data_len < 7) {
+        return false;
+    }
+
+    // checksum over expanded hrp and data
+    uint32_t chk = 1;
+    for (size_t i = 0; i < hrp_len; i++) {
+        chk = bech32_polymod_step(chk) ^ (tolower(address[i]) >> 5);
+    }
+    chk = bech32_polymod_step(chk);
+    for (size_t i = 0; i < hrp_len; i++) {
+        chk = bech32_polymod_step(chk) ^ (tolower(address[i]) & 0x1f);
+    }
+
+    uint8_t values[90];
+    for (size_t i = 0; i < data_len; i++) {
+        const char* p = strchr(charset, tolower(separator[1 + i]));
+        if (p == NULL || *p == '\0') {
+            return false;
+        }
+        values[i] = p - charset;
+        chk = bech32_polymod_step(chk) ^ values[i];
+    }
+
+    uint8_t witness_version = values[0];
+    uint32_t expected = witness_version == 0 ? 1 : 0x2bc830a3;
+    if (chk != expected || witness_version > 16) {
+        return false;
+    }
+
+    // regroup 5-bit values (minus version and checksum) into bytes
+    uint8_t program[40];
+    size_t program_len = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 1; i < data_len - 6; i++) {
+        acc = (acc << 5) | values[i];
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            if (program_len >= sizeof(program)) {
+                return false;
+            }
+            program[program_len++] = (acc >> bits) & 0xFF;
+        }
+    }
+    if (bits >= 5 || (acc & ((1 << bits) - 1)) != 0 || program_len < 2) {
+        return false;
+    }
+    if (witness_version == 0 && program_len != 20 && program_len != 32) {
+        return false;
+    }
+
+    // OP_n <program>
+    script_out[0] = witness_version == 0 ? 0x00 : 0x50 + witness_version;
+    script_out[1] = program_len;
+    memcpy(script_out + 2, program, program_len);
+    *script_len_out = program_len + 2;
+    return true;
+}
+
+// legacy p2pkh / p2sh address
+bool SoloClient::decode_base58check(const char* address, uint8_t* script_out, uint8_t* script_len_out) {
+    static const char* alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    // big-endian base256 accumulator, 25 bytes = version + hash160 + checksum
+    uint8_t decoded[25];
+    memset(decoded, 0, sizeof(decoded));
+
+    for (const char* c = address; *c; c++) {
+        const char* p = strchr(alphabet, *c);
+        if (p == NULL) {
+            return false;
+        }
+
+        uint32_t carry = p - alphabet;
+        for (int i = 24; i >= 0; i--) {
+            carry += 58 * decoded[i];
+            decoded[i] = carry & 0xFF;
+            carry >>= 8;
+        }
+        if (carry != 0) {
+            return false;
+        }
+    }
+
+    uint8_t checksum[32];
+    sha256d(decoded, 21, checksum);
+    if (memcmp(checksum, decoded + 21, 4) != 0) {
+        return false;
+    }
+
+    uint8_t address_version = decoded[0];
+    if (address_version == 0x00 || address_version == 0x6f) {
+        // OP_DUP OP_HASH160 <20> OP_EQUALVERIFY OP_CHECKSIG
+        script_out[0] = 0x76;
+        script_out[1] = 0xa9;
+        script_out[2] = 0x14;
+        memcpy(script_out + 3, decoded + 1, 20);
+        script_out[23] = 0x88;
+        script_out[24] = 0xac;
+        *script_len_out = 25;
+        return true;
+    }
+    if (address_version == 0x05 || address_version == 0xc4) {
+        // OP_HASH160 <20> OP_EQUAL
+        script_out[0] = 0xa9;
+        script_out[1] = 0x14;
+        memcpy(script_out + 2, decoded + 1, 20);
+        script_out[22] = 0x87;
+        *script_len_out = 23;
+        return true;
+    }
+
+    return false;
+}
+
+// helper: bitcoin compact size
+size_t SoloClient::write_varint(uint8_t* out, uint64_t value) {
+    if (value < 0xFD) {
+        out[0] = value;
+        return 1;
+    }
+
+    size_t size = value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8;
+    out[0] = size == 2 ? 0xFD : size == 4 ? 0xFE : 0xFF;
+    for (size_t i = 0; i < size; i++) {
+        out[1 + i] = (value >> (8 * i)) & 0xFF;
+    }
+    return size + 1;
+}
+
+// helper: bip34 height push, serialized like CScript() << height
+size_t SoloClient::write_height_push(uint8_t* out, uint32_t height_in) {
+    // small heights use OP_0 / OP_1..OP_16
+    if (height_in == 0) {
+        out[0] = 0x00;
+        return 1;
+    }
+    if (height_in <= 16) {
+        out[0] = 0x50 + height_in;
+        return 1;
+    }
+
+    // minimal little-endian script number, extra byte if the sign bit would be set
+    uint8_t len = 0;
+    uint32_t value = height_in;
+    while (value > 0) {
+        out[1 + len++] = value & 0xFF;
+        value >>= 8;
+    }
+    if (out[len] & 0x80) {
+        out[1 + len++] = 0x00;
+    }
+    out[0] = len;
+    return len + 1;
+}
+
+// helper: base64 with padding, out must hold 4 * ceil(len / 3) + 1 chars
+void SoloClient::base64_encode(const uint8_t* data, size_t len, char* out) {
+    static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t pos = 0;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t triple = data[i] << 16;
+        if (i + 1 < len) triple |= data[i + 1] << 8;
+        if (i + 2 < len) triple |= data[i + 2];
+
+        out[pos++] = table[(triple >> 18) & 0x3F];
+        out[pos++] = table[(triple >> 12) & 0x3F];
+        out[pos++] = i + 1 < len ? table[(triple >> 6) & 0x3F] : '=';
+        out[pos++] = i + 2 < len ? table[triple & 0x3F] : '=';
+    }
+    out[pos] = '\0';
+}
+
+// helper: convert hex string to bytes
+bool SoloClient::hex_to_bytes(const char* hex, uint8_t* bytes, size_t byte_len) {
+    for (size_t i = 0; i < byte_len; i++) {
+        uint8_t value = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = hex[i * 2 + j];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        bytes[i] = value;
+    }
+    return true;
+}
+
+// helper: stream bytes as lowercase hex
+void SoloClient::write_hex(TcpClient& client, const uint8_t* bytes, size_t len) {
+    static const char* hex_chars = "0123456789abcdef";
+    char chunk[64];
+    size_t pos = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        chunk[pos++] = hex_chars[(bytes[i] >> 4) & 0x0F];
+        chunk[pos++] = hex_chars[bytes[i] & 0x0F];
+        if (pos == sizeof(chunk)) {
+            client.write((const uint8_t*)chunk, pos);
+            pos = 0;
+        }
+    }
+    if (pos > 0) {
+        client.write((const uint8_t*)chunk, pos);
+    }
+}
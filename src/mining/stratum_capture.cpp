@@ -0,0 +1,424 @@
+// stratum_capture.cpp
+// records the pool session of a StratumClient and plays it back through the parser
+
+#include "mining/stratum_capture.h"
+#include "mining/stratum_client.h"
+
+static const uint8_t CAPTURE_MAGIC[5] = { 'S', 'C', 'A', 'P', STRATUM_CAPTURE_VERSION };
+
+// prefix of serial capture lines
+static const char CAPTURE_LINE_PREFIX[] = "[capture] ";
+
+// kind plus two 5-byte varints
+#define CAPTURE_RECORD_HEAD_MAX 11
+
+// 7 bits per byte, low bits first, returns bytes written
+static size_t put_varint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// one serial capture line, written in one call so other log output
+// cannot land in the middle of it
+static void write_hex_line(const uint8_t* head, size_t head_len, const uint8_t* data, size_t len) {
+    static char line[sizeof(CAPTURE_LINE_PREFIX) + 2 * (CAPTURE_RECORD_HEAD_MAX + STRATUM_CAPTURE_MAX_RECORD) + 2];
+    static const char digits[] = "0123456789abcdef";
+
+    size_t pos = sizeof(CAPTURE_LINE_PREFIX) - 1;
+    memcpy(line, CAPTURE_LINE_PREFIX, pos);
+    for (size_t i = 0; i < head_len + len; i++) {
+        uint8_t b = i < head_len ? head[i] : data[i - head_len];
+        line[pos++] = digits[b >> 4];
+        line[pos++] = digits[b & 0x0F];
+    }
+    line[pos++] = '\r';
+    line[pos++] = '\n';
+    Serial.write((const uint8_t*)line, pos);
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// ----- capture -----
+
+StratumCapture::StratumCapture() {
+    mode = capture_mode_t::OFF;
+    last_us = 0;
+    bytes = 0;
+}
+
+// start a capture, a file capture replaces the previous file
+bool StratumCapture::begin(capture_mode_t new_mode, const char* path) {
+    end();
+    if (new_mode == capture_mode_t::OFF) {
+        return true;
+    }
+
+    if (new_mode == capture_mode_t::FILE_LOG) {
+        file = platform_file_open(path, "w");
+        if (!file) {
+            Serial.print("[capture] cannot open ");
+            Serial.println(path);
+            return false;
+        }
+    }
+
+    mode = new_mode;
+    bytes = 0;
+    last_us = micros();
+    emit(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+
+    Serial.print("[capture] recording stratum session to ");
+    Serial.println(mode == capture_mode_t::FILE_LOG ? path : "serial");
+    return true;
+}
+
+// stop capturing, a file capture is closed and complete
+void StratumCapture::end() {
+    if (mode == capture_mode_t::OFF) {
+        return;
+    }
+    if (mode == capture_mode_t::FILE_LOG) {
+        file.close();
+    }
+    mode = capture_mode_t::OFF;
+
+    Serial.print("[capture] stopped after ");
+    Serial.print(bytes);
+    Serial.println(" bytes");
+}
+
+bool StratumCapture::is_active() {
+    return mode != capture_mode_t::OFF;
+}
+
+capture_mode_t StratumCapture::get_mode() {
+    return mode;
+}
+
+uint32_t StratumCapture::get_bytes() {
+    return bytes;
+}
+
+// append one record - a few byte writes, nothing is formatted for file captures
+void StratumCapture::record(capture_kind_t kind, const char* data, size_t len) {
+    if (mode == capture_mode_t::OFF) {
+        return;
+    }
+    if (len > STRATUM_CAPTURE_MAX_RECORD) {
+        len = STRATUM_CAPTURE_MAX_RECORD;
+    }
+
+    // micros() wraps after 71 minutes, the difference does not
+    uint32_t now = micros();
+    uint8_t head[CAPTURE_RECORD_HEAD_MAX];
+    size_t head_len = 0;
+    head[head_len++] = (uint8_t)kind;
+    head_len += put_varint(head + head_len, now - last_us);
+    head_len += put_varint(head + head_len, (uint32_t)len);
+    last_us = now;
+
+    if (mode == capture_mode_t::FILE_LOG) {
+        if (bytes + head_len + len > STRATUM_CAPTURE_MAX_BYTES) {
+            Serial.println("[capture] file full");
+            end();
+            return;
+        }
+        file.write(head, head_len);
+        file.write((const uint8_t*)data, len);
+        bytes += head_len + len;
+        return;
+    }
+
+    write_hex_line(head, head_len, (const uint8_t*)data, len);
+    bytes += head_len + len;
+}
+
+// push buffered file data out, a reset after this keeps the capture
+void StratumCapture::flush() {
+    if (mode == capture_mode_t::FILE_LOG) {
+        file.flush();
+    }
+}
+
+// magic record - written raw to a file, as its own hex line to serial
+void StratumCapture::emit(const uint8_t* data, size_t len) {
+    if (mode == capture_mode_t::FILE_LOG) {
+        file.write(data, len);
+    } else {
+        write_hex_line(data, len, NULL, 0);
+    }
+    bytes += len;
+}
+
+// ----- replay -----
+
+StratumReplay::StratumReplay() {
+    text = false;
+    decoded_len = 0;
+    decoded_pos = 0;
+    pushback_len = 0;
+    pushback_pos = 0;
+}
+
+// open a capture file, or a serial log containing "[capture]" lines
+bool StratumReplay::open(const char* path) {
+    close();
+    file = platform_file_open(path, "r");
+    if (!file) {
+        Serial.print("[capture] cannot open ");
+        Serial.println(path);
+        return false;
+    }
+
+    // a capture file starts with the magic, anything else is read as a serial log
+    uint8_t magic[sizeof(CAPTURE_MAGIC)];
+    pushback_len = 0;
+    pushback_pos = 0;
+    for (size_t i = 0; i < sizeof(magic); i++) {
+        int c = file.read();
+        if (c < 0) {
+            break;
+        }
+        magic[i] = (uint8_t)c;
+        pushback[pushback_len++] = (uint8_t)c;
+    }
+    if (pushback_len == sizeof(magic) && memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0) {
+        text = false;
+        pushback_len = 0;
+        return true;
+    }
+
+    // the first capture line of a serial log carries the magic
+    text = true;
+    size_t got = 0;
+    for (; got < sizeof(magic); got++) {
+        int c = read_byte();
+        if (c < 0) {
+            break;
+        }
+        magic[got] = (uint8_t)c;
+    }
+    if (got == sizeof(magic) && memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0) {
+        return true;
+    }
+
+    Serial.println("[capture] not a stratum capture (or another version)");
+    close();
+    return false;
+}
+
+// next record, data is cut to STRATUM_CAPTURE_MAX_RECORD
+bool StratumReplay::next(capture_record_t* record) {
+    if (!file) {
+        return false;
+    }
+
+    int kind = read_byte();
+    uint32_t delta_us;
+    uint32_t len;
+    if (kind < 0 || !read_varint(&delta_us) || !read_varint(&len)) {
+        return false;
+    }
+    if (kind > (int)capture_kind_t::DISCONNECTED) {
+        Serial.println("[capture] damaged record, replay stopped");
+        return false;
+    }
+
+    record->kind = (capture_kind_t)kind;
+    record->delta_us = delta_us;
+    record->len = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        int c = read_byte();
+        if (c < 0) {
+            Serial.println("[capture] capture ends inside a record");
+            return false;
+        }
+        if (record->len < STRATUM_CAPTURE_MAX_RECORD) {
+            record->data[record->len++] = (char)c;
+        }
+    }
+    record->data[record->len] = '\0';
+    return true;
+}
+
+void StratumReplay::close() {
+    if (file) {
+        file.close();
+    }
+    decoded_len = 0;
+    decoded_pos = 0;
+    pushback_len = 0;
+    pushback_pos = 0;
+}
+
+// file byte, the format check's bytes first
+int StratumReplay::read_raw() {
+    if (pushback_pos < pushback_len) {
+        return pushback[pushback_pos++];
+    }
+    return file.read();
+}
+
+// capture byte, decoded from the hex lines of a serial log
+int StratumReplay::read_byte() {
+    if (!text) {
+        return read_raw();
+    }
+    while (decoded_pos >= decoded_len) {
+        if (!next_text_line()) {
+            return -1;
+        }
+    }
+    return decoded[decoded_pos++];
+}
+
+bool StratumReplay::read_varint(uint32_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = read_byte();
+        if (c < 0) {
+            return false;
+        }
+        *value |= (uint32_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// decode the next "[capture] <hex>" line, other log lines are skipped
+bool StratumReplay::next_text_line() {
+    const size_t prefix_len = sizeof(CAPTURE_LINE_PREFIX) - 1;
+
+    for (;;) {
+        size_t matched = 0;
+        int high = -1;
+        decoded_len = 0;
+        decoded_pos = 0;
+
+        int c;
+        while ((c = read_raw()) >= 0 && c != '\n') {
+            if (matched < prefix_len) {
+                // still checking the prefix, a mismatch skips the rest of the line
+                matched = c == CAPTURE_LINE_PREFIX[matched] ? matched + 1 : prefix_len + 1;
+                continue;
+            }
+            if (matched > prefix_len) {
+                continue;
+            }
+            int v = hex_value(c);
+            if (v < 0) {
+                // status lines share the prefix, a record line is hex only
+                if (c != '\r') {
+                    matched = prefix_len + 1;
+                }
+                continue;
+            }
+            if (high < 0) {
+                high = v;
+            } else if (decoded_len < sizeof(decoded)) {
+                decoded[decoded_len++] = (uint8_t)((high << 4) | v);
+                high = -1;
+            }
+        }
+
+        if (matched == prefix_len && decoded_len > 0 && high < 0) {
+            return true;
+        }
+        if (c < 0) {
+            return false;
+        }
+    }
+}
+
+// ----- replay driver -----
+
+bool stratum_replay_run(StratumClient& client, const char* path, bool realtime, replay_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    // a record holds a full line, too much for the loop task's stack
+    StratumReplay* replay = new StratumReplay();
+    capture_record_t* record = new capture_record_t;
+    if (!replay->open(path)) {
+        delete record;
+        delete replay;
+        return false;
+    }
+
+    // serial logging of every line would be most of what gets timed
+    client.set_quiet(true);
+
+    unsigned long start_ms = millis();
+    uint32_t last_line_us = micros();
+    uint32_t gap_us = 0;             // capture time since the last replayed line
+
+    while (replay->next(record)) {
+        gap_us += record->delta_us;
+
+        if (record->kind == capture_kind_t::CONNECTED) {
+            stats->sessions++;
+            continue;
+        }
+        if (record->kind != capture_kind_t::RECEIVED) {
+            if (record->kind == capture_kind_t::SENT) {
+                stats->skipped++;
+            }
+            continue;
+        }
+
+        if (realtime) {
+            uint32_t waited = micros() - last_line_us;
+            if (waited < gap_us) {
+                uint32_t wait_us = gap_us - waited;
+                delay(wait_us / 1000);
+                delayMicroseconds(wait_us % 1000);
+            }
+        }
+        gap_us = 0;
+
+        // a job switch is the notify plus the first header of the new job,
+        // subscribe responses name mining.notify too but have no method
+        bool notify = strstr(record->data, "\"method\"") != NULL &&
+                      strstr(record->data, "mining.notify") != NULL;
+
+        uint32_t t0 = micros();
+        client.replay_line(record->data);
+        if (notify && client.has_work()) {
+            uint8_t header[80];
+            client.build_block_header(header);
+        }
+        uint32_t us = micros() - t0;
+        last_line_us = micros();
+
+        stats->lines++;
+        stats->parse_us += us;
+        if (us > stats->parse_max_us) {
+            stats->parse_max_us = us;
+        }
+        if (notify) {
+            stats->notifies++;
+            stats->switch_us += us;
+            if (us > stats->switch_max_us) {
+                stats->switch_max_us = us;
+            }
+        }
+    }
+
+    stats->elapsed_ms = millis() - start_ms;
+    client.set_quiet(false);
+    replay->close();
+    delete record;
+    delete replay;
+    return true;
+}
@@ -3,24 +3,51 @@
 
 #include "mining/stratum_client.h"
 #include "mining/sha256_miner.h"
+#include "mining/dns_cache.h"
+#include "mining/profiler.h"
+#include "mining/log_ring.h"
 #include <ArduinoJson.h>
 
 // constructor - initialize all state
 StratumClient::StratumClient() {
     recv_buffer_pos = 0;
     recv_buffer[0] = '\0';
+    send_buffer_pos = 0;
+    send_queued_ms = 0;
     
+    subscription_id[0] = '\0';
+    subscription_host[0] = '\0';
     extranonce1[0] = '\0';
     extranonce1_len = 0;
     extranonce2_len = 4;  // default, pool will tell us actual value
     extranonce2_counter = 0;
+    job_extranonce2_start = 0;
+    extranonce2_prefix_enabled = false;
+    extranonce2_prefix = 0;
+    extranonce2_partition_enabled = false;
+    extranonce2_partition = 0;
+    relay = NULL;
+    capture = NULL;
+    quiet = false;
+    tls_enabled = false;
+    transport = &tcp_client;
     
     current_job.valid = false;
+    work_sequence = 0;
+    worker_full[0] = '\0';
     current_difficulty = 1.0;
     message_id = 1;
+    connection_count = 0;
+    authorize_id = 0;
+    last_submit_id = 0;
+    memset(pending_submits, 0, sizeof(pending_submits));
     
     shares_accepted = 0;
     shares_rejected = 0;
+    shares_duplicate = 0;
+    submits_evicted = 0;
+    accepted_difficulty = 0.0;
+    submit_latency_ms = 0;
     
     // initialize target to max value (easiest difficulty)
     memset(target, 0xFF, 32);
@@ -33,61 +60,219 @@ bool StratumClient::connect(const char* host, uint16_t port) {
     Serial.print(":");
     Serial.println(port);
     
-    // attempt tcp connection with 10 second timeout
-    if (!tcp_client.connect(host, port)) {
+    // tcp connection with 10 second timeout, plus the handshake for tls
+    // the address comes from the dns cache, tls still needs the name
+    transport->stop();
+    transport = tls_enabled ? (Client*)&tls_client : (Client*)&tcp_client;
+    tls_client.set_server_name(host);
+    if (!dns_cache.connect(*transport, host, port)) {
         Serial.println("[stratum] connection failed");
         return false;
     }
     
     Serial.println("[stratum] connected");
     
+    if (capture != NULL) {
+        char endpoint[80];
+        int len = snprintf(endpoint, sizeof(endpoint), "%s:%u", host, port);
+        capture->record(capture_kind_t::CONNECTED, endpoint, min(len, (int)sizeof(endpoint) - 1));
+    }
+    
+    // a subscription id is only worth offering to the pool that issued it
+    if (strcmp(host, subscription_host) != 0) {
+        subscription_id[0] = '\0';
+        strncpy(subscription_host, host, sizeof(subscription_host) - 1);
+        subscription_host[sizeof(subscription_host) - 1] = '\0';
+    }
+    
     // reset state for new connection
     recv_buffer_pos = 0;
-    message_id = 1;
+    send_buffer_pos = 0;
+    connection_count++;
+    authorize_id = 0;
+    memset(pending_submits, 0, sizeof(pending_submits));
     current_job.valid = false;
-    extranonce2_counter = 0;
+    
+    // extranonce2 counter is kept until subscribe shows whether the session resumed
     
     return true;
 }
 
 // disconnect from pool
 void StratumClient::disconnect() {
-    if (tcp_client.connected()) {
-        tcp_client.stop();
+    // always stop, a dead tls connection still holds its ssl context
+    bool was_connected = transport->connected();
+    transport->stop();
+    if (was_connected) {
         Serial.println("[stratum] disconnected");
+        if (capture != NULL) {
+            capture->record(capture_kind_t::DISCONNECTED, "", 0);
+            capture->flush();
+        }
     }
+    // queued submits belong to the old session
+    send_buffer_pos = 0;
     current_job.valid = false;
 }
 
+// use tls for the next connect ("stratum+ssl://" pools)
+void StratumClient::set_tls(bool enabled) {
+    tls_enabled = enabled;
+}
+
+// check if tls is used
+bool StratumClient::is_tls() {
+    return tls_enabled;
+}
+
+// get tls transport, for handshake stats
+TlsClient* StratumClient::get_tls_client() {
+    return &tls_client;
+}
+
 // check if connected to pool
 bool StratumClient::is_connected() {
-    return tcp_client.connected();
+    return transport->connected();
 }
 
 // send raw message to pool (adds newline terminator)
+// anything already queued goes out in the same write
 bool StratumClient::send_message(const char* message) {
-    if (!tcp_client.connected()) {
+    if (!transport->connected()) {
+        return false;
+    }
+    
+    size_t len = strlen(message);
+    if (send_buffer_pos + len + 1 > STRATUM_SEND_BUFFER_SIZE) {
+        flush();
+    }
+    
+    if (len + 1 > STRATUM_SEND_BUFFER_SIZE) {
+        // larger than the buffer, cannot happen with our request sizes
+        transport->write((const uint8_t*)message, len);
+        transport->write((uint8_t)'\n');
+    } else {
+        memcpy(send_buffer + send_buffer_pos, message, len);
+        send_buffer_pos += len;
+        send_buffer[send_buffer_pos++] = '\n';
+        flush();
+    }
+    
+    if (capture != NULL) {
+        capture->record(capture_kind_t::SENT, message, len);
+    }
+    
+    if (!quiet) {
+        LOG_DEBUG("[stratum] sent: %s", message);
+    }
+    
+    return transport->connected();
+}
+
+// write everything queued with a single call so it leaves as one segment
+void StratumClient::flush() {
+    if (send_buffer_pos == 0) {
+        return;
+    }
+    
+    if (transport->connected()) {
+        transport->write((const uint8_t*)send_buffer, send_buffer_pos);
+    }
+    send_buffer_pos = 0;
+}
+
+// queue a mining.submit without going through ArduinoJson
+// format: {"id":n,"method":"mining.submit","params":["worker","job_id","extranonce2","ntime","nonce"]}
+bool StratumClient::queue_submit(uint32_t id, const char* job_id, const char* extranonce2_hex,
+                                 const char* ntime_hex, const char* nonce_hex) {
+    if (!transport->connected()) {
         return false;
     }
     
-    tcp_client.print(message);
-    tcp_client.print("\n");
+    // room for the fixed text plus every string character escaped
+    size_t needed = 96 + 2 * (strlen(worker_full) + strlen(job_id) + strlen(extranonce2_hex) +
+                              strlen(ntime_hex) + strlen(nonce_hex));
+    if (needed > STRATUM_SEND_BUFFER_SIZE) {
+        Serial.println("[stratum] submit too large, dropped");
+        return false;
+    }
+    if (send_buffer_pos + needed > STRATUM_SEND_BUFFER_SIZE) {
+        flush();
+    }
+    if (send_buffer_pos == 0) {
+        send_queued_ms = millis();
+    }
     
-    Serial.print("[stratum] sent: ");
-    Serial.println(message);
+    uint16_t start = send_buffer_pos;
+    char id_str[12];
+    snprintf(id_str, sizeof(id_str), "%lu", (unsigned long)id);
+    
+    append_raw("{\"id\":");
+    append_raw(id_str);
+    append_raw(",\"method\":\"mining.submit\",\"params\":[");
+    append_json_string(worker_full);
+    append_raw(",");
+    append_json_string(job_id);
+    append_raw(",");
+    append_json_string(extranonce2_hex);
+    append_raw(",");
+    append_json_string(ntime_hex);
+    append_raw(",");
+    append_json_string(nonce_hex);
+    append_raw("]}");
+    
+    // timestamped when queued, the flush follows within STRATUM_SEND_FLUSH_MS
+    if (capture != NULL) {
+        capture->record(capture_kind_t::SENT, send_buffer + start, send_buffer_pos - start);
+    }
+    
+    if (!quiet) {
+        LOG_DEBUG("[stratum] queued: %s", log_span(send_buffer + start, send_buffer_pos - start));
+    }
     
+    send_buffer[send_buffer_pos++] = '\n';
     return true;
 }
 
+// append text to the send buffer, caller has checked the room
+void StratumClient::append_raw(const char* str) {
+    while (*str && send_buffer_pos < STRATUM_SEND_BUFFER_SIZE - 1) {
+        send_buffer[send_buffer_pos++] = *str++;
+    }
+}
+
+// append a quoted json string, escaping quotes and backslashes
+// control characters never appear in ids or hex fields and are dropped
+void StratumClient::append_json_string(const char* str) {
+    send_buffer[send_buffer_pos++] = '"';
+    for (; *str && send_buffer_pos < STRATUM_SEND_BUFFER_SIZE - 3; str++) {
+        char c = *str;
+        if ((uint8_t)c < 0x20) {
+            continue;
+        }
+        if (c == '"' || c == '\\') {
+            send_buffer[send_buffer_pos++] = '\\';
+        }
+        send_buffer[send_buffer_pos++] = c;
+    }
+    send_buffer[send_buffer_pos++] = '"';
+}
+
 // mining.subscribe - initiate session with pool
 // pool responds with extranonce1 and extranonce2_size
 bool StratumClient::subscribe() {
     // build subscribe request
     // format: {"id": 1, "method": "mining.subscribe", "params": []}
+    // after a reconnect: "params": ["user agent", "subscription id"], pools that
+    // support resuming hand back the same extranonce1 so unanswered shares stay valid
     StaticJsonDocument<256> doc;
     doc["id"] = message_id++;
     doc["method"] = "mining.subscribe";
-    doc.createNestedArray("params");
+    JsonArray params = doc.createNestedArray("params");
+    if (subscription_id[0] != '\0') {
+        params.add("esp32btcminer");
+        params.add(subscription_id);
+    }
     
     char buffer[256];
     serializeJson(doc, buffer);
@@ -100,21 +285,22 @@ bool StratumClient::authorize(const char* wallet_address, const char* worker_nam
     // build authorize request
     // format: {"id": 2, "method": "mining.authorize", "params": ["wallet.worker", "x"]}
     StaticJsonDocument<512> doc;
-    doc["id"] = message_id++;
+    authorize_id = message_id++;
+    doc["id"] = authorize_id;
     doc["method"] = "mining.authorize";
     
     JsonArray params = doc.createNestedArray("params");
     
     // combine wallet and worker name with dot separator
-    char full_worker[128];
+    // kept for submits, pools match shares to the authorized worker
     if (worker_name && strlen(worker_name) > 0) {
-        snprintf(full_worker, sizeof(full_worker), "%s.%s", wallet_address, worker_name);
+        snprintf(worker_full, sizeof(worker_full), "%s.%s", wallet_address, worker_name);
     } else {
-        strncpy(full_worker, wallet_address, sizeof(full_worker) - 1);
-        full_worker[sizeof(full_worker) - 1] = '\0';
+        strncpy(worker_full, wallet_address, sizeof(worker_full) - 1);
+        worker_full[sizeof(worker_full) - 1] = '\0';
     }
     
-    params.add(full_worker);
+    params.add(worker_full);
     params.add("x");  // password (usually ignored by pools)
     
     char buffer[512];
@@ -123,61 +309,71 @@ bool StratumClient::authorize(const char* wallet_address, const char* worker_nam
     return send_message(buffer);
 }
 
-// mining.submit - send valid share to pool
-bool StratumClient::submit_share(const char* job_id, uint32_t ntime, uint32_t nonce) {
-    // build submit request
-    // format: {"id": n, "method": "mining.submit", 
-    //          "params": ["worker", "job_id", "extranonce2", "ntime", "nonce"]}
-    StaticJsonDocument<512> doc;
-    doc["id"] = message_id++;
-    doc["method"] = "mining.submit";
-    
-    JsonArray params = doc.createNestedArray("params");
-    
-    // worker name (we'll use a placeholder, mining_manager should set this properly)
-    params.add("worker");
+// mining.submit - queue valid share for the pool
+// goes out on the next flush, together with any other share found this tick
+bool StratumClient::submit_share(const char* job_id, uint32_t extranonce2, uint32_t ntime, uint32_t nonce) {
+    PROFILE_SCOPE(SUBMIT_SHARE);
     
-    // job id from mining.notify
-    params.add(job_id);
+    uint32_t submit_id = message_id++;
     
-    // extranonce2 as hex string
-    char extranonce2_hex[32];
-    uint8_t extranonce2_bytes[8];
-    for (int i = 0; i < extranonce2_len; i++) {
-        extranonce2_bytes[i] = (extranonce2_counter >> (8 * i)) & 0xFF;
-    }
+    // extranonce2 as hex string - must be the value the header was built with
+    char extranonce2_hex[STRATUM_MAX_EXTRANONCE2_SIZE * 2 + 1];
+    uint8_t extranonce2_bytes[STRATUM_MAX_EXTRANONCE2_SIZE];
+    write_extranonce2(extranonce2, extranonce2_bytes);
     bytes_to_hex(extranonce2_bytes, extranonce2_len, extranonce2_hex);
-    params.add(extranonce2_hex);
     
     // ntime as hex string (8 characters, big-endian)
     char ntime_hex[16];
     snprintf(ntime_hex, sizeof(ntime_hex), "%08x", ntime);
-    params.add(ntime_hex);
     
     // nonce as hex string (8 characters, little-endian for display but we send as pool expects)
     char nonce_hex[16];
     snprintf(nonce_hex, sizeof(nonce_hex), "%08x", nonce);
-    params.add(nonce_hex);
     
-    char buffer[512];
-    serializeJson(doc, buffer);
+    LOG_INFO("[stratum] submitting share - nonce: %s", nonce_hex);
     
-    Serial.print("[stratum] submitting share - nonce: ");
-    Serial.println(nonce_hex);
+    if (!queue_submit(submit_id, job_id, extranonce2_hex, ntime_hex, nonce_hex)) {
+        return false;
+    }
     
-    return send_message(buffer);
+    // remember what this share is worth so the response can credit it
+    // only once it is queued, a failed submit must not look pending
+    pending_submit_t* slot = claim_pending_submit();
+    slot->id = submit_id;
+    slot->difficulty = current_difficulty;
+    slot->submitted_ms = millis();
+    last_submit_id = submit_id;
+    
+    return true;
+}
+
+// mining.submit on behalf of a downstream miner - fields are passed through as hex
+// the response goes to the relay, not to this client's share counters
+uint32_t StratumClient::submit_relayed(const char* job_id, const char* extranonce2_hex,
+                                       const char* ntime_hex, const char* nonce_hex) {
+    uint32_t submit_id = message_id++;
+    
+    if (!queue_submit(submit_id, job_id, extranonce2_hex, ntime_hex, nonce_hex)) {
+        return 0;
+    }
+    return submit_id;
 }
 
 // process incoming data from pool
 // call this regularly in main loop
 void StratumClient::process() {
-    if (!tcp_client.connected()) {
+    if (!transport->connected()) {
         return;
     }
     
+    // submits queued outside a manager tick (relayed ones) go out on a deadline
+    if (send_buffer_pos > 0 && millis() - send_queued_ms >= STRATUM_SEND_FLUSH_MS) {
+        flush();
+    }
+    
     // read available data into buffer
-    while (tcp_client.available()) {
-        char c = tcp_client.read();
+    while (transport->available()) {
+        char c = transport->read();
         
         // stratum uses newline-delimited json messages
         if (c == '\n') {
@@ -185,6 +381,9 @@ void StratumClient::process() {
             recv_buffer[recv_buffer_pos] = '\0';
             
             if (recv_buffer_pos > 0) {
+                if (capture != NULL) {
+                    capture->record(capture_kind_t::RECEIVED, recv_buffer, recv_buffer_pos);
+                }
                 process_line(recv_buffer);
             }
             
@@ -200,8 +399,11 @@ void StratumClient::process() {
 
 // process a complete json line from pool
 void StratumClient::process_line(const char* line) {
-    Serial.print("[stratum] recv: ");
-    Serial.println(line);
+    PROFILE_SCOPE(PROCESS_LINE);
+    
+    if (!quiet) {
+        LOG_DEBUG("[stratum] recv: %s", line);
+    }
     
     // parse json
     StaticJsonDocument<2048> doc;
@@ -220,8 +422,11 @@ void StratumClient::process_line(const char* line) {
         
         if (strcmp(method, "mining.notify") == 0) {
             // new work available
-            JsonArray params = doc["params"];
             handle_notify(line);  // pass full line for detailed parsing
+            
+            if (relay != NULL) {
+                relay->relay_notify(line);
+            }
         } else if (strcmp(method, "mining.set_difficulty") == 0) {
             // difficulty adjustment
             JsonArray params = doc["params"];
@@ -229,6 +434,10 @@ void StratumClient::process_line(const char* line) {
                 double diff = params[0];
                 handle_set_difficulty(diff);
             }
+            
+            if (relay != NULL) {
+                relay->relay_set_difficulty(line);
+            }
         }
     } else if (doc.containsKey("result")) {
         // this is a response to one of our requests
@@ -236,30 +445,32 @@ void StratumClient::process_line(const char* line) {
         
         JsonVariant result = doc["result"];
         JsonVariant err = doc["error"];
+        uint32_t id = doc["id"] | 0;
         
         // check if it's a subscribe response (result is array with subscription info)
         if (result.is<JsonArray>() && result[0].is<JsonArray>()) {
             // subscribe response format: [[["mining.notify", "subscription_id"]], "extranonce1", extranonce2_size]
             handle_subscribe_response(line);
-        } else if (result.is<bool>()) {
-            // authorize or submit response (result is true/false)
-            bool success = result.as<bool>();
+        } else {
+            // authorize or submit response - true/false, or a null result with
+            // an error, which is how most pools reject a share
+            bool success = result.is<bool>() && result.as<bool>() && err.isNull();
+            int error_code = err[0] | 0;
             
-            // we track message types by id, but for simplicity we just check
-            // if we already have extranonce (meaning we've subscribed)
-            if (extranonce1_len > 0) {
-                // this is likely an authorize or submit response
-                // check error field to determine outcome
-                if (!err.isNull()) {
-                    Serial.print("[stratum] error: ");
-                    serializeJson(err, Serial);
-                    Serial.println();
-                    shares_rejected++;
-                } else if (success) {
-                    // could be authorize success or share accepted
-                    Serial.println("[stratum] operation successful");
-                    shares_accepted++;
-                }
+            if (!err.isNull()) {
+                Serial.print("[stratum] error: ");
+                serializeJson(err, Serial);
+                Serial.println();
+            }
+            
+            // match by message id so authorize results are not counted as shares
+            // and a failed subscribe is not taken for a rejected share
+            if (id != 0 && id == authorize_id) {
+                handle_authorize_response(success);
+            } else if (relay != NULL && relay->relay_submit_response(id, success)) {
+                // downstream share, credited to the downstream miner by the relay
+            } else if (extranonce1_len > 0 && (result.is<bool>() || is_submit_pending(id))) {
+                handle_submit_response(id, success, error_code);
             }
         }
     }
@@ -277,8 +488,24 @@ void StratumClient::handle_subscribe_response(const char* result) {
     // extranonce1 is at index 1, extranonce2_size is at index 2
     
     if (res.size() >= 3) {
-        const char* en1 = res[1];
-        int en2_size = res[2];
+        const char* en1 = res[1] | "";
+        int en2_size = res[2] | -1;
+        
+        // submits and the coinbase builder have room for this much extranonce2
+        if (en2_size < 0 || en2_size > STRATUM_MAX_EXTRANONCE2_SIZE) {
+            Serial.print("[stratum] extranonce2_size ");
+            Serial.print(en2_size);
+            Serial.println(" not supported, disconnecting");
+            disconnect();
+            return;
+        }
+        
+        // same extranonce1 as before means the pool resumed our session, the
+        // counter carries on so the coinbases we already searched are not repeated
+        if (strcmp(en1, extranonce1) != 0) {
+            extranonce2_counter = 0;
+            job_extranonce2_start = 0;
+        }
         
         // store extranonce1
         strncpy(extranonce1, en1, sizeof(extranonce1) - 1);
@@ -289,6 +516,20 @@ void StratumClient::handle_subscribe_response(const char* result) {
         // store extranonce2 size
         extranonce2_len = en2_size;
         
+        // remember the mining.notify subscription id for session resumption
+        const char* sub_id = NULL;
+        for (JsonVariant sub : res[0].as<JsonArray>()) {
+            if (sub.is<JsonArray>() && strcmp(sub[0] | "", "mining.notify") == 0) {
+                sub_id = sub[1];
+            }
+        }
+        if (sub_id != NULL) {
+            strncpy(subscription_id, sub_id, sizeof(subscription_id) - 1);
+            subscription_id[sizeof(subscription_id) - 1] = '\0';
+        } else {
+            subscription_id[0] = '\0';
+        }
+        
         Serial.print("[stratum] subscribed - extranonce1: ");
         Serial.print(extranonce1);
         Serial.print(", extranonce2_size: ");
@@ -296,6 +537,52 @@ void StratumClient::handle_subscribe_response(const char* result) {
     }
 }
 
+// handle mining.authorize response
+void StratumClient::handle_authorize_response(bool success) {
+    authorize_id = 0;
+    
+    if (success) {
+        Serial.println("[stratum] authorized");
+    } else {
+        Serial.println("[stratum] authorization failed");
+    }
+}
+
+// handle mining.submit response
+// any answer ends the submit, a rejected share is never sent again
+void StratumClient::handle_submit_response(uint32_t id, bool accepted, int error_code) {
+    // look up the difficulty this share was submitted at
+    double difficulty = current_difficulty;
+    pending_submit_t* slot = find_pending_submit(id);
+    if (slot != NULL) {
+        difficulty = slot->difficulty;
+        slot->id = 0;
+        
+        // round trip including our send coalescing, 1/8 weight per answer
+        uint32_t latency = millis() - slot->submitted_ms;
+        if (submit_latency_ms == 0) {
+            submit_latency_ms = latency > 0 ? latency : 1;
+        } else {
+            submit_latency_ms = (submit_latency_ms * 7 + latency + 4) / 8;
+        }
+    }
+    
+    if (accepted) {
+        shares_accepted++;
+        accepted_difficulty += difficulty;
+        LOG_INFO("[stratum] share accepted");
+    } else if (error_code == STRATUM_ERROR_DUPLICATE) {
+        // a replay whose first submit got through before the disconnect,
+        // or another device hashing the same coinbase
+        shares_rejected++;
+        shares_duplicate++;
+        LOG_INFO("[stratum] share rejected as duplicate, pool already has it");
+    } else {
+        shares_rejected++;
+        LOG_INFO("[stratum] share rejected");
+    }
+}
+
 // handle mining.notify - new work from pool
 void StratumClient::handle_notify(const char* line) {
     StaticJsonDocument<2048> doc;
@@ -325,8 +612,12 @@ void StratumClient::handle_notify(const char* line) {
     strncpy(current_job.job_id, job_id, sizeof(current_job.job_id) - 1);
     current_job.job_id[sizeof(current_job.job_id) - 1] = '\0';
     
-    // store prev hash (needs byte reversal for header)
+    // store prev hash in header byte order
+    // stratum sends it as 8 words with the bytes of each word reversed
     hex_to_bytes(prev_hash_hex, current_job.prev_hash, 32);
+    for (int i = 0; i < 32; i += 4) {
+        reverse_bytes(current_job.prev_hash + i, 4);
+    }
     
     // store coinbase parts
     strncpy(current_job.coinbase1, coinbase1, sizeof(current_job.coinbase1) - 1);
@@ -347,25 +638,31 @@ void StratumClient::handle_notify(const char* line) {
     current_job.nbits = strtoul(nbits_hex, NULL, 16);
     current_job.ntime = strtoul(ntime_hex, NULL, 16);
     
+    // full network target so every share can be checked for a block
+    nbits_to_target(current_job.nbits, current_job.network_target);
+    
     current_job.clean_jobs = clean;
     current_job.valid = true;
     
     // increment extranonce2 for new work
     extranonce2_counter++;
+    job_extranonce2_start = extranonce2_counter;
+    work_sequence++;
     
-    Serial.print("[stratum] new job: ");
-    Serial.print(job_id);
-    Serial.print(", clean: ");
-    Serial.println(clean ? "yes" : "no");
+    if (!quiet) {
+        LOG_INFO("[stratum] new job: %s, clean: %s", job_id, clean ? "yes" : "no");
+    }
 }
 
 // handle mining.set_difficulty
 void StratumClient::handle_set_difficulty(double difficulty) {
     current_difficulty = difficulty;
     difficulty_to_target(difficulty, target);
+    work_sequence++;
     
-    Serial.print("[stratum] difficulty set to: ");
-    Serial.println(difficulty, 8);
+    if (!quiet) {
+        LOG_INFO("[stratum] difficulty set to: %.8f", difficulty);
+    }
 }
 
 // convert pool difficulty to 32-byte target
@@ -375,23 +672,7 @@ void StratumClient::difficulty_to_target(double difficulty, uint8_t* target_out)
     // 
     // target = diff1_target / difficulty
     //
-    // for simplicity, we compute this by setting bytes based on difficulty
-    
-    // start with all zeros (hardest possible)
-    memset(target_out, 0, 32);
-    
-    // calculate target from difficulty
-    // diff 1 = 0xffff * 2^208
-    // target = (0xffff * 2^208) / difficulty
-    
-    // simplified approach: set leading bytes based on log2(difficulty)
-    // this is approximate but works for pool mining
-    
-    double target_val = 65535.0 / difficulty;  // 0xFFFF / diff
-    
-    // find position and value
-    // target bytes 29-30 hold the main value at diff 1
-    // as difficulty increases, we shift right (toward byte 31)
+    // target is stored little-endian, so the 0xffff of diff 1 sits in bytes 26-27
     
     if (difficulty <= 0) {
         // invalid difficulty, set easiest target
@@ -399,38 +680,32 @@ void StratumClient::difficulty_to_target(double difficulty, uint8_t* target_out)
         return;
     }
     
-    // compute full precision target
-    // we'll use a simpler method: pdiff (pool difficulty) format
-    // target = 0x00000000FFFFFFFF... / difficulty
-    
-    uint64_t base = 0xFFFFFFFFFFFFFFFFULL;
-    uint64_t target_high = (uint64_t)(base / difficulty);
-    
-    // store in bytes 24-31 (big endian position for the significant part)
-    // but remember bitcoin is little endian, so we need to be careful
+    // diff1 target = 0xffff * 2^208, divide in floating point
+    // double keeps 53 significant bits which is plenty for share targets
+    double remaining = ldexp(65535.0, 208) / difficulty;
     
-    // actually, let's use a more straightforward approach
-    // that matches what pools expect
-    
-    // pdiff target calculation:
-    // target[0-3] = 0x00000000
-    // target[4-7] = 0xFFFF0000 / difficulty (approximately)
-    
-    // for pool difficulties, we can use this simpler formula:
-    // the target is essentially how many leading zero bits are required
-    
-    // reset target to known diff-1 value and divide
-    memset(target_out, 0, 32);
-    target_out[29] = 0xFF;
-    target_out[30] = 0xFF;
+    if (remaining >= ldexp(1.0, 256)) {
+        // difficulty below minimum representable, easiest target
+        memset(target_out, 0xFF, 32);
+        return;
+    }
     
-    // scale down based on difficulty
-    // this is a simplified approach - divide the target value
-    if (difficulty > 1.0) {
-        double scaled = 0xFFFF / difficulty;
-        uint16_t val = (uint16_t)scaled;
-        target_out[29] = val & 0xFF;
-        target_out[30] = (val >> 8) & 0xFF;
+    // peel off 64-bit limbs from most significant to least significant
+    for (int limb = 3; limb >= 0; limb--) {
+        double scale = ldexp(1.0, 64 * limb);
+        double part = floor(remaining / scale);
+        
+        // guard against rounding pushing a limb past 64 bits
+        uint64_t value = (part >= ldexp(1.0, 64)) ? 0xFFFFFFFFFFFFFFFFULL : (uint64_t)part;
+        remaining -= (double)value * scale;
+        if (remaining < 0) {
+            remaining = 0;
+        }
+        
+        // store limb little-endian
+        for (int i = 0; i < 8; i++) {
+            target_out[limb * 8 + i] = (value >> (8 * i)) & 0xFF;
+        }
     }
 }
 
@@ -455,7 +730,7 @@ void StratumClient::build_block_header(uint8_t* header_out) {
     header_out[2] = (current_job.version >> 16) & 0xFF;
     header_out[3] = (current_job.version >> 24) & 0xFF;
     
-    // previous block hash (already in correct byte order from pool)
+    // previous block hash (swapped into header order by handle_notify)
     memcpy(header_out + 4, current_job.prev_hash, 32);
     
     // merkle root (computed from coinbase + merkle branches)
@@ -484,6 +759,8 @@ void StratumClient::build_block_header(uint8_t* header_out) {
 
 // compute merkle root from coinbase transaction and merkle branches
 void StratumClient::compute_merkle_root(uint8_t* merkle_root_out) {
+    PROFILE_SCOPE(MERKLE_ROOT);
+    
     // step 1: build coinbase transaction
     // coinbase = coinbase1 + extranonce1 + extranonce2 + coinbase2
     
@@ -504,10 +781,9 @@ void StratumClient::compute_merkle_root(uint8_t* merkle_root_out) {
     memcpy(coinbase + pos, extranonce1_bytes, extranonce1_len);
     pos += extranonce1_len;
     
-    // extranonce2 (our counter, little-endian)
-    for (int i = 0; i < extranonce2_len; i++) {
-        coinbase[pos++] = (extranonce2_counter >> (8 * i)) & 0xFF;
-    }
+    // extranonce2 (our counter, optional prefix byte first)
+    write_extranonce2(extranonce2_counter, coinbase + pos);
+    pos += extranonce2_len;
     
     // coinbase2
     hex_to_bytes(current_job.coinbase2, coinbase + pos, cb2_len);
@@ -556,6 +832,99 @@ uint32_t StratumClient::get_current_ntime() {
     return current_job.ntime;
 }
 
+// get extranonce2 value build_block_header() uses for the current job
+uint32_t StratumClient::get_current_extranonce2() {
+    return extranonce2_counter;
+}
+
+// next extranonce2 for the current job, once workers spent all its nonces
+// refused when the counter bytes left after prefix and device id would wrap
+// back onto a value this job already used
+bool StratumClient::roll_extranonce2() {
+    if (!current_job.valid) {
+        return false;
+    }
+    
+    int counter_len = extranonce2_len;
+    if (extranonce2_prefix_enabled && extranonce2_len >= 2) {
+        counter_len--;
+    }
+    if (is_extranonce2_partitioned()) {
+        counter_len -= 2;
+    }
+    if (counter_len < 4 && extranonce2_counter + 1 - job_extranonce2_start >= (1UL << (8 * counter_len))) {
+        return false;
+    }
+    
+    extranonce2_counter++;
+    work_sequence++;
+    return true;
+}
+
+// get network difficulty bits of current job
+uint32_t StratumClient::get_current_nbits() {
+    return current_job.nbits;
+}
+
+// get session id - shares are built on extranonce1, so it identifies the session
+const char* StratumClient::get_session_id() {
+    return extranonce1;
+}
+
+// get 32-byte block target of current job
+void StratumClient::get_network_target(uint8_t* target_out) {
+    memcpy(target_out, current_job.network_target, 32);
+}
+
+// get work sequence - changes whenever a new header or target must be built
+uint32_t StratumClient::get_work_sequence() {
+    return work_sequence;
+}
+
+// get message id of the most recent submit
+uint32_t StratumClient::get_last_submit_id() {
+    return last_submit_id;
+}
+
+// check if a submit is still waiting for the pool's answer
+bool StratumClient::is_submit_pending(uint32_t id) {
+    return find_pending_submit(id) != NULL;
+}
+
+// free pending slot for a new submit - ids are not consecutive (relayed
+// submits and requests use them too), so slots are searched, not indexed
+// with every slot busy the oldest is forgotten and counted, its share is
+// then lost: no longer pending, and its answer falls back to the current difficulty
+pending_submit_t* StratumClient::claim_pending_submit() {
+    pending_submit_t* oldest = &pending_submits[0];
+    for (int i = 0; i < STRATUM_MAX_PENDING_SUBMITS; i++) {
+        pending_submit_t* slot = &pending_submits[i];
+        if (slot->id == 0) {
+            return slot;
+        }
+        if ((int32_t)(slot->submitted_ms - oldest->submitted_ms) < 0) {
+            oldest = slot;
+        }
+    }
+    
+    submits_evicted++;
+    LOG_WARN("[stratum] %u submits unanswered, forgetting id %u", (unsigned)STRATUM_MAX_PENDING_SUBMITS, oldest->id);
+    return oldest;
+}
+
+// pending slot of a submit, NULL once answered or forgotten
+pending_submit_t* StratumClient::find_pending_submit(uint32_t id) {
+    if (id == 0) {
+        return NULL;
+    }
+    for (int i = 0; i < STRATUM_MAX_PENDING_SUBMITS; i++) {
+        if (pending_submits[i].id == id) {
+            return &pending_submits[i];
+        }
+    }
+    return NULL;
+}
+
 // get accepted share count
 uint32_t StratumClient::get_shares_accepted() {
     return shares_accepted;
@@ -566,6 +935,111 @@ uint32_t StratumClient::get_shares_rejected() {
     return shares_rejected;
 }
 
+// get count of shares rejected as duplicates
+uint32_t StratumClient::get_shares_duplicate() {
+    return shares_duplicate;
+}
+
+// get count of unanswered submits forgotten for a new one
+uint32_t StratumClient::get_submits_evicted() {
+    return submits_evicted;
+}
+
+// get current pool difficulty
+double StratumClient::get_difficulty() {
+    return current_difficulty;
+}
+
+// get total difficulty credited by the pool for accepted shares
+double StratumClient::get_accepted_difficulty() {
+    return accepted_difficulty;
+}
+
+// smoothed time from mining.submit to the pool's answer (milliseconds)
+uint32_t StratumClient::get_submit_latency_ms() {
+    return submit_latency_ms;
+}
+
+// get extranonce1 hex string assigned by the pool
+const char* StratumClient::get_extranonce1() {
+    return extranonce1;
+}
+
+// get number of successful connects, a change means a new connection
+uint32_t StratumClient::get_connection_count() {
+    return connection_count;
+}
+
+// get extranonce2 size the pool expects
+uint8_t StratumClient::get_extranonce2_size() {
+    return extranonce2_len;
+}
+
+// reserve the first extranonce2 byte - lets a proxy hand the other values
+// of that byte to downstream miners without overlapping our own work
+void StratumClient::set_extranonce2_prefix(bool enabled, uint8_t prefix) {
+    extranonce2_prefix_enabled = enabled;
+    extranonce2_prefix = prefix;
+    work_sequence++;
+}
+
+// reserve the last two extranonce2 bytes for a per-device id
+// devices that get the same extranonce1 then build different coinbases, as
+// long as their ids differ
+void StratumClient::set_extranonce2_partition(bool enabled, uint16_t device_id) {
+    extranonce2_partition_enabled = enabled;
+    extranonce2_partition = device_id;
+    work_sequence++;
+}
+
+// check if the device id fits next to the prefix and at least one counter byte
+bool StratumClient::is_extranonce2_partitioned() {
+    int prefix_len = (extranonce2_prefix_enabled && extranonce2_len >= 2) ? 1 : 0;
+    return extranonce2_partition_enabled && extranonce2_len - prefix_len >= 3;
+}
+
+// set relay for downstream pool traffic
+void StratumClient::set_relay(StratumRelay* relay_in) {
+    relay = relay_in;
+}
+
+// record the session into capture, NULL to stop recording
+void StratumClient::set_capture(StratumCapture* capture_in) {
+    capture = capture_in;
+}
+
+// skip the per-line and per-job logs
+void StratumClient::set_quiet(bool enabled) {
+    quiet = enabled;
+}
+
+// replays go through the same parser as live lines, nothing is recorded or sent back
+void StratumClient::replay_line(const char* line) {
+    process_line(line);
+}
+
+// helper: serialize extranonce2 as it goes into the coinbase
+// [prefix byte] counter little-endian, zero padded past 32 bits [device id, 2 bytes]
+void StratumClient::write_extranonce2(uint32_t value, uint8_t* out) {
+    int pos = 0;
+    int end = extranonce2_len;
+    
+    // a 1-byte extranonce2 has no room left for a prefix
+    if (extranonce2_prefix_enabled && extranonce2_len >= 2) {
+        out[pos++] = extranonce2_prefix;
+    }
+    
+    if (is_extranonce2_partitioned()) {
+        end -= 2;
+        out[end] = extranonce2_partition & 0xFF;
+        out[end + 1] = (extranonce2_partition >> 8) & 0xFF;
+    }
+    
+    for (int i = 0; pos < end; i++) {
+        out[pos++] = (i < 4) ? (value >> (8 * i)) & 0xFF : 0;
+    }
+}
+
 // helper: convert hex string to bytes
 void StratumClient::hex_to_bytes(const char* hex, uint8_t* bytes, size_t byte_len) {
     for (size_t i = 0; i < byte_len; i++) {
@@ -0,0 +1,426 @@
+// stratum_proxy.cpp
+// lan stratum proxy - serves downstream miners over our single pool session
+
+#include "mining/stratum_proxy.h"
+
+// constructor - initialize all state
+StratumProxy::StratumProxy(StratumClient* upstream_client) {
+    upstream = upstream_client;
+    server = NULL;
+    running = false;
+
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        clients[i].recv_buffer_pos = 0;
+        clients[i].session = 0;
+        clients[i].subscribed = false;
+        clients[i].authorized = false;
+        clients[i].shares_accepted = 0;
+        clients[i].shares_rejected = 0;
+    }
+    next_session = 1;
+
+    session_extranonce1[0] = '\0';
+    upstream_connection = 0;
+    last_notify[0] = '\0';
+    last_difficulty[0] = '\0';
+
+    memset(pending, 0, sizeof(pending));
+    pending_head = 0;
+
+    shares_relayed = 0;
+    shares_accepted = 0;
+    shares_rejected = 0;
+}
+
+// start listening and hook into the upstream client
+bool StratumProxy::begin(uint16_t port) {
+    if (running) {
+        return true;
+    }
+
+    if (server == NULL) {
+        server = new TcpServer(port);
+    }
+    server->begin(port);
+    server->setNoDelay(true);
+
+    // our own mining keeps extranonce2 prefix 0, slots use 1..n
+    upstream->set_extranonce2_prefix(true, 0);
+    upstream->set_relay(this);
+    running = true;
+
+    Serial.print("[proxy] listening on port ");
+    Serial.println(port);
+    return true;
+}
+
+// stop listening and drop all downstream miners
+void StratumProxy::end() {
+    if (!running) {
+        return;
+    }
+
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        drop_client(i);
+    }
+
+    server->end();
+    upstream->set_relay(NULL);
+    upstream->set_extranonce2_prefix(false, 0);
+    running = false;
+
+    Serial.println("[proxy] stopped");
+}
+
+// check if proxy is serving
+bool StratumProxy::is_running() {
+    return running;
+}
+
+// accept new miners and handle their requests
+void StratumProxy::process() {
+    if (!running) {
+        return;
+    }
+
+    check_upstream_session();
+    accept_clients();
+
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        if (clients[i].session == 0) {
+            continue;
+        }
+
+        if (!clients[i].tcp.connected()) {
+            Serial.print("[proxy] miner ");
+            Serial.print(i + 1);
+            Serial.println(" disconnected");
+            drop_client(i);
+            continue;
+        }
+
+        read_client(i);
+    }
+
+    // submits relayed this tick share one upstream segment
+    upstream->flush();
+}
+
+// take pending connections into free slots
+void StratumProxy::accept_clients() {
+    while (server->hasClient()) {
+        TcpClient incoming = server->available();
+
+        int slot = -1;
+        for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+            if (clients[i].session == 0) {
+                slot = i;
+                break;
+            }
+        }
+
+        if (slot < 0) {
+            Serial.println("[proxy] no free slot, refusing miner");
+            incoming.stop();
+            continue;
+        }
+
+        proxy_client_t* client = &clients[slot];
+        client->tcp = incoming;
+        client->tcp.setNoDelay(true);
+        client->recv_buffer_pos = 0;
+        client->session = next_session++;
+        client->subscribed = false;
+        client->authorized = false;
+        client->shares_accepted = 0;
+        client->shares_rejected = 0;
+
+        Serial.print("[proxy] miner connected in slot ");
+        Serial.println(slot + 1);
+    }
+}
+
+// downstream extranonce1 embeds the pool's, a new pool session invalidates it
+void StratumProxy::check_upstream_session() {
+    // a resumed session keeps extranonce1 but answers nothing sent on the
+    // old connection, relayed submits still waiting are lost
+    if (upstream->get_connection_count() != upstream_connection) {
+        upstream_connection = upstream->get_connection_count();
+        memset(pending, 0, sizeof(pending));
+    }
+
+    const char* extranonce1 = upstream->get_extranonce1();
+
+    if (strcmp(extranonce1, session_extranonce1) == 0) {
+        return;
+    }
+
+    if (session_extranonce1[0] != '\0') {
+        Serial.println("[proxy] pool session changed, reconnecting miners");
+        for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+            if (clients[i].subscribed) {
+                drop_client(i);
+            }
+        }
+    }
+
+    strncpy(session_extranonce1, extranonce1, sizeof(session_extranonce1) - 1);
+    session_extranonce1[sizeof(session_extranonce1) - 1] = '\0';
+    last_notify[0] = '\0';
+    memset(pending, 0, sizeof(pending));
+}
+
+// read newline-delimited requests from one miner
+void StratumProxy::read_client(uint8_t slot) {
+    proxy_client_t* client = &clients[slot];
+
+    while (client->tcp.available()) {
+        char c = client->tcp.read();
+
+        if (c == '\n') {
+            client->recv_buffer[client->recv_buffer_pos] = '\0';
+
+            if (client->recv_buffer_pos > 0) {
+                process_line(slot, client->recv_buffer);
+            }
+
+            // the request may have dropped the client
+            if (client->session == 0) {
+                return;
+            }
+            client->recv_buffer_pos = 0;
+        } else if (client->recv_buffer_pos < STRATUM_PROXY_RECV_BUFFER_SIZE - 1) {
+            client->recv_buffer[client->recv_buffer_pos++] = c;
+        }
+    }
+}
+
+// handle one request from a miner
+void StratumProxy::process_line(uint8_t slot, const char* line) {
+    StaticJsonDocument<512> doc;
+    DeserializationError error = deserializeJson(doc, line);
+
+    if (error) {
+        Serial.print("[proxy] bad request from miner ");
+        Serial.println(slot + 1);
+        return;
+    }
+
+    const char* method = doc["method"] | "";
+    uint32_t id = doc["id"] | 0;
+
+    if (strcmp(method, "mining.subscribe") == 0) {
+        handle_subscribe(slot, id);
+    } else if (strcmp(method, "mining.authorize") == 0) {
+        // the pool only knows our worker, every downstream share is credited to it
+        clients[slot].authorized = true;
+        send_result(slot, id, true, NULL);
+
+        // start the miner on the current difficulty and job right away
+        if (last_difficulty[0] != '\0') {
+            send_line(slot, last_difficulty);
+        }
+        if (last_notify[0] != '\0') {
+            send_line(slot, last_notify);
+        }
+    } else if (strcmp(method, "mining.submit") == 0) {
+        handle_submit(slot, id, doc["params"].as<JsonArray>());
+    } else if (strcmp(method, "mining.extranonce.subscribe") == 0) {
+        // extranonce is fixed per pool session, changes drop the miner instead
+        send_result(slot, id, false, NULL);
+    } else {
+        send_result(slot, id, false, "[20,\"Unsupported method\",null]");
+    }
+}
+
+// hand the miner its extranonce slice
+void StratumProxy::handle_subscribe(uint8_t slot, uint32_t id) {
+    uint8_t extranonce2_size = upstream->get_extranonce2_size();
+
+    if (session_extranonce1[0] == '\0' || extranonce2_size < 2) {
+        // not subscribed upstream yet, or no room to split extranonce2
+        send_result(slot, id, false, "[20,\"Upstream not ready\",null]");
+        return;
+    }
+
+    // extranonce1 = pool extranonce1 + slot byte, slot byte 0 is ours
+    char response[256];
+    snprintf(response, sizeof(response),
+             "{\"id\":%u,\"result\":[[[\"mining.set_difficulty\",\"%u\"],[\"mining.notify\",\"%u\"]],"
+             "\"%s%02x\",%u],\"error\":null}",
+             (unsigned)id, (unsigned)clients[slot].session, (unsigned)clients[slot].session,
+             session_extranonce1, (unsigned)(slot + 1), (unsigned)(extranonce2_size - 1));
+
+    clients[slot].subscribed = true;
+    send_line(slot, response);
+}
+
+// forward a share upstream with the slot byte put back in front of extranonce2
+void StratumProxy::handle_submit(uint8_t slot, uint32_t id, JsonArray params) {
+    proxy_client_t* client = &clients[slot];
+
+    if (!client->subscribed || !client->authorized || params.size() < 5) {
+        send_result(slot, id, false, "[24,\"Unauthorized worker\",null]");
+        return;
+    }
+
+    const char* job_id = params[1] | "";
+    const char* extranonce2 = params[2] | "";
+    const char* ntime = params[3] | "";
+    const char* nonce = params[4] | "";
+
+    // the miner must fill exactly its part of extranonce2
+    uint8_t extranonce2_size = upstream->get_extranonce2_size();
+    if (strlen(extranonce2) != (size_t)(extranonce2_size - 1) * 2) {
+        send_result(slot, id, false, "[20,\"Invalid extranonce2 size\",null]");
+        return;
+    }
+
+    // the upstream client refuses pools with more than STRATUM_MAX_EXTRANONCE2_SIZE
+    char full_extranonce2[STRATUM_MAX_EXTRANONCE2_SIZE * 2 + 1];
+    snprintf(full_extranonce2, sizeof(full_extranonce2), "%02x%s", (unsigned)(slot + 1), extranonce2);
+
+    uint32_t upstream_id = 0;
+    if (upstream->is_connected()) {
+        upstream_id = upstream->submit_relayed(job_id, full_extranonce2, ntime, nonce);
+    }
+
+    if (upstream_id == 0) {
+        send_result(slot, id, false, "[20,\"Pool not connected\",null]");
+        return;
+    }
+
+    // oldest pending entry is overwritten if the pool is that far behind
+    proxy_submit_t* entry = &pending[pending_head];
+    pending_head = (pending_head + 1) % STRATUM_PROXY_MAX_PENDING;
+    entry->upstream_id = upstream_id;
+    entry->downstream_id = id;
+    entry->slot = slot;
+    entry->session = client->session;
+
+    shares_relayed++;
+}
+
+// answer a miner's request with a boolean result
+void StratumProxy::send_result(uint8_t slot, uint32_t id, bool result, const char* error) {
+    char response[128];
+    snprintf(response, sizeof(response), "{\"id\":%u,\"result\":%s,\"error\":%s}",
+             (unsigned)id, result ? "true" : "false", error ? error : "null");
+    send_line(slot, response);
+}
+
+// write one message to a miner in a single segment
+void StratumProxy::send_line(uint8_t slot, const char* line) {
+    proxy_client_t* client = &clients[slot];
+
+    if (client->session == 0 || !client->tcp.connected()) {
+        return;
+    }
+
+    size_t len = strlen(line);
+    char buffer[STRATUM_PROXY_NOTIFY_SIZE + 1];
+    if (len >= sizeof(buffer)) {
+        return;
+    }
+    memcpy(buffer, line, len);
+    buffer[len] = '\n';
+
+    client->tcp.write((const uint8_t*)buffer, len + 1);
+}
+
+// close a miner's connection and free its slot
+void StratumProxy::drop_client(uint8_t slot) {
+    proxy_client_t* client = &clients[slot];
+
+    if (client->session != 0) {
+        client->tcp.stop();
+    }
+    client->session = 0;
+    client->subscribed = false;
+    client->authorized = false;
+    client->recv_buffer_pos = 0;
+}
+
+// new job from the pool - fan out to every authorized miner
+void StratumProxy::relay_notify(const char* line) {
+    strncpy(last_notify, line, sizeof(last_notify) - 1);
+    last_notify[sizeof(last_notify) - 1] = '\0';
+
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        if (clients[i].authorized) {
+            send_line(i, line);
+        }
+    }
+}
+
+// difficulty change from the pool - same target for every miner
+void StratumProxy::relay_set_difficulty(const char* line) {
+    strncpy(last_difficulty, line, sizeof(last_difficulty) - 1);
+    last_difficulty[sizeof(last_difficulty) - 1] = '\0';
+
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        if (clients[i].authorized) {
+            send_line(i, line);
+        }
+    }
+}
+
+// pool answered a submit - pass it on if it was one of ours
+bool StratumProxy::relay_submit_response(uint32_t id, bool accepted) {
+    for (int i = 0; i < STRATUM_PROXY_MAX_PENDING; i++) {
+        proxy_submit_t* entry = &pending[i];
+
+        if (entry->upstream_id != id || id == 0) {
+            continue;
+        }
+
+        proxy_client_t* client = &clients[entry->slot];
+        if (accepted) {
+            shares_accepted++;
+        } else {
+            shares_rejected++;
+        }
+
+        // the miner may have reconnected into the slot since
+        if (client->session == entry->session) {
+            if (accepted) {
+                client->shares_accepted++;
+            } else {
+                client->shares_rejected++;
+            }
+            send_result(entry->slot, entry->downstream_id, accepted,
+                        accepted ? NULL : "[23,\"Rejected by pool\",null]");
+        }
+
+        entry->upstream_id = 0;
+        return true;
+    }
+
+    return false;
+}
+
+// get number of connected miners
+uint8_t StratumProxy::get_client_count() {
+    uint8_t count = 0;
+    for (int i = 0; i < STRATUM_PROXY_MAX_CLIENTS; i++) {
+        if (clients[i].session != 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// get shares forwarded upstream
+uint32_t StratumProxy::get_shares_relayed() {
+    return shares_relayed;
+}
+
+// get relayed shares the pool accepted
+uint32_t StratumProxy::get_shares_accepted() {
+    return shares_accepted;
+}
+
+// get relayed shares the pool rejected
+uint32_t StratumProxy::get_shares_rejected() {
+    return shares_rejected;
+}
@@ -0,0 +1,641 @@
+// sv2_client.cpp
+// stratum v2 mining protocol client (standard channel, header-only work)
+
+#include "mining/sv2_client.h"
+#include "mining/sha256_miner.h"
+#include "mining/dns_cache.h"
+
+// how long connect() waits for each handshake step (milliseconds)
+#define SV2_HANDSHAKE_TIMEOUT 5000
+
+// nominal hashrate announced when opening the channel (h/s)
+#define SV2_NOMINAL_HASHRATE 300000.0f
+
+// constructor - initialize all state
+Sv2Client::Sv2Client() {
+    host[0] = '\0';
+    port = 0;
+    user_identity[0] = '\0';
+    connection_count = 0;
+    session_id[0] = '\0';
+
+    frame_length = 0;
+    frame_pos = 0;
+    frame_oversized = false;
+
+    setup_done = false;
+    channel_open = false;
+    channel_id = 0;
+    request_id = 0;
+    memset(target, 0xFF, 32);
+
+    memset(jobs, 0, sizeof(jobs));
+    active_job = -1;
+    prev_hash_valid = false;
+    memset(prev_hash, 0, 32);
+    nbits = 0;
+    ntime = 0;
+    memset(network_target, 0, 32);
+    job_id_str[0] = '\0';
+    work_sequence = 0;
+
+    sequence_number = 0;
+    memset(pending_submits, 0, sizeof(pending_submits));
+    shares_accepted = 0;
+    shares_rejected = 0;
+    submits_evicted = 0;
+    accepted_difficulty = 0.0;
+}
+
+// set user identity, pools read it like a stratum v1 worker name
+void Sv2Client::set_user_identity(const char* wallet_address, const char* worker_name) {
+    if (worker_name && strlen(worker_name) > 0) {
+        snprintf(user_identity, sizeof(user_identity), "%s.%s", wallet_address, worker_name);
+    } else {
+        strncpy(user_identity, wallet_address, sizeof(user_identity) - 1);
+        user_identity[sizeof(user_identity) - 1] = '\0';
+    }
+}
+
+// connect, set up the connection and open a standard channel
+bool Sv2Client::connect(const char* host_in, uint16_t port_in) {
+    Serial.print("[sv2] connecting to ");
+    Serial.print(host_in);
+    Serial.print(":");
+    Serial.println(port_in);
+
+    strncpy(host, host_in, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    port = port_in;
+
+    if (!dns_cache.connect(tcp_client, host, port)) {
+        Serial.println("[sv2] connection failed");
+        return false;
+    }
+    tcp_client.setNoDelay(true);
+
+    // reset state for new connection
+    connection_count++;
+    snprintf(session_id, sizeof(session_id), "%lu", (unsigned long)connection_count);
+    frame_pos = 0;
+    frame_oversized = false;
+    setup_done = false;
+    channel_open = false;
+    memset(jobs, 0, sizeof(jobs));
+    active_job = -1;
+    prev_hash_valid = false;
+    memset(pending_submits, 0, sizeof(pending_submits));
+
+    // SetupConnection
+    if (!send_setup_connection()) {
+        disconnect();
+        return false;
+    }
+
+    unsigned long start = millis();
+    while (!setup_done && tcp_client.connected() && millis() - start < SV2_HANDSHAKE_TIMEOUT) {
+        process();
+        delay(10);
+    }
+    if (!setup_done) {
+        Serial.println("[sv2] setup connection failed");
+        disconnect();
+        return false;
+    }
+
+    // OpenStandardMiningChannel
+    if (!send_open_channel()) {
+        disconnect();
+        return false;
+    }
+
+    start = millis();
+    while (!channel_open && tcp_client.connected() && millis() - start < SV2_HANDSHAKE_TIMEOUT) {
+        process();
+        delay(10);
+    }
+    if (!channel_open) {
+        Serial.println("[sv2] open channel failed");
+        disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+// disconnect from pool
+void Sv2Client::disconnect() {
+    if (tcp_client.connected()) {
+        tcp_client.stop();
+        Serial.println("[sv2] disconnected");
+    }
+    channel_open = false;
+    active_job = -1;
+}
+
+// check if connected to pool
+bool Sv2Client::is_connected() {
+    return tcp_client.connected();
+}
+
+// check if the mining channel is open
+bool Sv2Client::is_channel_open() {
+    return channel_open;
+}
+
+// read available bytes and dispatch every complete frame
+void Sv2Client::process() {
+    if (!tcp_client.connected()) {
+        return;
+    }
+
+    while (tcp_client.available()) {
+        uint8_t c = tcp_client.read();
+
+        if (frame_pos < SV2_FRAME_HEADER_SIZE) {
+            frame_header[frame_pos++] = c;
+
+            if (frame_pos == SV2_FRAME_HEADER_SIZE) {
+                frame_length = frame_header[3] | (frame_header[4] << 8) | ((uint32_t)frame_header[5] << 16);
+                frame_oversized = frame_length > SV2_MAX_PAYLOAD;
+            }
+        } else {
+            // payloads we cannot hold are consumed and dropped
+            if (!frame_oversized) {
+                frame_payload[frame_pos - SV2_FRAME_HEADER_SIZE] = c;
+            }
+            frame_pos++;
+        }
+
+        // header complete and payload complete (possibly empty)
+        if (frame_pos >= SV2_FRAME_HEADER_SIZE && frame_pos - SV2_FRAME_HEADER_SIZE == frame_length) {
+            uint16_t extension_type = get_u16(frame_header) & ~SV2_CHANNEL_MSG_BIT;
+
+            if (frame_oversized) {
+                Serial.println("[sv2] oversized frame dropped");
+            } else if (extension_type == 0) {
+                handle_frame(frame_header[2], frame_payload, frame_length);
+            }
+
+            frame_pos = 0;
+        }
+    }
+}
+
+// write header and payload as one segment
+bool Sv2Client::send_frame(uint16_t extension_type, uint8_t msg_type, const uint8_t* payload, uint32_t len) {
+    if (!tcp_client.connected() || len > SV2_MAX_PAYLOAD) {
+        return false;
+    }
+
+    uint8_t frame[SV2_FRAME_HEADER_SIZE + SV2_MAX_PAYLOAD];
+    put_u16(frame, extension_type);
+    frame[2] = msg_type;
+    frame[3] = len & 0xFF;
+    frame[4] = (len >> 8) & 0xFF;
+    frame[5] = (len >> 16) & 0xFF;
+    memcpy(frame + SV2_FRAME_HEADER_SIZE, payload, len);
+
+    return tcp_client.write(frame, SV2_FRAME_HEADER_SIZE + len) == SV2_FRAME_HEADER_SIZE + len;
+}
+
+// dispatch a mining protocol message
+void Sv2Client::handle_frame(uint8_t msg_type, const uint8_t* payload, uint32_t len) {
+    switch (msg_type) {
+        case SV2_MSG_SETUP_CONNECTION_SUCCESS:
+            handle_setup_success(payload, len);
+            break;
+        case SV2_MSG_SETUP_CONNECTION_ERROR:
+        case SV2_MSG_OPEN_CHANNEL_ERROR:
+            Serial.print("[sv2] error from pool, message 0x");
+            Serial.println(msg_type, HEX);
+            break;
+        case SV2_MSG_OPEN_STANDARD_CHANNEL_SUCCESS:
+            handle_open_channel_success(payload, len);
+            break;
+        case SV2_MSG_NEW_MINING_JOB:
+            handle_new_mining_job(payload, len);
+            break;
+        case SV2_MSG_SET_NEW_PREV_HASH:
+            handle_set_new_prev_hash(payload, len);
+            break;
+        case SV2_MSG_SET_TARGET:
+            handle_set_target(payload, len);
+            break;
+        case SV2_MSG_SUBMIT_SHARES_SUCCESS:
+            handle_submit_success(payload, len);
+            break;
+        case SV2_MSG_SUBMIT_SHARES_ERROR:
+            handle_submit_error(payload, len);
+            break;
+        default:
+            // extended channels, group channels, reconnect - not used by this client
+            break;
+    }
+}
+
+// SetupConnection - mining protocol, standard jobs only
+bool Sv2Client::send_setup_connection() {
+    uint8_t payload[SV2_MAX_PAYLOAD];
+    size_t pos = 0;
+
+    payload[pos++] = SV2_PROTOCOL_MINING;
+    put_u16(payload + pos, SV2_PROTOCOL_VERSION);   // min_version
+    pos += 2;
+    put_u16(payload + pos, SV2_PROTOCOL_VERSION);   // max_version
+    pos += 2;
+    put_u32(payload + pos, SV2_SETUP_REQUIRES_STANDARD_JOBS);
+    pos += 4;
+    pos += put_str0_255(payload + pos, host);       // endpoint_host
+    put_u16(payload + pos, port);                   // endpoint_port
+    pos += 2;
+    pos += put_str0_255(payload + pos, "esp32btcminer");   // vendor
+    pos += put_str0_255(payload + pos, "esp32-s3");        // hardware_version
+    pos += put_str0_255(payload + pos, "");                // firmware
+    pos += put_str0_255(payload + pos, "");                // device_id
+
+    return send_frame(0, SV2_MSG_SETUP_CONNECTION, payload, pos);
+}
+
+// OpenStandardMiningChannel - one header-only channel for this device
+bool Sv2Client::send_open_channel() {
+    uint8_t payload[SV2_MAX_PAYLOAD];
+    size_t pos = 0;
+
+    request_id++;
+    put_u32(payload + pos, request_id);
+    pos += 4;
+    pos += put_str0_255(payload + pos, user_identity);
+
+    // nominal_hash_rate f32, little-endian like every other field
+    float hashrate = SV2_NOMINAL_HASHRATE;
+    uint32_t hashrate_bits;
+    memcpy(&hashrate_bits, &hashrate, 4);
+    put_u32(payload + pos, hashrate_bits);
+    pos += 4;
+
+    // max_target - accept whatever the pool picks
+    memset(payload + pos, 0xFF, 32);
+    pos += 32;
+
+    return send_frame(0, SV2_MSG_OPEN_STANDARD_CHANNEL, payload, pos);
+}
+
+// SetupConnection.Success: used_version u16 | flags u32
+void Sv2Client::handle_setup_success(const uint8_t* p, uint32_t len) {
+    if (len < 6) {
+        return;
+    }
+    setup_done = true;
+
+    Serial.print("[sv2] connection set up, version ");
+    Serial.println(get_u16(p));
+}
+
+// OpenStandardMiningChannel.Success:
+// request_id u32 | channel_id u32 | target u256 | extranonce_prefix b0_32 | group_channel_id u32
+void Sv2Client::handle_open_channel_success(const uint8_t* p, uint32_t len) {
+    if (len < 40 || get_u32(p) != request_id) {
+        return;
+    }
+
+    channel_id = get_u32(p + 4);
+    memcpy(target, p + 8, 32);
+    channel_open = true;
+    work_sequence++;
+
+    Serial.print("[sv2] channel ");
+    Serial.print(channel_id);
+    Serial.print(" open, difficulty ");
+    Serial.println(get_difficulty(), 4);
+}
+
+// NewMiningJob:
+// channel_id u32 | job_id u32 | min_ntime option[u32] | version u32 | merkle_root u256
+void Sv2Client::handle_new_mining_job(const uint8_t* p, uint32_t len) {
+    if (len < 9 || get_u32(p) != channel_id) {
+        return;
+    }
+
+    uint32_t job_id = get_u32(p + 4);
+    bool has_min_ntime = p[8] != 0;
+    size_t pos = 9;
+    if (len < pos + (has_min_ntime ? 4 : 0) + 36) {
+        return;
+    }
+
+    // slot picked by job id, pools number jobs sequentially so recent ones never collide
+    int8_t index = job_id % SV2_MAX_JOBS;
+    sv2_job_t* job = &jobs[index];
+    job->job_id = job_id;
+    job->future = !has_min_ntime;
+    job->min_ntime = 0;
+    if (has_min_ntime) {
+        job->min_ntime = get_u32(p + pos);
+        pos += 4;
+    }
+    job->version = get_u32(p + pos);
+    pos += 4;
+    memcpy(job->merkle_root, p + pos, 32);
+    job->valid = true;
+
+    // non-future jobs apply to the current prev hash right away
+    if (!job->future && prev_hash_valid) {
+        if (ntime < job->min_ntime) {
+            ntime = job->min_ntime;
+        }
+        activate_job(index);
+    }
+}
+
+// SetNewPrevHash: channel_id u32 | job_id u32 | prev_hash u256 | min_ntime u32 | nbits u32
+void Sv2Client::handle_set_new_prev_hash(const uint8_t* p, uint32_t len) {
+    if (len < 48 || get_u32(p) != channel_id) {
+        return;
+    }
+
+    uint32_t job_id = get_u32(p + 4);
+    memcpy(prev_hash, p + 8, 32);
+    ntime = get_u32(p + 40);
+    nbits = get_u32(p + 44);
+    nbits_to_target(nbits, network_target);
+    prev_hash_valid = true;
+
+    // every job except the future job named here built on the old tip
+    int8_t index = -1;
+    for (int8_t i = 0; i < SV2_MAX_JOBS; i++) {
+        if (jobs[i].valid && jobs[i].future && jobs[i].job_id == job_id) {
+            index = i;
+        } else {
+            jobs[i].valid = false;
+        }
+    }
+
+    if (index < 0) {
+        Serial.println("[sv2] new prev hash for unknown job");
+        active_job = -1;
+        return;
+    }
+
+    jobs[index].future = false;
+    activate_job(index);
+}
+
+// SetTarget: channel_id u32 | maximum_target u256
+void Sv2Client::handle_set_target(const uint8_t* p, uint32_t len) {
+    if (len < 36 || get_u32(p) != channel_id) {
+        return;
+    }
+
+    memcpy(target, p + 4, 32);
+    work_sequence++;
+
+    Serial.print("[sv2] difficulty set to: ");
+    Serial.println(get_difficulty(), 8);
+}
+
+// SubmitShares.Success:
+// channel_id u32 | last_sequence_number u32 | new_submits_accepted_count u32 | new_shares_sum u64
+// acknowledges every pending submit up to last_sequence_number at once
+void Sv2Client::handle_submit_success(const uint8_t* p, uint32_t len) {
+    if (len < 20 || get_u32(p) != channel_id) {
+        return;
+    }
+
+    uint32_t last_sequence = get_u32(p + 4);
+    uint32_t accepted_count = get_u32(p + 8);
+
+    for (int i = 0; i < SV2_MAX_PENDING_SUBMITS; i++) {
+        sv2_pending_submit_t* slot = &pending_submits[i];
+        if (slot->sequence != 0 && (int32_t)(last_sequence - slot->sequence) >= 0) {
+            accepted_difficulty += slot->difficulty;
+            slot->sequence = 0;
+        }
+    }
+
+    shares_accepted += accepted_count;
+    Serial.print("[sv2] shares accepted: ");
+    Serial.println(accepted_count);
+}
+
+// SubmitShares.Error: channel_id u32 | sequence_number u32 | error_code str0_255
+void Sv2Client::handle_submit_error(const uint8_t* p, uint32_t len) {
+    if (len < 9 || get_u32(p) != channel_id) {
+        return;
+    }
+
+    uint32_t sequence = get_u32(p + 4);
+    sv2_pending_submit_t* slot = &pending_submits[sequence % SV2_MAX_PENDING_SUBMITS];
+    if (slot->sequence == sequence) {
+        slot->sequence = 0;
+    }
+
+    shares_rejected++;
+
+    // error code is a short string, print it for diagnostics
+    uint8_t code_len = p[8];
+    char code[64];
+    if (code_len > sizeof(code) - 1) {
+        code_len = sizeof(code) - 1;
+    }
+    if (9u + code_len > len) {
+        code_len = len - 9;
+    }
+    memcpy(code, p + 9, code_len);
+    code[code_len] = '\0';
+
+    Serial.print("[sv2] share rejected: ");
+    Serial.println(code);
+}
+
+// make a job the one build_block_header() uses
+void Sv2Client::activate_job(int8_t index) {
+    active_job = index;
+    snprintf(job_id_str, sizeof(job_id_str), "%x", (unsigned)jobs[index].job_id);
+    work_sequence++;
+
+    Serial.print("[sv2] new job: ");
+    Serial.println(job_id_str);
+}
+
+// build 80-byte block header from the active job - every field comes from the pool
+void Sv2Client::build_block_header(uint8_t* header_out) {
+    if (!has_work()) {
+        memset(header_out, 0, 80);
+        return;
+    }
+
+    const sv2_job_t* job = &jobs[active_job];
+    put_u32(header_out, job->version);
+    memcpy(header_out + 4, prev_hash, 32);
+    memcpy(header_out + 36, job->merkle_root, 32);
+    put_u32(header_out + 68, ntime);
+    put_u32(header_out + 72, nbits);
+    put_u32(header_out + 76, 0);
+}
+
+// SubmitSharesStandard:
+// channel_id u32 | sequence_number u32 | job_id u32 | nonce u32 | ntime u32 | version u32
+bool Sv2Client::submit_share(const char* job_id, uint32_t extranonce2, uint32_t share_ntime, uint32_t nonce) {
+    uint32_t id = strtoul(job_id, NULL, 16);
+
+    // version must be the one the header was built with
+    const sv2_job_t* job = NULL;
+    for (int i = 0; i < SV2_MAX_JOBS; i++) {
+        if (jobs[i].valid && jobs[i].job_id == id) {
+            job = &jobs[i];
+            break;
+        }
+    }
+    if (job == NULL) {
+        Serial.println("[sv2] share for stale job, not submitted");
+        return false;
+    }
+
+    sequence_number++;
+    if (sequence_number == 0) {
+        sequence_number = 1;
+    }
+
+    uint8_t payload[24];
+    put_u32(payload, channel_id);
+    put_u32(payload + 4, sequence_number);
+    put_u32(payload + 8, id);
+    put_u32(payload + 12, nonce);
+    put_u32(payload + 16, share_ntime);
+    put_u32(payload + 20, job->version);
+
+    Serial.print("[sv2] submitting share - nonce: ");
+    Serial.println(nonce, HEX);
+
+    if (!send_frame(SV2_CHANNEL_MSG_BIT, SV2_MSG_SUBMIT_SHARES_STANDARD, payload, sizeof(payload))) {
+        return false;
+    }
+
+    // remember what this share is worth until it is acknowledged
+    // only once it is sent, a failed submit must not look pending
+    // sequence numbers are consecutive, a busy slot is a submit the pool
+    // left unanswered for SV2_MAX_PENDING_SUBMITS newer ones - forgotten and counted
+    sv2_pending_submit_t* slot = &pending_submits[sequence_number % SV2_MAX_PENDING_SUBMITS];
+    if (slot->sequence != 0) {
+        submits_evicted++;
+    }
+    slot->sequence = sequence_number;
+    slot->difficulty = get_difficulty();
+
+    return true;
+}
+
+// check if we have a job on a known prev hash
+bool Sv2Client::has_work() {
+    return channel_open && prev_hash_valid && active_job >= 0 && jobs[active_job].valid;
+}
+
+// get work sequence - changes whenever a new header or target must be built
+uint32_t Sv2Client::get_work_sequence() {
+    return work_sequence;
+}
+
+// get channel target
+void Sv2Client::get_target(uint8_t* target_out) {
+    memcpy(target_out, target, 32);
+}
+
+// get 32-byte block target of current prev hash
+void Sv2Client::get_network_target(uint8_t* target_out) {
+    memcpy(target_out, network_target, 32);
+}
+
+// get active job id (hex) for share submission
+const char* Sv2Client::get_current_job_id() {
+    return job_id_str;
+}
+
+// get ntime used for the header
+uint32_t Sv2Client::get_current_ntime() {
+    return ntime;
+}
+
+// standard channels have no extranonce, the pool did the coinbase
+uint32_t Sv2Client::get_current_extranonce2() {
+    return 0;
+}
+
+// get network difficulty bits
+uint32_t Sv2Client::get_current_nbits() {
+    return nbits;
+}
+
+// session id - job ids belong to the channel of one connection
+const char* Sv2Client::get_session_id() {
+    return session_id;
+}
+
+// get sequence number of last submit
+uint32_t Sv2Client::get_last_submit_id() {
+    return sequence_number;
+}
+
+// check if a submit still waits for acknowledgement
+bool Sv2Client::is_submit_pending(uint32_t id) {
+    return id != 0 && pending_submits[id % SV2_MAX_PENDING_SUBMITS].sequence == id;
+}
+
+// get accepted share count
+uint32_t Sv2Client::get_shares_accepted() {
+    return shares_accepted;
+}
+
+// get rejected share count
+uint32_t Sv2Client::get_shares_rejected() {
+    return shares_rejected;
+}
+
+// get count of unanswered submits overwritten by newer ones
+uint32_t Sv2Client::get_submits_evicted() {
+    return submits_evicted;
+}
+
+// get channel difficulty (diff1 target / channel target)
+double Sv2Client::get_difficulty() {
+    return hash_to_difficulty(target);
+}
+
+// get total difficulty over acknowledged shares
+double Sv2Client::get_accepted_difficulty() {
+    return accepted_difficulty;
+}
+
+// helper: write u16 little-endian
+void Sv2Client::put_u16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+// helper: write u32 little-endian
+void Sv2Client::put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+// helper: read u16 little-endian
+uint16_t Sv2Client::get_u16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+// helper: read u32 little-endian
+uint32_t Sv2Client::get_u32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// helper: write str0_255 (length byte + bytes), returns bytes written
+size_t Sv2Client::put_str0_255(uint8_t* out, const char* str) {
+    size_t len = strlen(str);
+    if (len > 255) {
+        len = 255;
+    }
+    out[0] = len;
+    memcpy(out + 1, str, len);
+    return len + 1;
+}
@@ -0,0 +1,180 @@
+// task_monitor.cpp
+// per-task cpu share, stack headroom and heap watermarks
+
+#include "mining/task_monitor.h"
+#include "mining/log_ring.h"
+
+// snapshot buffer, too big for the loop task's stack
+static platform_task_info_t current[PLATFORM_MAX_TASKS];
+
+// constructor - nothing sampled yet
+TaskMonitor::TaskMonitor() {
+    previous_count = 0;
+    previous_elapsed = 0;
+    previous_ms = 0;
+    have_previous = false;
+    warned_count = 0;
+    heap_warned = false;
+}
+
+void TaskMonitor::process() {
+    if (have_previous && millis() - previous_ms < TASK_MONITOR_INTERVAL_MS) {
+        return;
+    }
+    sample();
+}
+
+// tasks are matched by id, a task created since the last sample has no share yet
+const platform_task_info_t* TaskMonitor::find_previous(uint32_t id) {
+    for (uint8_t i = 0; i < previous_count; i++) {
+        if (previous[i].id == id) {
+            return &previous[i];
+        }
+    }
+    return NULL;
+}
+
+void TaskMonitor::warn_stack(const platform_task_info_t* task) {
+    for (uint8_t i = 0; i < warned_count; i++) {
+        if (warned_ids[i] == task->id) {
+            return;
+        }
+    }
+    if (warned_count < PLATFORM_MAX_TASKS) {
+        warned_ids[warned_count++] = task->id;
+    }
+    LOG_WARN("[tasks] %s stack nearly full, %u bytes never used", task->name, task->stack_free);
+}
+
+void TaskMonitor::sample() {
+    static system_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+
+    uint32_t elapsed = 0;
+    uint8_t count = platform_task_snapshot(current, PLATFORM_MAX_TASKS, &elapsed);
+    unsigned long now = millis();
+
+    uint32_t window = elapsed - previous_elapsed;
+    stats.window_ms = have_previous ? now - previous_ms : 0;
+    stats.cpu_valid = have_previous && elapsed != 0 && window != 0;
+    stats.cores = platform_core_count() < TASK_MONITOR_MAX_CORES ? platform_core_count() : TASK_MONITOR_MAX_CORES;
+    stats.task_count = count;
+    stats.min_stack_task = -1;
+
+    // idle task share per core, -1 = no idle task seen on that core
+    float idle[TASK_MONITOR_MAX_CORES];
+    for (int core = 0; core < TASK_MONITOR_MAX_CORES; core++) {
+        idle[core] = -1.0f;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const platform_task_info_t* task = &current[i];
+        task_stats_t* out = &stats.tasks[i];
+
+        memcpy(out->name, task->name, sizeof(out->name));
+        out->stack_free = task->stack_free;
+        out->core = task->core;
+        out->priority = task->priority;
+        out->cpu_percent = -1.0f;
+
+        const platform_task_info_t* before = find_previous(task->id);
+        if (stats.cpu_valid && before != NULL) {
+            out->cpu_percent = (uint32_t)(task->runtime - before->runtime) * 100.0f / window;
+
+            if (task->core >= 0 && task->core < TASK_MONITOR_MAX_CORES) {
+                if (strncmp(task->name, "IDLE", 4) == 0) {
+                    idle[task->core] = out->cpu_percent;
+                } else {
+                    stats.core_load[task->core] += out->cpu_percent;
+                }
+            }
+        }
+
+        if (task->stack_free > 0) {
+            if (stats.min_stack_task < 0 || task->stack_free < stats.tasks[stats.min_stack_task].stack_free) {
+                stats.min_stack_task = i;
+            }
+            if (task->stack_free < TASK_MONITOR_STACK_WARN) {
+                warn_stack(task);
+            }
+        }
+    }
+
+    // unpinned tasks run on either core, the idle task knows how busy a core really was
+    for (int core = 0; core < stats.cores; core++) {
+        if (idle[core] >= 0.0f) {
+            stats.core_load[core] = 100.0f - idle[core];
+        }
+        if (stats.core_load[core] < 0.0f) {
+            stats.core_load[core] = 0.0f;
+        }
+    }
+
+    platform_heap_snapshot(&stats.heap);
+    if (!heap_warned && stats.heap.internal_free > 0 && stats.heap.internal_min_free < TASK_MONITOR_HEAP_WARN) {
+        heap_warned = true;
+        LOG_WARN("[tasks] internal heap got down to %u bytes free", stats.heap.internal_min_free);
+    }
+
+    published.write(stats);
+
+    memcpy(previous, current, count * sizeof(platform_task_info_t));
+    previous_count = count;
+    previous_elapsed = elapsed;
+    previous_ms = now;
+    have_previous = true;
+
+    if (log_enabled(log_level_t::DEBUG)) {
+        log_stats(stats);
+    }
+}
+
+system_stats_t TaskMonitor::get_stats() {
+    return published.read();
+}
+
+void TaskMonitor::log_stats(const system_stats_t& stats) {
+    if (stats.window_ms == 0) {
+        return;
+    }
+    LOG_DEBUG("[tasks] last %u ms, %u tasks", stats.window_ms, stats.task_count);
+    for (uint8_t i = 0; i < stats.task_count; i++) {
+        const task_stats_t* task = &stats.tasks[i];
+        if (stats.cpu_valid && task->cpu_percent < 0.05f && task->stack_free == 0) {
+            continue;   // linux threads with nothing to show
+        }
+        char core[4];
+        char stack[12];
+        char cpu[12];
+        if (task->core < 0) {
+            strcpy(core, "-");
+        } else {
+            snprintf(core, sizeof(core), "%d", task->core);
+        }
+        if (task->stack_free == 0) {
+            strcpy(stack, "n/a");
+        } else {
+            snprintf(stack, sizeof(stack), "%lu", (unsigned long)task->stack_free);
+        }
+        if (stats.cpu_valid && task->cpu_percent >= 0.0f) {
+            snprintf(cpu, sizeof(cpu), "%.1f%%", task->cpu_percent);
+        } else {
+            strcpy(cpu, "n/a");
+        }
+        LOG_DEBUG("[tasks] %-16s core %-2s prio %2u  cpu %6s  stack free %6s",
+                  task->name, core, task->priority, cpu, stack);
+    }
+    if (stats.cpu_valid) {
+        for (int core = 0; core < stats.cores; core++) {
+            LOG_DEBUG("[tasks] core %d load %5.1f%%", core, stats.core_load[core]);
+        }
+    }
+    if (stats.heap.internal_free > 0) {
+        LOG_DEBUG("[tasks] internal ram free %u (min %u, largest block %u)",
+                  stats.heap.internal_free, stats.heap.internal_min_free, stats.heap.internal_largest_block);
+    }
+    if (stats.heap.psram_size > 0) {
+        LOG_DEBUG("[tasks] psram free %u of %u (min %u)",
+                  stats.heap.psram_free, stats.heap.psram_size, stats.heap.psram_min_free);
+    }
+}
@@ -0,0 +1,447 @@
+// tls_client.cpp
+// tls transport for pool connections, mbedtls on top of a TcpClient
+
+#include "mining/tls_client.h"
+#include <mbedtls/version.h>
+#include <mbedtls/net_sockets.h>
+
+// ssl context fields went private in mbedtls 3
+#if MBEDTLS_VERSION_MAJOR >= 3
+#define TLS_SSL_STATE(ssl) ((ssl).MBEDTLS_PRIVATE(state))
+#else
+#define TLS_SSL_STATE(ssl) ((ssl).state)
+#endif
+
+static const char* TLS_DRBG_PERSONALIZATION = "esp32btcminer";
+
+// constructor - mbedtls contexts are set up lazily on first connect
+TlsClient::TlsClient() {
+    initialized = false;
+    ca_cert_loaded = false;
+    ssl_active = false;
+    peeked = -1;
+
+    mbedtls_ssl_session_init(&session);
+    session_saved = false;
+    session_host[0] = '\0';
+    server_name[0] = '\0';
+
+    last_handshake_ms = 0;
+    last_resumed = false;
+    full_handshakes = 0;
+    resumed_handshakes = 0;
+    full_handshake_ms_total = 0;
+    resumed_handshake_ms_total = 0;
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&session);
+    if (initialized) {
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_ctr_drbg_free(&ctr_drbg);
+        mbedtls_entropy_free(&entropy);
+        mbedtls_x509_crt_free(&ca_cert);
+    }
+}
+
+// one-time rng and config setup
+bool TlsClient::init_config() {
+    if (initialized) {
+        return true;
+    }
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_x509_crt_init(&ca_cert);
+    initialized = true;
+
+    int ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char*)TLS_DRBG_PERSONALIZATION,
+                                    strlen(TLS_DRBG_PERSONALIZATION));
+    if (ret != 0) {
+        Serial.print("[tls] rng seed failed: -0x");
+        Serial.println(-ret, HEX);
+        return false;
+    }
+
+    ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        Serial.print("[tls] config failed: -0x");
+        Serial.println(-ret, HEX);
+        return false;
+    }
+
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    mbedtls_ssl_conf_max_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+
+    return true;
+}
+
+// set pem ca certificate, verification is required from then on
+void TlsClient::set_ca_cert(const char* pem) {
+    if (!init_config()) {
+        return;
+    }
+
+    mbedtls_x509_crt_free(&ca_cert);
+    mbedtls_x509_crt_init(&ca_cert);
+    ca_cert_loaded = false;
+
+    if (pem == NULL) {
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+        return;
+    }
+
+    // pem parser wants the terminating nul counted
+    int ret = mbedtls_x509_crt_parse(&ca_cert, (const unsigned char*)pem, strlen(pem) + 1);
+    if (ret != 0) {
+        Serial.print("[tls] bad ca certificate: -0x");
+        Serial.println(-ret, HEX);
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+        return;
+    }
+
+    mbedtls_ssl_conf_ca_chain(&conf, &ca_cert, NULL);
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    ca_cert_loaded = true;
+}
+
+// set host name used when connecting by address
+void TlsClient::set_server_name(const char* name) {
+    strncpy(server_name, name, sizeof(server_name) - 1);
+    server_name[sizeof(server_name) - 1] = '\0';
+}
+
+// forget the saved session
+void TlsClient::clear_session() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    session_saved = false;
+    session_host[0] = '\0';
+}
+
+// connect by address - handshake uses the server name if one was set
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    stop();
+
+    if (!init_config()) {
+        return 0;
+    }
+
+    if (!tcp.connect(ip, port)) {
+        return 0;
+    }
+    tcp.setNoDelay(true);
+
+    char host[16];
+    snprintf(host, sizeof(host), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+    if (!handshake(server_name[0] != '\0' ? server_name : host)) {
+        stop();
+        return 0;
+    }
+
+    return 1;
+}
+
+// tcp connect, then handshake - resumes the saved session if it is for this host
+int TlsClient::connect(const char* host, uint16_t port) {
+    stop();
+
+    if (!init_config()) {
+        return 0;
+    }
+
+    if (!tcp.connect(host, port)) {
+        return 0;
+    }
+    tcp.setNoDelay(true);
+
+    if (!handshake(host)) {
+        stop();
+        return 0;
+    }
+
+    return 1;
+}
+
+// run the handshake step by step, a full one passes through the server key exchange
+bool TlsClient::handshake(const char* host) {
+    mbedtls_ssl_init(&ssl);
+    ssl_active = true;
+    peeked = -1;
+
+    int ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) {
+        Serial.print("[tls] setup failed: -0x");
+        Serial.println(-ret, HEX);
+        return false;
+    }
+
+    mbedtls_ssl_set_hostname(&ssl, host);
+    mbedtls_ssl_set_bio(&ssl, &tcp, bio_send, bio_recv, NULL);
+
+    bool offered = false;
+    if (session_saved && strcmp(host, session_host) == 0) {
+        offered = mbedtls_ssl_set_session(&ssl, &session) == 0;
+    }
+
+    bool key_exchange = false;
+    unsigned long start = millis();
+
+    while (TLS_SSL_STATE(ssl) != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        ret = mbedtls_ssl_handshake_step(&ssl);
+
+        if (TLS_SSL_STATE(ssl) == MBEDTLS_SSL_SERVER_KEY_EXCHANGE) {
+            key_exchange = true;
+        }
+
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            if (!tcp.connected() || millis() - start > TLS_HANDSHAKE_TIMEOUT) {
+                Serial.println("[tls] handshake timed out");
+                return false;
+            }
+            delay(1);
+        } else if (ret != 0) {
+            Serial.print("[tls] handshake failed: -0x");
+            Serial.println(-ret, HEX);
+
+            // a session the server refuses to resume must not be offered again
+            if (offered) {
+                clear_session();
+            }
+            return false;
+        }
+    }
+
+    last_handshake_ms = millis() - start;
+    last_resumed = offered && !key_exchange;
+
+    if (last_resumed) {
+        resumed_handshakes++;
+        resumed_handshake_ms_total += last_handshake_ms;
+    } else {
+        full_handshakes++;
+        full_handshake_ms_total += last_handshake_ms;
+    }
+
+    Serial.print("[tls] handshake ");
+    Serial.print(last_handshake_ms);
+    Serial.print(" ms (");
+    Serial.print(last_resumed ? "resumed" : "full");
+    Serial.print(", ");
+    Serial.print(mbedtls_ssl_get_ciphersuite(&ssl));
+    Serial.println(")");
+
+    if (!ca_cert_loaded) {
+        Serial.println("[tls] server certificate not verified");
+    }
+
+    save_session(host);
+    return true;
+}
+
+// keep the negotiated session (with its ticket, if any) for the next connect
+void TlsClient::save_session(const char* host) {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+
+    if (mbedtls_ssl_get_session(&ssl, &session) != 0) {
+        session_saved = false;
+        return;
+    }
+
+    session_saved = true;
+    strncpy(session_host, host, sizeof(session_host) - 1);
+    session_host[sizeof(session_host) - 1] = '\0';
+}
+
+// write a single byte
+size_t TlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+// write all bytes, mbedtls may take them in several records
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    if (!ssl_active) {
+        return 0;
+    }
+
+    size_t written = 0;
+    unsigned long start = millis();
+
+    while (written < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + written, size - written);
+
+        if (ret > 0) {
+            written += ret;
+        } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) {
+            if (!tcp.connected() || millis() - start > TLS_HANDSHAKE_TIMEOUT) {
+                break;
+            }
+            delay(1);
+        } else {
+            Serial.print("[tls] write failed: -0x");
+            Serial.println(-ret, HEX);
+            stop();
+            break;
+        }
+    }
+
+    return written;
+}
+
+// decrypted bytes ready to read, pulls in pending records first
+int TlsClient::available() {
+    if (!ssl_active) {
+        return 0;
+    }
+
+    int pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (pending == 0 && tcp.available() > 0) {
+        // zero-length read processes the next record without consuming data
+        int ret = mbedtls_ssl_read(&ssl, NULL, 0);
+        if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ||
+            (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)) {
+            stop();
+            return peeked >= 0 ? 1 : 0;
+        }
+        pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    }
+
+    return pending + (peeked >= 0 ? 1 : 0);
+}
+
+// read a single byte, -1 if none
+int TlsClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+// read up to size bytes without blocking
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    if (peeked >= 0) {
+        buf[count++] = (uint8_t)peeked;
+        peeked = -1;
+    }
+
+    if (count < size && available() > 0 && ssl_active) {
+        int ret = mbedtls_ssl_read(&ssl, buf + count, size - count);
+        if (ret > 0) {
+            count += ret;
+        }
+    }
+
+    return count > 0 ? (int)count : -1;
+}
+
+// look at the next byte without consuming it
+int TlsClient::peek() {
+    if (peeked < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) {
+            peeked = b;
+        }
+    }
+    return peeked;
+}
+
+// writes are not buffered here
+void TlsClient::flush() {
+    tcp.flush();
+}
+
+// close the connection, the saved session survives for the next connect
+void TlsClient::stop() {
+    if (ssl_active) {
+        if (tcp.connected()) {
+            mbedtls_ssl_close_notify(&ssl);
+        }
+        mbedtls_ssl_free(&ssl);
+        ssl_active = false;
+    }
+    peeked = -1;
+    tcp.stop();
+}
+
+// connected while the socket is open or decrypted data is left to read
+uint8_t TlsClient::connected() {
+    if (!ssl_active) {
+        return 0;
+    }
+    return tcp.connected() || peeked >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0;
+}
+
+TlsClient::operator bool() {
+    return connected();
+}
+
+// get duration of the last handshake
+uint32_t TlsClient::get_last_handshake_ms() {
+    return last_handshake_ms;
+}
+
+// check if the last handshake resumed a saved session
+bool TlsClient::was_resumed() {
+    return last_resumed;
+}
+
+// get number of full handshakes
+uint32_t TlsClient::get_full_handshakes() {
+    return full_handshakes;
+}
+
+// get number of resumed handshakes
+uint32_t TlsClient::get_resumed_handshakes() {
+    return resumed_handshakes;
+}
+
+// get average full handshake duration
+uint32_t TlsClient::get_full_handshake_ms_avg() {
+    return full_handshakes > 0 ? full_handshake_ms_total / full_handshakes : 0;
+}
+
+// get average resumed handshake duration
+uint32_t TlsClient::get_resumed_handshake_ms_avg() {
+    return resumed_handshakes > 0 ? resumed_handshake_ms_total / resumed_handshakes : 0;
+}
+
+// bio send - hand ciphertext to the socket
+int TlsClient::bio_send(void* ctx, const unsigned char* buf, size_t len) {
+    TcpClient* tcp = (TcpClient*)ctx;
+    if (!tcp->connected()) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+
+    size_t sent = tcp->write(buf, len);
+    if (sent == 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    return (int)sent;
+}
+
+// bio receive - never blocks, mbedtls retries on want read
+int TlsClient::bio_recv(void* ctx, unsigned char* buf, size_t len) {
+    TcpClient* tcp = (TcpClient*)ctx;
+    if (tcp->available() <= 0) {
+        return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+
+    int got = tcp->read(buf, len);
+    if (got <= 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    return got;
+}
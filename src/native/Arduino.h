@@ -0,0 +1,61 @@
+// Arduino.h
+// the part of arduino-esp32 the mining core uses, for the native build
+//
+// Serial writes to stdout, the clock runs on CLOCK_MONOTONIC, psram
+// allocations are plain heap allocations
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+using std::min;
+using std::max;
+
+// monotonic clock, counted from program start
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// arduino-esp32 extras
+void* ps_malloc(size_t size);
+void* ps_realloc(void* ptr, size_t size);
+uint32_t esp_random();
+
+// Serial on stdout, input is not used by the mining core
+class NativeSerial : public Stream {
+public:
+    void begin(unsigned long baud) {}
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush();
+    operator bool() { return true; }
+
+    // drop output, keeps logging out of replay timings
+    void set_muted(bool muted_in) { muted = muted_in; }
+
+    using Print::write;
+
+private:
+    bool muted = false;
+};
+
+extern NativeSerial Serial;
+
+#endif
@@ -0,0 +1,28 @@
+// IPAddress.h
+// arduino IPAddress for the native build, ipv4 only like the mining core
+
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+#include <stdint.h>
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+    IPAddress(uint32_t ip) : address(ip) {}      // network byte order, like lwip and s_addr
+
+    operator uint32_t() const { return address; }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    bool operator!=(const IPAddress& other) const { return address != other.address; }
+    uint8_t operator[](int index) const { return ((const uint8_t*)&address)[index]; }
+
+    bool fromString(const char* address);
+    String toString() const;
+
+private:
+    uint32_t address;
+};
+
+#endif
@@ -0,0 +1,52 @@
+// Print.h
+// arduino Print for the native build
+
+#ifndef NATIVE_PRINT_H
+#define NATIVE_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print_number((unsigned long long)n, base); }
+    size_t print(int n, int base = DEC) { return print_signed(n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print_number(n, base); }
+    size_t print(long n, int base = DEC) { return print_signed(n, base); }
+    size_t print(unsigned long n, int base = DEC) { return print_number(n, base); }
+    size_t print(long long n, int base = DEC) { return print_signed(n, base); }
+    size_t print(unsigned long long n, int base = DEC) { return print_number(n, base); }
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    size_t print_number(unsigned long long n, int base);
+    size_t print_signed(long long n, int base);
+};
+
+#endif
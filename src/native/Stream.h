@@ -0,0 +1,32 @@
+// Stream.h
+// arduino Stream for the native build
+
+#ifndef NATIVE_STREAM_H
+#define NATIVE_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    Stream() : timeout_ms(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { timeout_ms = timeout; }
+    unsigned long getTimeout() const { return timeout_ms; }
+
+    // blocking reads, give up after the stream timeout
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeout_ms;
+
+    int timedRead();
+};
+
+#endif
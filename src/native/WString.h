@@ -0,0 +1,59 @@
+// WString.h
+// arduino String for the native build - the subset the mining core and
+// ArduinoJson use, backed by std::string
+
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <string>
+#include <stddef.h>
+
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    String(char c) : value(1, c) {}
+    explicit String(int n) : value(std::to_string(n)) {}
+    explicit String(unsigned int n) : value(std::to_string(n)) {}
+    explicit String(long n) : value(std::to_string(n)) {}
+    explicit String(unsigned long n) : value(std::to_string(n)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+    bool concat(const char* s) { if (s) value += s; return true; }
+    bool concat(const String& s) { value += s.value; return true; }
+    bool concat(char c) { value += c; return true; }
+    String& operator+=(const char* s) { concat(s); return *this; }
+    String& operator+=(const String& s) { concat(s); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    bool equals(const char* s) const { return value == (s ? s : ""); }
+    bool operator==(const String& s) const { return value == s.value; }
+    bool operator==(const char* s) const { return equals(s); }
+    bool operator!=(const String& s) const { return value != s.value; }
+    char operator[](unsigned int i) const { return i < value.size() ? value[i] : '\0'; }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t pos = value.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > value.size()) return String();
+        return String(value.substr(from, to > from ? to - from : 0));
+    }
+    String substring(unsigned int from) const { return substring(from, length()); }
+    void trim();
+    long toInt() const;
+
+private:
+    std::string value;
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+
+#endif
@@ -0,0 +1,241 @@
+// arduino_native.cpp
+// the arduino subset of the native build
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <arpa/inet.h>
+
+NativeSerial Serial;
+
+// ----- clock -----
+
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// arduino counts from boot, count from program start so millis() wraps at the same age
+static const uint64_t start_us = monotonic_us();
+
+unsigned long millis() {
+    return (uint32_t)((monotonic_us() - start_us) / 1000);
+}
+
+unsigned long micros() {
+    return (uint32_t)(monotonic_us() - start_us);
+}
+
+void delay(uint32_t ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0) {
+    }
+}
+
+void delayMicroseconds(uint32_t us) {
+    usleep(us);
+}
+
+void yield() {
+    sched_yield();
+}
+
+// ----- arduino-esp32 extras -----
+
+void* ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+void* ps_realloc(void* ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+uint32_t esp_random() {
+    uint32_t value = 0;
+    if (getrandom(&value, sizeof(value), 0) != sizeof(value)) {
+        value = (uint32_t)monotonic_us() * 2654435761u;
+    }
+    return value;
+}
+
+// ----- Serial -----
+
+size_t NativeSerial::write(uint8_t c) {
+    return muted ? 1 : fwrite(&c, 1, 1, stdout);
+}
+
+size_t NativeSerial::write(const uint8_t* buffer, size_t size) {
+    return muted ? size : fwrite(buffer, 1, size, stdout);
+}
+
+void NativeSerial::flush() {
+    fflush(stdout);
+}
+
+// ----- String -----
+
+void String::trim() {
+    size_t begin = 0;
+    size_t end = value.size();
+    while (begin < end && isspace((unsigned char)value[begin])) begin++;
+    while (end > begin && isspace((unsigned char)value[end - 1])) end--;
+    value = value.substr(begin, end - begin);
+}
+
+long String::toInt() const {
+    return strtol(value.c_str(), NULL, 10);
+}
+
+// ----- Print -----
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::print_number(unsigned long long n, int base) {
+    char buf[8 * sizeof(n) + 1];
+    char* p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+
+    if (base < 2) {
+        base = 10;
+    }
+    do {
+        int digit = n % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        n /= base;
+    } while (n);
+
+    return write(p);
+}
+
+// only decimal is signed, other bases print the two's complement like arduino,
+// 32 bits wide for anything that fits, long is 32 bits on the esp32
+size_t Print::print_signed(long long n, int base) {
+    if (base != DEC) {
+        if (n >= INT32_MIN && n <= INT32_MAX) {
+            return print_number((uint32_t)n, base);
+        }
+        return print_number((unsigned long long)n, base);
+    }
+    if (n < 0) {
+        return print('-') + print_number(-(unsigned long long)n, DEC);
+    }
+    return print_number(n, DEC);
+}
+
+size_t Print::print(double n, int digits) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return 0;
+    }
+    if ((size_t)len < sizeof(buf)) {
+        return write((const uint8_t*)buf, len);
+    }
+
+    // longer than the stack buffer
+    char* big = (char*)malloc(len + 1);
+    if (big == NULL) {
+        return 0;
+    }
+    va_start(args, format);
+    vsnprintf(big, len + 1, format, args);
+    va_end(args);
+    size_t n = write((const uint8_t*)big, len);
+    free(big);
+    return n;
+}
+
+// ----- Stream -----
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+        delay(1);
+    } while (millis() - start < timeout_ms);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) {
+            break;
+        }
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        result += (char)c;
+        c = timedRead();
+    }
+    return result;
+}
+
+// ----- IPAddress -----
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    uint8_t bytes[4] = {a, b, c, d};
+    memcpy(&address, bytes, 4);
+}
+
+bool IPAddress::fromString(const char* text) {
+    struct in_addr addr;
+    if (text == NULL || inet_pton(AF_INET, text, &addr) != 1) {
+        return false;
+    }
+    address = addr.s_addr;
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buf[INET_ADDRSTRLEN];
+    struct in_addr addr;
+    addr.s_addr = address;
+    inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+    return String(buf);
+}
@@ -0,0 +1,406 @@
+// main.cpp
+// native miner daemon - the mining core as a linux process
+//
+//   esp32btcminer --pool stratum+tcp://host:3333 --wallet bc1q... [--threads 8] [--seconds 60]
+//
+// pool and wallet go into the key/value store like the config screens would
+// write them, so a later run without arguments mines with the same setup.
+// one pinned worker per core unless --threads says otherwise, workers claim
+// nonce chunks from the shared work and the extranonce2 rolls when they run out.
+// runs until ctrl-c, or --seconds if given
+//
+// stress runs: --strict turns rejected shares and kernel mismatches into exit
+// status 1, e.g. a few minutes against a local pool under the native-asan env
+//
+// parser benchmarks: --capture file records the stratum session to kv/stratum.cap,
+// --replay <file> feeds a capture (or a device serial log with --capture serial
+// lines) back through the stratum parser and prints per-line and job switch times
+//
+// microbenchmarks: --bench runs the kernel and protocol helper benchmarks and
+// compares them with kv/bench.base, exit status 1 when one got slower than its
+// tolerance. --bench-save writes the current numbers as the new baseline
+// ESP32BTCMINER_LANES=avx512|avx2|sse2|off caps the x86 nonce scanner below
+// what cpuid found, e.g. to compare avx2 with avx512 on the same host
+//
+// --log-level debug adds every pool line sent and received, error and warn
+// leave only problems, off silences the log ring entirely
+//
+// --pause-every <n> pauses and resumes every n seconds, the way the device's
+// start/stop would, and logs each resume-to-first-hash latency
+//
+// --telemetry on mixes binary stats frames into stdout once a second, the
+// way the device sends them over usb:
+//   esp32btcminer --telemetry on | telemetry_decode -
+
+#include <Arduino.h>
+#include <signal.h>
+#include "platform/platform.h"
+#include "mining/mining_manager.h"
+#include "mining/sha256_miner.h"
+#include "mining/stratum_capture.h"
+#include "mining/benchmark.h"
+#include "mining/log_ring.h"
+
+// pio test builds the sources with test_build_src, the test brings its own main
+#if !defined(PIO_UNIT_TESTING)
+
+// nvs namespace used by config screens
+#define NVS_NAMESPACE "esp32btcminer"
+
+// how often the daemon prints a stats line (milliseconds)
+#define STATS_INTERVAL 1000
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int signal) {
+    stop_requested = 1;
+}
+
+static void print_usage(const char* program) {
+    printf("usage: %s [--pool <address>] [--wallet <address>] [--proxy-port <port>]\n", program);
+    printf("          [--auto-worker] [--threads <n>] [--seconds <n>] [--strict] [--per-thread]\n");
+    printf("          [--capture off|serial|file] [--log-level off|error|warn|info|debug]\n");
+    printf("          [--telemetry on|off] [--device-id <hex>|mac] [--pause-every <seconds>]\n");
+    printf("       %s --replay <capture or serial log> [--replay-realtime]\n", program);
+    printf("       %s --bench [<name filter>] [--bench-json] [--bench-save] [--bench-tolerance <percent>]\n", program);
+    printf("  pool addresses as on the device: host:port, stratum+ssl://, sv2://, solo://\n");
+    printf("  --threads defaults to one worker per core (at most %d)\n", MINING_WORKER_COUNT);
+    printf("  --strict exits with status 1 on rejected shares or kernel mismatches\n");
+    printf("  --capture file records stratum sessions to the settings dir as stratum.cap\n");
+    printf("  --replay runs the lines through the parser back to back, or with the\n");
+    printf("    captured timing with --replay-realtime, and prints parse times\n");
+    printf("  --bench-tolerance widens every benchmark's regression limit, for busy hosts\n");
+    printf("  --pause-every pauses and resumes mining in turn, each resume logs its latency\n");
+    printf("  --device-id overrides the mac-derived fleet id (stored), mac goes back to it\n");
+    printf("  settings are kept in $ESP32BTCMINER_KV_DIR (default ./kv)\n");
+}
+
+// store an address in slot 0 and make it the active one
+static void store_slot(KvStore& prefs, const char* kind, const char* address) {
+    char key[16];
+    for (int i = 0; i < 4; i++) {
+        sprintf(key, "%s%d_act", kind, i);
+        prefs.putBool(key, i == 0);
+    }
+    sprintf(key, "%s0_cfg", kind);
+    prefs.putBool(key, true);
+    sprintf(key, "%s0_addr", kind);
+    prefs.putString(key, address);
+}
+
+// per-worker hash totals at the previous stats line
+static uint64_t last_worker_hashes[MINING_WORKER_COUNT];
+
+static void print_stats(bool per_thread, unsigned long elapsed_ms) {
+    mining_stats_t stats = mining_manager.get_stats();
+    
+    // last completed second from the hashrate history, next to the 1 minute ewma
+    uint32_t last_second = 0;
+    mining_manager.get_hashrate_seconds(&last_second, 1);
+    
+    Serial.printf("[native] %.2f MH/s (1m %.2f)  %u workers  hashes %llu  shares %u/%u/%u/%u/%u (found/accepted/rejected/replayed/dropped)  diff %.4f  best %.4f  en2 rolls %u  %s\n",
+                  last_second / 1e6,
+                  stats.hashrate / 1e6,
+                  stats.workers,
+                  (unsigned long long)stats.hashes_total,
+                  stats.shares_found,
+                  stats.shares_accepted,
+                  stats.shares_rejected,
+                  stats.shares_replayed,
+                  stats.shares_dropped,
+                  stats.current_difficulty,
+                  stats.best_difficulty,
+                  stats.extranonce2_rolls,
+                  stats.pool_connected ? "connected" : "disconnected");
+    
+    // worker rates since the last line, uneven rates point at chunk starvation or a busy core
+    if (per_thread && elapsed_ms > 0) {
+        Serial.print("[native] per worker MH/s:");
+        for (int i = 0; i < stats.workers; i++) {
+            uint64_t hashes = mining_manager.get_worker_hashes(i);
+            Serial.printf(" %.2f", (hashes - last_worker_hashes[i]) / (elapsed_ms * 1000.0));
+            last_worker_hashes[i] = hashes;
+        }
+        Serial.println();
+    }
+}
+
+// rejected shares or shares another kernel disagreed with
+static bool strict_failure() {
+    mining_stats_t stats = mining_manager.get_stats();
+    
+    if (stats.shares_rejected > 0) {
+        return true;
+    }
+    for (int i = 0; i < SHA256_KERNEL_COUNT; i++) {
+        if (stats.kernel_mismatches[i] > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// replay a capture through a fresh client, log output muted so it is not timed
+static int run_replay(const char* path, bool realtime) {
+    StratumClient* client = new StratumClient();
+    replay_stats_t stats;
+
+    Serial.set_muted(true);
+    bool ok = stratum_replay_run(*client, path, realtime, &stats);
+    Serial.set_muted(false);
+    delete client;
+
+    if (!ok) {
+        Serial.print("[native] cannot replay ");
+        Serial.println(path);
+        return 1;
+    }
+
+    Serial.printf("[native] replayed %u lines (%u notifies, %u sessions, %u sent lines skipped) in %u ms\n",
+                  stats.lines, stats.notifies, stats.sessions, stats.skipped, stats.elapsed_ms);
+    Serial.printf("[native] parse avg %.2f us, max %u us\n",
+                  stats.lines > 0 ? (double)stats.parse_us / stats.lines : 0.0, stats.parse_max_us);
+    Serial.printf("[native] job switch (notify + header) avg %.2f us, max %u us\n",
+                  stats.notifies > 0 ? (double)stats.switch_us / stats.notifies : 0.0, stats.switch_max_us);
+    return 0;
+}
+
+// microbenchmarks against the saved baseline
+static int run_bench(const char* filter, bool json, bool save, uint8_t extra_tolerance) {
+    static bench_result_t results[BENCH_MAX_RESULTS];
+
+    // picks the lanes isa mine_nonce_range uses
+    miner_init();
+
+    uint8_t count = benchmark_run(filter, results, BENCH_MAX_RESULTS);
+    bool have_baseline = benchmark_load_baseline(BENCH_BASELINE_PATH, results, count);
+    uint8_t regressions = benchmark_check(results, count, extra_tolerance);
+
+    if (json) {
+        benchmark_print_json(results, count);
+    } else {
+        benchmark_print(results, count);
+    }
+
+    if (save) {
+        if (!benchmark_save_baseline(BENCH_BASELINE_PATH, results, count)) {
+            Serial.println("[native] cannot write the benchmark baseline");
+            return 1;
+        }
+        Serial.println("[native] benchmark baseline saved");
+        return 0;
+    }
+    if (!have_baseline) {
+        Serial.println("[native] no benchmark baseline yet, --bench-save writes one");
+    } else if (regressions > 0) {
+        Serial.printf("[native] %u benchmarks regressed\n", regressions);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* pool = NULL;
+    const char* wallet = NULL;
+    long proxy_port = -1;
+    bool auto_worker = false;
+    long run_seconds = 0;
+    long threads = 0;
+    bool strict = false;
+    bool per_thread = false;
+    const char* capture = NULL;
+    const char* replay = NULL;
+    bool replay_realtime = false;
+    bool bench = false;
+    const char* bench_filter = NULL;
+    bool bench_json = false;
+    bool bench_save = false;
+    long bench_tolerance = 0;
+    const char* log_level_name = NULL;
+    const char* telemetry = NULL;
+    const char* device_id = NULL;
+    long pause_every = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--pool") == 0 && has_value) {
+            pool = argv[++i];
+        } else if (strcmp(argv[i], "--wallet") == 0 && has_value) {
+            wallet = argv[++i];
+        } else if (strcmp(argv[i], "--proxy-port") == 0 && has_value) {
+            proxy_port = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+            run_seconds = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && has_value) {
+            capture = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && has_value) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+            if (has_value && argv[i + 1][0] != '-') {
+                bench_filter = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--bench-json") == 0) {
+            bench_json = true;
+        } else if (strcmp(argv[i], "--bench-save") == 0) {
+            bench_save = true;
+        } else if (strcmp(argv[i], "--bench-tolerance") == 0 && has_value) {
+            bench_tolerance = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--pause-every") == 0 && has_value) {
+            pause_every = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--device-id") == 0 && has_value) {
+            device_id = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0 && has_value) {
+            telemetry = argv[++i];
+        } else if (strcmp(argv[i], "--log-level") == 0 && has_value) {
+            log_level_name = argv[++i];
+        } else if (strcmp(argv[i], "--replay-realtime") == 0) {
+            replay_realtime = true;
+        } else if (strcmp(argv[i], "--auto-worker") == 0) {
+            auto_worker = true;
+        } else if (strcmp(argv[i], "--strict") == 0) {
+            strict = true;
+        } else if (strcmp(argv[i], "--per-thread") == 0) {
+            per_thread = true;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // line buffered, log lines show up as they happen when piped
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (log_level_name != NULL) {
+        static const char* const LEVEL_NAMES[] = { "off", "error", "warn", "info", "debug" };
+        int level = -1;
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(log_level_name, LEVEL_NAMES[i]) == 0) {
+                level = i;
+            }
+        }
+        if (level < 0) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        log_set_level((log_level_t)level);
+    }
+
+    if (replay != NULL) {
+        return run_replay(replay, replay_realtime);
+    }
+    if (bench) {
+        bench_tolerance = bench_tolerance < 0 ? 0 : min(bench_tolerance, 255L);
+        return run_bench(bench_filter, bench_json, bench_save, (uint8_t)bench_tolerance);
+    }
+
+    if (pool != NULL || wallet != NULL) {
+        KvStore prefs;
+        prefs.begin(NVS_NAMESPACE, false);
+        if (pool != NULL) {
+            store_slot(prefs, "pool", pool);
+        }
+        if (wallet != NULL) {
+            store_slot(prefs, "wallet", wallet);
+        }
+        prefs.end();
+    }
+    if (proxy_port >= 0) {
+        mining_manager.set_proxy_port((uint16_t)proxy_port);
+    }
+    if (auto_worker) {
+        mining_manager.set_auto_worker_name(true);
+    }
+    if (device_id != NULL) {
+        if (strcmp(device_id, "mac") == 0) {
+            mining_manager.clear_device_id();
+        } else {
+            mining_manager.set_device_id((uint16_t)strtoul(device_id, NULL, 16));
+        }
+    }
+    if (capture != NULL) {
+        if (strcmp(capture, "file") == 0) {
+            mining_manager.set_capture_mode(capture_mode_t::FILE_LOG);
+        } else if (strcmp(capture, "serial") == 0) {
+            mining_manager.set_capture_mode(capture_mode_t::SERIAL_LOG);
+        } else if (strcmp(capture, "off") == 0) {
+            mining_manager.set_capture_mode(capture_mode_t::OFF);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (telemetry != NULL) {
+        if (strcmp(telemetry, "on") == 0 || strcmp(telemetry, "off") == 0) {
+            mining_manager.set_telemetry_enabled(strcmp(telemetry, "on") == 0);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // set_worker_count() clamps to 1..MINING_WORKER_COUNT
+    if (threads <= 0) {
+        threads = platform_core_count();
+    }
+    mining_manager.set_worker_count(threads > 255 ? 255 : (uint8_t)threads);
+    
+    miner_init();
+
+    if (!mining_manager.is_configured()) {
+        Serial.println("[native] no pool or wallet configured");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    if (!mining_manager.start_mining()) {
+        Serial.print("[native] start failed: ");
+        Serial.println(mining_manager.get_error_message());
+        return 1;
+    }
+
+    // the arduino loop() of the device - process() runs the pool side
+    unsigned long start = millis();
+    unsigned long last_stats = start;
+    unsigned long last_toggle = start;
+    while (!stop_requested) {
+        mining_manager.process();
+
+        if (pause_every > 0 && millis() - last_toggle >= (unsigned long)pause_every * 1000) {
+            last_toggle = millis();
+            if (mining_manager.is_paused()) {
+                mining_manager.resume_mining();
+            } else {
+                mining_manager.pause_mining();
+            }
+        }
+
+        if (millis() - last_stats >= STATS_INTERVAL) {
+            unsigned long now = millis();
+            print_stats(per_thread, now - last_stats);
+            last_stats = now;
+        }
+        if (run_seconds > 0 && millis() - start >= (unsigned long)run_seconds * 1000) {
+            break;
+        }
+        delay(1);
+    }
+
+    print_stats(per_thread, millis() - last_stats);
+    mining_manager.stop_mining();
+    log_flush(1000);
+    
+    if (strict && strict_failure()) {
+        Serial.println("[native] strict: rejected shares or kernel mismatches");
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,781 @@
+// platform_native.cpp
+// platform layer on linux - posix sockets, files and pthreads
+
+#include "platform/platform.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netpacket/packet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include "mbedtls/sha256.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// connect timeout, the same as WiFiClient's default
+#define NATIVE_CONNECT_TIMEOUT 3000
+
+// write timeout before a stuck connection is dropped
+#define NATIVE_WRITE_TIMEOUT 5000
+
+#define KV_DIR_ENV "ESP32BTCMINER_KV_DIR"
+#define KV_DIR_DEFAULT "kv"
+
+// ----- tcp client -----
+
+native_socket_t::~native_socket_t() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+TcpClient::TcpClient(int fd) : no_delay(false) {
+    if (fd >= 0) {
+        socket = std::make_shared<native_socket_t>(fd);
+    }
+}
+
+// non-blocking connect so a dead pool can't hang us longer than the timeout
+int TcpClient::connect(IPAddress ip, uint16_t port) {
+    stop();
+
+    int s = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0) {
+        return 0;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+
+    int ret = ::connect(s, (struct sockaddr*)&addr, sizeof(addr));
+    if (ret < 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = {s, POLLOUT, 0};
+        ret = -1;
+        if (poll(&pfd, 1, NATIVE_CONNECT_TIMEOUT) == 1) {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &len);
+            ret = error == 0 ? 0 : -1;
+        }
+    }
+    if (ret < 0) {
+        ::close(s);
+        return 0;
+    }
+
+    // back to blocking writes, reads pass MSG_DONTWAIT themselves
+    fcntl(s, F_SETFL, flags);
+
+    struct timeval tv = {NATIVE_WRITE_TIMEOUT / 1000, 0};
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    socket = std::make_shared<native_socket_t>(s);
+    setNoDelay(no_delay);
+    return 1;
+}
+
+int TcpClient::connect(const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!ip.fromString(host) && !platform_resolve(host, ip)) {
+        return 0;
+    }
+    return connect(ip, port);
+}
+
+size_t TcpClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t TcpClient::write(const uint8_t* buf, size_t size) {
+    size_t sent = 0;
+    while (sent < size && fd() >= 0) {
+        ssize_t n = ::send(fd(), buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            stop();
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+int TcpClient::available() {
+    if (fd() < 0) {
+        return 0;
+    }
+    int count = 0;
+    if (ioctl(fd(), FIONREAD, &count) < 0) {
+        return 0;
+    }
+    return count;
+}
+
+int TcpClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int TcpClient::read(uint8_t* buf, size_t size) {
+    if (fd() < 0) {
+        return -1;
+    }
+    ssize_t n = ::recv(fd(), buf, size, MSG_DONTWAIT);
+    return n > 0 ? (int)n : -1;
+}
+
+int TcpClient::peek() {
+    if (fd() < 0) {
+        return -1;
+    }
+    uint8_t b;
+    return ::recv(fd(), &b, 1, MSG_DONTWAIT | MSG_PEEK) == 1 ? b : -1;
+}
+
+void TcpClient::stop() {
+    socket.reset();
+}
+
+// a closed peer shows up as a zero-length peek, then the socket is dropped
+uint8_t TcpClient::connected() {
+    if (fd() < 0) {
+        return 0;
+    }
+    uint8_t b;
+    ssize_t n = ::recv(fd(), &b, 1, MSG_DONTWAIT | MSG_PEEK);
+    if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
+        return 1;
+    }
+    stop();
+    return 0;
+}
+
+void TcpClient::setNoDelay(bool enabled) {
+    no_delay = enabled;
+    if (fd() >= 0) {
+        int value = enabled ? 1 : 0;
+        setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+    }
+}
+
+// ----- tcp server -----
+
+void TcpServer::begin(uint16_t port_in) {
+    if (port_in != 0) {
+        port = port_in;
+    }
+    end();
+
+    int s = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (s < 0) {
+        return;
+    }
+    int value = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (::bind(s, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(s, 4) < 0) {
+        Serial.print("[platform] listen on port ");
+        Serial.print(port);
+        Serial.print(" failed: ");
+        Serial.println(strerror(errno));
+        ::close(s);
+        return;
+    }
+    listen_fd = s;
+}
+
+void TcpServer::end() {
+    if (pending_fd >= 0) {
+        ::close(pending_fd);
+        pending_fd = -1;
+    }
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+bool TcpServer::hasClient() {
+    if (pending_fd < 0 && listen_fd >= 0) {
+        pending_fd = ::accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    }
+    return pending_fd >= 0;
+}
+
+TcpClient TcpServer::available() {
+    if (!hasClient()) {
+        return TcpClient();
+    }
+    TcpClient client(pending_fd);
+    pending_fd = -1;
+    client.setNoDelay(no_delay);
+    return client;
+}
+
+// ----- key/value store -----
+
+bool KvStore::begin(const char* name, bool read_only_in) {
+    end();
+
+    const char* dir = getenv(KV_DIR_ENV);
+    if (dir == NULL || dir[0] == '\0') {
+        dir = KV_DIR_DEFAULT;
+    }
+    mkdir(dir, 0755);
+    path = std::string(dir) + "/" + name + ".kv";
+
+    // records: u16 key length, key, u32 value length, value
+    values.clear();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f != NULL) {
+        uint16_t key_len;
+        while (fread(&key_len, sizeof(key_len), 1, f) == 1) {
+            std::string key(key_len, '\0');
+            uint32_t value_len;
+            if (fread(&key[0], 1, key_len, f) != key_len || fread(&value_len, sizeof(value_len), 1, f) != 1) {
+                break;
+            }
+            std::vector<uint8_t> value(value_len);
+            if (value_len > 0 && fread(value.data(), 1, value_len, f) != value_len) {
+                break;
+            }
+            values[key] = value;
+        }
+        fclose(f);
+    }
+
+    opened = true;
+    read_only = read_only_in;
+    dirty = false;
+    return true;
+}
+
+// write to a temp file and rename, a crash never leaves half a namespace
+void KvStore::end() {
+    if (opened && dirty && !read_only) {
+        std::string temp = path + ".tmp";
+        FILE* f = fopen(temp.c_str(), "wb");
+        if (f != NULL) {
+            for (const auto& entry : values) {
+                uint16_t key_len = (uint16_t)entry.first.size();
+                uint32_t value_len = (uint32_t)entry.second.size();
+                fwrite(&key_len, sizeof(key_len), 1, f);
+                fwrite(entry.first.data(), 1, key_len, f);
+                fwrite(&value_len, sizeof(value_len), 1, f);
+                fwrite(entry.second.data(), 1, value_len, f);
+            }
+            if (fclose(f) == 0) {
+                rename(temp.c_str(), path.c_str());
+            }
+        }
+    }
+    opened = false;
+    dirty = false;
+    values.clear();
+}
+
+bool KvStore::isKey(const char* key) {
+    return values.count(key) > 0;
+}
+
+bool KvStore::remove(const char* key) {
+    if (read_only || values.erase(key) == 0) {
+        return false;
+    }
+    dirty = true;
+    return true;
+}
+
+bool KvStore::clear() {
+    if (read_only) {
+        return false;
+    }
+    values.clear();
+    dirty = true;
+    return true;
+}
+
+size_t KvStore::put(const char* key, const void* value, size_t len) {
+    if (!opened || read_only) {
+        return 0;
+    }
+    const uint8_t* bytes = (const uint8_t*)value;
+    values[key] = std::vector<uint8_t>(bytes, bytes + len);
+    dirty = true;
+    return len;
+}
+
+template <typename T>
+T KvStore::get(const char* key, T default_value) {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.size() != sizeof(T)) {
+        return default_value;
+    }
+    T value;
+    memcpy(&value, it->second.data(), sizeof(T));
+    return value;
+}
+
+bool KvStore::getBool(const char* key, bool default_value) { return get(key, default_value); }
+uint8_t KvStore::getUChar(const char* key, uint8_t default_value) { return get(key, default_value); }
+uint16_t KvStore::getUShort(const char* key, uint16_t default_value) { return get(key, default_value); }
+int32_t KvStore::getInt(const char* key, int32_t default_value) { return get(key, default_value); }
+uint32_t KvStore::getUInt(const char* key, uint32_t default_value) { return get(key, default_value); }
+uint64_t KvStore::getULong64(const char* key, uint64_t default_value) { return get(key, default_value); }
+float KvStore::getFloat(const char* key, float default_value) { return get(key, default_value); }
+double KvStore::getDouble(const char* key, double default_value) { return get(key, default_value); }
+
+String KvStore::getString(const char* key, const String& default_value) {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return default_value;
+    }
+    return String(std::string(it->second.begin(), it->second.end()));
+}
+
+size_t KvStore::getString(const char* key, char* value, size_t max_len) {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.size() + 1 > max_len) {
+        return 0;
+    }
+    memcpy(value, it->second.data(), it->second.size());
+    value[it->second.size()] = '\0';
+    return it->second.size() + 1;
+}
+
+size_t KvStore::getBytesLength(const char* key) {
+    auto it = values.find(key);
+    return it == values.end() ? 0 : it->second.size();
+}
+
+size_t KvStore::getBytes(const char* key, void* buf, size_t max_len) {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.size() > max_len) {
+        return 0;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+// ----- files -----
+
+PlatformFile::PlatformFile(FILE* f) : file(f, fclose) {
+}
+
+size_t PlatformFile::write(uint8_t c) {
+    return file ? fwrite(&c, 1, 1, file.get()) : 0;
+}
+
+size_t PlatformFile::write(const uint8_t* buf, size_t size) {
+    return file ? fwrite(buf, 1, size, file.get()) : 0;
+}
+
+// bytes left to read, like littlefs
+int PlatformFile::available() {
+    if (!file) {
+        return 0;
+    }
+    long pos = ftell(file.get());
+    fseek(file.get(), 0, SEEK_END);
+    long end = ftell(file.get());
+    fseek(file.get(), pos, SEEK_SET);
+    return pos < 0 || end < pos ? 0 : (int)(end - pos);
+}
+
+int PlatformFile::read() {
+    return file ? fgetc(file.get()) : -1;
+}
+
+size_t PlatformFile::read(uint8_t* buf, size_t size) {
+    return file ? fread(buf, 1, size, file.get()) : 0;
+}
+
+int PlatformFile::peek() {
+    if (!file) {
+        return -1;
+    }
+    int c = fgetc(file.get());
+    if (c != EOF) {
+        ungetc(c, file.get());
+    }
+    return c;
+}
+
+void PlatformFile::flush() {
+    if (file) {
+        fflush(file.get());
+    }
+}
+
+// littlefs paths ("/name") land in the key/value directory
+PlatformFile platform_file_open(const char* path, const char* mode) {
+    const char* dir = getenv(KV_DIR_ENV);
+    if (dir == NULL || dir[0] == '\0') {
+        dir = KV_DIR_DEFAULT;
+    }
+    mkdir(dir, 0755);
+
+    std::string full = std::string(dir) + (path[0] == '/' ? "" : "/") + path;
+    std::string stdio_mode = std::string(mode) + "b";
+    FILE* f = fopen(full.c_str(), stdio_mode.c_str());
+    return f != NULL ? PlatformFile(f) : PlatformFile();
+}
+
+// ----- tasks -----
+
+struct native_task_t {
+    pthread_t thread;
+    platform_task_fn_t fn;
+    void* arg;
+    char name[16];                      // pthread names are limited to 15 chars
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifications;
+    bool finished;                      // thread ended in platform_task_finish(), owner frees
+};
+
+static thread_local native_task_t* current_task = NULL;
+
+static void* task_entry(void* param) {
+    native_task_t* task = (native_task_t*)param;
+    current_task = task;
+    pthread_setname_np(pthread_self(), task->name);
+
+    task->fn(task->arg);
+
+    // returning from a task function is an error on freertos, tolerate it here
+    platform_task_exit();
+    return NULL;
+}
+
+bool platform_task_create(platform_task_fn_t fn, const char* name, uint32_t stack_size,
+                          void* arg, uint8_t priority, int core, platform_task_t* handle_out) {
+    native_task_t* task = new native_task_t;
+    task->fn = fn;
+    task->arg = arg;
+    task->notifications = 0;
+    task->finished = false;
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    task->name[sizeof(task->name) - 1] = '\0';
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    if (core >= 0 && core < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    // the handle is valid before the task runs, like xTaskCreate
+    if (handle_out != NULL) {
+        *handle_out = task;
+    }
+
+    int ret = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        if (handle_out != NULL) {
+            *handle_out = NULL;
+        }
+        delete task;
+        return false;
+    }
+    return true;
+}
+
+void platform_task_notify(platform_task_t task) {
+    if (task == NULL) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+    task->wake.notify_one();
+}
+
+void platform_task_wait() {
+    native_task_t* task = current_task;
+    if (task == NULL) {
+        return;
+    }
+    std::unique_lock<std::mutex> guard(task->lock);
+    task->wake.wait(guard, [task] { return task->notifications > 0; });
+    task->notifications = 0;
+}
+
+void platform_task_exit() {
+    native_task_t* task = current_task;
+    current_task = NULL;
+    delete task;
+    pthread_exit(NULL);
+}
+
+// the thread never touches the handle after marking it finished
+void platform_task_finish() {
+    native_task_t* task = current_task;
+    current_task = NULL;
+    if (task != NULL) {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->finished = true;
+    }
+    pthread_exit(NULL);
+}
+
+void platform_task_delete(platform_task_t task) {
+    if (task == NULL) {
+        return;
+    }
+    // detached threads can't be killed safely, a running task keeps its
+    // handle and ends whenever its loop next checks the stop flag
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        if (!task->finished) {
+            return;
+        }
+    }
+    delete task;
+}
+
+void platform_disable_core_watchdog(int core) {
+}
+
+int platform_core_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+// ----- network -----
+
+bool platform_network_connected() {
+    return true;
+}
+
+// first non-loopback interface, or a stable made-up address from the host name
+void platform_mac_address(uint8_t* mac) {
+    memset(mac, 0, 6);
+
+    struct ifaddrs* list;
+    if (getifaddrs(&list) == 0) {
+        for (struct ifaddrs* ifa = list; ifa != NULL; ifa = ifa->ifa_next) {
+            if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_PACKET) {
+                continue;
+            }
+            struct sockaddr_ll* ll = (struct sockaddr_ll*)ifa->ifa_addr;
+            if (ll->sll_halen != 6 || memcmp(ll->sll_addr, "\0\0\0\0\0\0", 6) == 0) {
+                continue;
+            }
+            memcpy(mac, ll->sll_addr, 6);
+            freeifaddrs(list);
+            return;
+        }
+        freeifaddrs(list);
+    }
+
+    char host[64] = "";
+    gethostname(host, sizeof(host) - 1);
+    uint32_t hash = 2166136261u;                    // fnv-1a
+    for (const char* p = host; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    mac[0] = 0x02;                                  // locally administered
+    memcpy(mac + 2, &hash, 4);
+}
+
+bool platform_resolve(const char* host, IPAddress& out) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0) {
+        return false;
+    }
+    out = IPAddress(((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(result);
+    return true;
+}
+
+// getaddrinfo blocks, so each lookup gets a short-lived thread
+bool platform_resolve_async(const char* host, platform_resolve_fn_t done, void* arg) {
+    try {
+        std::thread([host, done, arg] {
+            IPAddress ip;
+            done(platform_resolve(host, ip) ? (uint32_t)ip : 0, arg);
+        }).detach();
+    } catch (const std::system_error&) {
+        return false;
+    }
+    return true;
+}
+
+// ----- cycle counter -----
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint32_t platform_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)monotonic_ns();
+#endif
+}
+
+// the tsc rate is not exposed to user space, count it against the clock for 20 ms
+uint32_t platform_cycles_per_us() {
+#if defined(__x86_64__) || defined(__i386__)
+    static uint32_t rate = 0;
+    if (rate == 0) {
+        uint64_t start_ns = monotonic_ns();
+        uint64_t start = __rdtsc();
+        uint64_t elapsed_ns;
+        do {
+            elapsed_ns = monotonic_ns() - start_ns;
+        } while (elapsed_ns < 20000000ull);
+        uint64_t ticks = __rdtsc() - start;
+        rate = (uint32_t)((ticks * 1000 + elapsed_ns / 2) / elapsed_ns);
+        if (rate == 0) {
+            rate = 1;
+        }
+    }
+    return rate;
+#else
+    return 1000;
+#endif
+}
+
+// ----- system statistics -----
+
+// user + system time of every thread in clock ticks, the task names are the
+// thread names platform_task_create() set
+uint8_t platform_task_snapshot(platform_task_info_t* tasks, uint8_t max_tasks, uint32_t* elapsed) {
+    static long ticks_per_second = sysconf(_SC_CLK_TCK);
+    *elapsed = (uint32_t)(monotonic_ns() / (1000000000ull / ticks_per_second));
+
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == NULL) {
+        return 0;
+    }
+
+    uint8_t written = 0;
+    struct dirent* entry;
+    while (written < max_tasks && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/stat", entry->d_name);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            continue;   // thread ended meanwhile
+        }
+        char stat[512];
+        size_t len = fread(stat, 1, sizeof(stat) - 1, file);
+        fclose(file);
+        stat[len] = '\0';
+
+        // "tid (name) state ..." - the name may hold spaces and parentheses
+        char* open = strchr(stat, '(');
+        char* close = strrchr(stat, ')');
+        if (open == NULL || close == NULL || close < open) {
+            continue;
+        }
+        unsigned long utime = 0;
+        unsigned long stime = 0;
+        // fields after the name: state ppid pgrp session tty tpgid flags minflt cminflt majflt cmajflt utime stime
+        if (sscanf(close + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+            continue;
+        }
+
+        platform_task_info_t* task = &tasks[written++];
+        size_t name_len = close - open - 1;
+        if (name_len > sizeof(task->name) - 1) {
+            name_len = sizeof(task->name) - 1;
+        }
+        memcpy(task->name, open + 1, name_len);
+        task->name[name_len] = '\0';
+        task->id = (uint32_t)atol(entry->d_name);
+        task->runtime = (uint32_t)(utime + stime);
+        task->stack_free = 0;
+        task->priority = 0;
+
+        // pinned when the affinity mask holds a single core
+        cpu_set_t cpus;
+        task->core = -1;
+        if (sched_getaffinity((pid_t)task->id, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) == 1) {
+            for (int core = 0; core < CPU_SETSIZE; core++) {
+                if (CPU_ISSET(core, &cpus)) {
+                    task->core = (int8_t)core;
+                    break;
+                }
+            }
+        }
+    }
+    closedir(dir);
+    return written;
+}
+
+// glibc's arena numbers say little about headroom on a host with swap
+void platform_heap_snapshot(platform_heap_info_t* heap) {
+    memset(heap, 0, sizeof(*heap));
+}
+
+// millidegrees in sysfs, containers and vms often have no zone at all
+float platform_temperature() {
+    FILE* file = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
+    if (file == NULL) {
+        return NAN;
+    }
+    long millidegrees = 0;
+    int found = fscanf(file, "%ld", &millidegrees);
+    fclose(file);
+    return found == 1 ? millidegrees / 1000.0f : NAN;
+}
+
+// ----- hashing -----
+
+// mbedtls in software, a different implementation than the miner's own
+// software kernel, so the kernel cross-check still means something here
+void platform_sha256(const uint8_t* data, size_t len, uint8_t* output) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, data, len);
+    mbedtls_sha256_finish(&ctx, output);
+    mbedtls_sha256_free(&ctx);
+}
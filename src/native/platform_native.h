@@ -0,0 +1,148 @@
+// platform_native.h
+// linux side of the platform layer - posix sockets, a file-backed key/value
+// store and pthreads. included through platform/platform.h only
+
+#ifndef PLATFORM_NATIVE_H
+#define PLATFORM_NATIVE_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// socket shared by copies of a TcpClient, closed with the last copy (like WiFiClient)
+struct native_socket_t {
+    int fd;
+    explicit native_socket_t(int fd_in) : fd(fd_in) {}
+    ~native_socket_t();
+};
+
+class TcpClient : public Client {
+public:
+    TcpClient() : no_delay(false) {}
+    explicit TcpClient(int fd);
+
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char* host, uint16_t port);
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush() {}
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+    void setNoDelay(bool enabled);
+
+    using Print::write;
+
+private:
+    std::shared_ptr<native_socket_t> socket;
+    bool no_delay;
+
+    int fd() const { return socket ? socket->fd : -1; }
+};
+
+class TcpServer {
+public:
+    explicit TcpServer(uint16_t port = 0) : port(port), listen_fd(-1), pending_fd(-1), no_delay(false) {}
+    ~TcpServer() { end(); }
+
+    void begin(uint16_t port = 0);
+    void end();
+    void close() { end(); }
+    void stop() { end(); }
+    void setNoDelay(bool enabled) { no_delay = enabled; }
+
+    bool hasClient();
+    TcpClient available();              // next pending connection, an empty client if none
+
+private:
+    uint16_t port;
+    int listen_fd;
+    int pending_fd;                     // accepted by hasClient(), handed out by available()
+    bool no_delay;
+};
+
+// Preferences look-alike over one file per namespace
+// directory from $ESP32BTCMINER_KV_DIR, "./kv" by default. values are raw
+// bytes in host order, the file is rewritten by end() when something changed
+class KvStore {
+public:
+    KvStore() : opened(false), read_only(true), dirty(false) {}
+    ~KvStore() { end(); }
+
+    bool begin(const char* name, bool read_only = false);
+    void end();
+
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+    bool getBool(const char* key, bool default_value = false);
+    uint8_t getUChar(const char* key, uint8_t default_value = 0);
+    uint16_t getUShort(const char* key, uint16_t default_value = 0);
+    int32_t getInt(const char* key, int32_t default_value = 0);
+    uint32_t getUInt(const char* key, uint32_t default_value = 0);
+    uint64_t getULong64(const char* key, uint64_t default_value = 0);
+    float getFloat(const char* key, float default_value = 0);
+    double getDouble(const char* key, double default_value = 0);
+    String getString(const char* key, const String& default_value = String());
+    size_t getString(const char* key, char* value, size_t max_len);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t max_len);
+
+    size_t putBool(const char* key, bool value) { return put(key, &value, sizeof(value)); }
+    size_t putUChar(const char* key, uint8_t value) { return put(key, &value, sizeof(value)); }
+    size_t putUShort(const char* key, uint16_t value) { return put(key, &value, sizeof(value)); }
+    size_t putInt(const char* key, int32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putUInt(const char* key, uint32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putULong64(const char* key, uint64_t value) { return put(key, &value, sizeof(value)); }
+    size_t putFloat(const char* key, float value) { return put(key, &value, sizeof(value)); }
+    size_t putDouble(const char* key, double value) { return put(key, &value, sizeof(value)); }
+    size_t putString(const char* key, const char* value) { return put(key, value, strlen(value)); }
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+    size_t putBytes(const char* key, const void* value, size_t len) { return put(key, value, len); }
+
+private:
+    std::string path;
+    std::map<std::string, std::vector<uint8_t> > values;
+    bool opened;
+    bool read_only;
+    bool dirty;
+
+    size_t put(const char* key, const void* value, size_t len);
+    template <typename T> T get(const char* key, T default_value);
+};
+
+// fs::File look-alike over stdio, copies share the FILE like littlefs handles
+class PlatformFile : public Stream {
+public:
+    PlatformFile() {}
+    explicit PlatformFile(FILE* f);
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    size_t read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void close() { file.reset(); }
+    operator bool() const { return file != nullptr; }
+
+    using Print::write;
+
+private:
+    std::shared_ptr<FILE> file;
+};
+
+// task handle, freed when the task exits
+typedef struct native_task_t* platform_task_t;
+
+#endif
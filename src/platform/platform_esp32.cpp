@@ -0,0 +1,215 @@
+// platform_esp32.cpp
+// platform layer on arduino-esp32 and freertos
+
+#if !defined(PLATFORM_NATIVE)
+
+#include "platform/platform.h"
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include "mbedtls/sha256.h"  // esp32 hardware-accelerated sha256
+
+// ----- tasks -----
+
+bool platform_task_create(platform_task_fn_t fn, const char* name, uint32_t stack_size,
+                          void* arg, uint8_t priority, int core, platform_task_t* handle_out) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+        fn,
+        name,
+        stack_size,
+        arg,
+        priority,
+        handle_out,
+        core < 0 ? tskNO_AFFINITY : core
+    );
+    return result == pdPASS;
+}
+
+void platform_task_notify(platform_task_t task) {
+    xTaskNotifyGive(task);
+}
+
+void platform_task_wait() {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+void platform_task_exit() {
+    vTaskDelete(NULL);
+}
+
+// suspended for good, the owner's vTaskDelete() frees the tcb
+void platform_task_finish() {
+    for (;;) {
+        vTaskSuspend(NULL);
+    }
+}
+
+void platform_task_delete(platform_task_t task) {
+    vTaskDelete(task);
+}
+
+void platform_disable_core_watchdog(int core) {
+    if (core == 0) {
+        disableCore0WDT();
+    } else {
+        disableCore1WDT();
+    }
+}
+
+int platform_core_count() {
+    return portNUM_PROCESSORS;
+}
+
+// ----- network -----
+
+bool platform_network_connected() {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+void platform_mac_address(uint8_t* mac) {
+    WiFi.macAddress(mac);
+}
+
+bool platform_resolve(const char* host, IPAddress& out) {
+    return WiFi.hostByName(host, out) == 1;
+}
+
+// one lookup handed to the lwip thread
+struct resolve_request_t {
+    const char* host;
+    platform_resolve_fn_t done;
+    void* arg;
+};
+
+// lwip thread - query answered or timed out (addr NULL)
+static void resolve_done(const char* name, const ip_addr_t* addr, void* arg) {
+    resolve_request_t* request = (resolve_request_t*)arg;
+
+    uint32_t ip = 0;
+    if (addr != NULL && IP_IS_V4(addr)) {
+        ip = ip4_addr_get_u32(ip_2_ip4(addr));
+    }
+
+    request->done(ip, request->arg);
+    delete request;
+}
+
+// lwip thread - answered from lwip's own cache or sent as a query
+static void resolve_in_tcpip(void* arg) {
+    resolve_request_t* request = (resolve_request_t*)arg;
+    ip_addr_t addr;
+
+    err_t err = dns_gethostbyname(request->host, &addr, resolve_done, request);
+    if (err == ERR_OK) {
+        resolve_done(request->host, &addr, request);
+    } else if (err != ERR_INPROGRESS) {
+        resolve_done(request->host, NULL, request);
+    }
+}
+
+// dns_gethostbyname is not thread safe, the lookup runs in the lwip thread
+bool platform_resolve_async(const char* host, platform_resolve_fn_t done, void* arg) {
+    resolve_request_t* request = new resolve_request_t;
+    request->host = host;
+    request->done = done;
+    request->arg = arg;
+
+    if (tcpip_callback(resolve_in_tcpip, request) != ERR_OK) {
+        delete request;
+        return false;
+    }
+    return true;
+}
+
+// ----- files -----
+
+PlatformFile platform_file_open(const char* path, const char* mode) {
+    // true = format the partition if it doesn't mount, it only ever holds our files
+    static bool mounted = false;
+    if (!mounted) {
+        mounted = LittleFS.begin(true);
+        if (!mounted) {
+            return PlatformFile();
+        }
+    }
+    return LittleFS.open(path, mode);
+}
+
+// ----- cycle counter -----
+
+uint32_t platform_cycles() {
+    return ESP.getCycleCount();
+}
+
+uint32_t platform_cycles_per_us() {
+    return getCpuFrequencyMhz();
+}
+
+// ----- system statistics -----
+
+uint8_t platform_task_snapshot(platform_task_info_t* tasks, uint8_t max_tasks, uint32_t* elapsed) {
+    *elapsed = 0;
+#if configUSE_TRACE_FACILITY
+    // too big for the caller's stack, only the main loop takes snapshots
+    static TaskStatus_t status[PLATFORM_MAX_TASKS];
+
+    // fails (0) when there are more tasks than entries
+    // freertos before 10.4 (esp-idf 4) has no configRUN_TIME_COUNTER_TYPE, the counter is 32 bits there
+#if defined(configRUN_TIME_COUNTER_TYPE)
+    configRUN_TIME_COUNTER_TYPE total = 0;
+#else
+    uint32_t total = 0;
+#endif
+    UBaseType_t count = uxTaskGetSystemState(status, PLATFORM_MAX_TASKS, &total);
+    *elapsed = (uint32_t)total;
+
+    uint8_t written = 0;
+    for (UBaseType_t i = 0; i < count && written < max_tasks; i++) {
+        platform_task_info_t* task = &tasks[written++];
+        strncpy(task->name, status[i].pcTaskName, sizeof(task->name) - 1);
+        task->name[sizeof(task->name) - 1] = '\0';
+        task->id = status[i].xTaskNumber;
+        task->runtime = (uint32_t)status[i].ulRunTimeCounter;
+        task->stack_free = status[i].usStackHighWaterMark;     // bytes on esp-idf, not words
+        BaseType_t core = xTaskGetAffinity(status[i].xHandle);
+        task->core = core == tskNO_AFFINITY ? -1 : (int8_t)core;
+        task->priority = (uint8_t)status[i].uxCurrentPriority;
+    }
+    return written;
+#else
+    return 0;
+#endif
+}
+
+void platform_heap_snapshot(platform_heap_info_t* heap) {
+    heap->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    heap->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    heap->internal_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap->psram_size = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    heap->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    heap->psram_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+}
+
+float platform_temperature() {
+    return temperatureRead();
+}
+
+// ----- hashing -----
+
+// mbedtls on the esp32 routes sha256 to the hardware peripheral
+void platform_sha256(const uint8_t* data, size_t len, uint8_t* output) {
+    // context structure holds internal sha256 computation state
+    // mbedtls uses this pattern: init -> starts -> update -> finish -> free
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+
+    // second parameter: 0 = sha256, 1 = sha224
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, data, len);
+    mbedtls_sha256_finish(&ctx, output);
+    mbedtls_sha256_free(&ctx);
+}
+
+#endif
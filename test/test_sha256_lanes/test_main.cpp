@@ -0,0 +1,267 @@
+// test_main.cpp
+// multi-lane nonce scanner against scalar sha256d, bit for bit
+//
+//   pio test -e native -f test_sha256_lanes
+//
+// every isa this cpu has (sse2, avx2, avx512) hashes random headers at random
+// nonces, each lane's full 32-byte sha256d and top word must equal the scalar
+// one. then mine_nonce_range runs on every isa and on the scalar path over the
+// same ranges with an easy target, the early reject may never change the hit,
+// the nonce, the hash count or the best share. isas the cpu lacks are ignored
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "mining/sha256_miner.h"
+#include "mining/sha256_lanes.h"
+
+// random headers hashed per isa, lane for lane
+#define LANES_RANDOM_HEADERS 512
+
+// mine_nonce_range calls compared per isa
+#define MINE_RANGES 64
+
+// fixed seed, a failure reproduces on every run
+#define TEST_SEED 0x9E3779B97F4A7C15ULL
+
+static uint64_t rng_state;
+
+// xorshift64, deterministic and good enough for header bytes
+static uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static void random_header(uint8_t* header) {
+    for (int i = 0; i < 80; i += 4) {
+        uint32_t word = next_random();
+        memcpy(header + i, &word, 4);
+    }
+}
+
+static void set_nonce(uint8_t* header, uint32_t nonce) {
+    header[76] = nonce & 0xFF;
+    header[77] = (nonce >> 8) & 0xFF;
+    header[78] = (nonce >> 16) & 0xFF;
+    header[79] = (nonce >> 24) & 0xFF;
+}
+
+// most significant word of a little-endian hash, what best_share_t::top_word holds
+static uint32_t top_word_of(const uint8_t* hash) {
+    return ((uint32_t)hash[31] << 24) | ((uint32_t)hash[30] << 16) |
+           ((uint32_t)hash[29] << 8) | hash[28];
+}
+
+// cpuid alone, without the ESP32BTCMINER_LANES cap of sha256_lanes_detect
+static bool cpu_has(sha256_lanes_isa_t isa) {
+    __builtin_cpu_init();
+    switch (isa) {
+        case sha256_lanes_isa_t::SSE2: return __builtin_cpu_supports("sse2");
+        case sha256_lanes_isa_t::AVX2: return __builtin_cpu_supports("avx2");
+        case sha256_lanes_isa_t::AVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+}
+
+// first nonce of a scan call, the first few wrap past 0xFFFFFFFF mid-call
+static uint32_t pick_first_nonce(int round, uint8_t lanes) {
+    if (round < lanes) {
+        return 0xFFFFFFFF - round;
+    }
+    return next_random();
+}
+
+static void check_lanes_against_sha256d(sha256_lanes_isa_t isa) {
+    if (!cpu_has(isa)) {
+        TEST_IGNORE_MESSAGE("isa not supported by this cpu");
+    }
+
+    uint8_t lanes = sha256_lanes_count(isa);
+    uint8_t header[80];
+    uint32_t midstate[8];
+    uint32_t tail[3];
+    uint32_t top_full[SHA256_LANES_MAX];
+    uint32_t top_scan[SHA256_LANES_MAX];
+    uint8_t hashes[SHA256_LANES_MAX][32];
+    uint8_t expected[32];
+    char msg[64];
+
+    rng_state = TEST_SEED;
+
+    for (int round = 0; round < LANES_RANDOM_HEADERS; round++) {
+        random_header(header);
+        uint32_t first_nonce = pick_first_nonce(round, lanes);
+
+        sha256_lanes_prepare(header, midstate, tail);
+        sha256_lanes_hash(isa, midstate, tail, first_nonce, top_full, hashes);
+        sha256_lanes_scan(isa, midstate, tail, first_nonce, top_scan);
+
+        for (uint8_t lane = 0; lane < lanes; lane++) {
+            uint32_t nonce = first_nonce + lane;
+            set_nonce(header, nonce);
+            sha256d(header, 80, expected);
+
+            snprintf(msg, sizeof(msg), "%s round %d lane %u nonce %08x",
+                     sha256_lanes_name(isa), round, lane, (unsigned)nonce);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, hashes[lane], 32, msg);
+            TEST_ASSERT_EQUAL_HEX32_MESSAGE(top_word_of(expected), top_full[lane], msg);
+            TEST_ASSERT_EQUAL_HEX32_MESSAGE(top_word_of(expected), top_scan[lane], msg);
+        }
+    }
+}
+
+// what mine_nonce_range has to return, one scalar sha256d per nonce
+static bool reference_range(uint8_t* header, uint32_t start_nonce, uint32_t nonce_count,
+                            const uint8_t* target, uint32_t* found_nonce,
+                            uint32_t* hashes_done, best_share_t* best) {
+    uint8_t hash[32];
+    *hashes_done = 0;
+
+    for (uint32_t i = 0; i < nonce_count; i++) {
+        uint32_t nonce = start_nonce + i;
+        set_nonce(header, nonce);
+        sha256d(header, 80, hash);
+
+        if (hash_below_target(hash, best->hash)) {
+            best->top_word = top_word_of(hash);
+            memcpy(best->hash, hash, 32);
+            best->nonce = nonce;
+            best->improved = true;
+        }
+
+        if (hash_below_target(hash, target)) {
+            *found_nonce = nonce;
+            *hashes_done = i + 1;
+            return true;
+        }
+    }
+
+    *hashes_done = nonce_count;
+    return false;
+}
+
+// share target for one range, mostly about 1 hit in 512 nonces. every fourth
+// range uses its own lowest hash as target, that nonce is the only hit, its
+// top word ties and only the full compare after the early reject decides
+static void pick_target(int round, uint8_t* header, uint32_t start_nonce,
+                        uint32_t nonce_count, uint8_t* target) {
+    if (round % 4 == 3) {
+        uint8_t hash[32];
+        memset(target, 0xFF, 32);
+        for (uint32_t i = 0; i < nonce_count; i++) {
+            set_nonce(header, start_nonce + i);
+            sha256d(header, 80, hash);
+            if (hash_below_target(hash, target)) {
+                memcpy(target, hash, 32);
+            }
+        }
+        return;
+    }
+    memset(target, 0xFF, 32);
+    target[31] = 0x00;
+    target[30] = 0x7F;
+}
+
+static void check_mine_nonce_range(sha256_lanes_isa_t isa) {
+    if (!cpu_has(isa)) {
+        TEST_IGNORE_MESSAGE("isa not supported by this cpu");
+    }
+
+    // miner_init re-reads the cap and self-tests the kernel it picks
+    const char* name = isa == sha256_lanes_isa_t::NONE ? "off" : sha256_lanes_name(isa);
+    setenv("ESP32BTCMINER_LANES", name, 1);
+    miner_init();
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)isa, (uint8_t)sha256_lanes_detect());
+
+    uint8_t header[80];
+    uint8_t target[32];
+    best_share_t best;
+    best_share_t expected_best;
+    char msg[64];
+    int hits = 0;
+
+    rng_state = TEST_SEED;
+    best_share_init(&best);
+    best_share_init(&expected_best);
+
+    for (int round = 0; round < MINE_RANGES; round++) {
+        random_header(header);
+        // uneven lengths leave a partial last call on every lane count
+        uint32_t nonce_count = 500 + next_random() % 61;
+        uint32_t start_nonce = round < 4 ? 0xFFFFFFFF - round * 7 - 100 : next_random();
+        pick_target(round, header, start_nonce, nonce_count, target);
+
+        // a fresh best now and then, otherwise it carries over like a job does.
+        // a tied target also becomes the best so far, else a worse best would
+        // lift the reject threshold above the tie
+        if (round % 8 == 0) {
+            best_share_init(&best);
+            best_share_init(&expected_best);
+        }
+        if (round % 4 == 3) {
+            best.top_word = top_word_of(target);
+            memcpy(best.hash, target, 32);
+            best.nonce = 0;
+            expected_best = best;
+        }
+        best.improved = false;
+        expected_best.improved = false;
+
+        uint8_t work[80];
+        memcpy(work, header, 80);
+        uint32_t found = 0, done = 0;
+        bool hit = mine_nonce_range(work, start_nonce, nonce_count, target, &found, &done, &best);
+
+        uint32_t expected_found = 0, expected_done = 0;
+        bool expected_hit = reference_range(header, start_nonce, nonce_count, target,
+                                            &expected_found, &expected_done, &expected_best);
+
+        snprintf(msg, sizeof(msg), "%s round %d start %08x count %u",
+                 name, round, (unsigned)start_nonce, (unsigned)nonce_count);
+        TEST_ASSERT_EQUAL_MESSAGE(expected_hit, hit, msg);
+        if (expected_hit) {
+            TEST_ASSERT_EQUAL_HEX32_MESSAGE(expected_found, found, msg);
+            hits++;
+        }
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected_done, done, msg);
+        TEST_ASSERT_EQUAL_MESSAGE(expected_best.improved, best.improved, msg);
+        TEST_ASSERT_EQUAL_HEX32_MESSAGE(expected_best.nonce, best.nonce, msg);
+        TEST_ASSERT_EQUAL_HEX32_MESSAGE(expected_best.top_word, best.top_word, msg);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected_best.hash, best.hash, 32, msg);
+    }
+
+    // both outcomes must have been exercised, or the ranges prove nothing
+    TEST_ASSERT_GREATER_THAN_INT(0, hits);
+    TEST_ASSERT_LESS_THAN_INT(MINE_RANGES, hits);
+}
+
+static void test_lanes_sse2() { check_lanes_against_sha256d(sha256_lanes_isa_t::SSE2); }
+static void test_lanes_avx2() { check_lanes_against_sha256d(sha256_lanes_isa_t::AVX2); }
+static void test_lanes_avx512() { check_lanes_against_sha256d(sha256_lanes_isa_t::AVX512); }
+
+static void test_mine_scalar() { check_mine_nonce_range(sha256_lanes_isa_t::NONE); }
+static void test_mine_sse2() { check_mine_nonce_range(sha256_lanes_isa_t::SSE2); }
+static void test_mine_avx2() { check_mine_nonce_range(sha256_lanes_isa_t::AVX2); }
+static void test_mine_avx512() { check_mine_nonce_range(sha256_lanes_isa_t::AVX512); }
+
+void setUp() {}
+
+void tearDown() {
+    unsetenv("ESP32BTCMINER_LANES");
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lanes_sse2);
+    RUN_TEST(test_lanes_avx2);
+    RUN_TEST(test_lanes_avx512);
+    RUN_TEST(test_mine_scalar);
+    RUN_TEST(test_mine_sse2);
+    RUN_TEST(test_mine_avx2);
+    RUN_TEST(test_mine_avx512);
+    return UNITY_END();
+}
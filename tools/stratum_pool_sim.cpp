@@ -0,0 +1,1266 @@
+// stratum_pool_sim.cpp
+// scriptable stratum v1 pool simulator for end-to-end tests of StratumClient
+//
+// hands out jobs built like a real pool's (bip34 height, payout output,
+// optional witness commitment, merkle branches) at a set rate, varies
+// clean_jobs, difficulty and extranonce sizes, and can delay every line it
+// sends, drop connections and slip malformed lines in between. every submitted
+// share is rebuilt from its job and checked with sha256d, so the counts are
+// what a real pool would credit:
+//   accepted    meets the share difficulty
+//   stale       job was replaced by a clean_jobs notify before the share came in
+//   duplicate   same job, extranonce2, ntime and nonce sent twice
+//   invalid     unknown job, wrong extranonce2 size, ntime out of range or low difficulty
+// submit latency is measured from the notify of the share's job to the submit,
+// stale latency from the clean notify that retired the job to the stale submit
+//
+// the defaults fit StratumClient's buffers (1 KB lines, 128 hex chars of
+// coinbase2). --witness --max-branches 12 sends mainnet-sized jobs that don't
+// fit, useful to see how the client copes
+//
+// build and run on any posix host:
+//   g++ -O2 -o stratum_pool_sim tools/stratum_pool_sim.cpp
+//   ./stratum_pool_sim --port 3333 --diff 0.001 --job-interval 10000 --duration 300
+// then point the miner (or the native daemon) at "<host ip>:3333"
+//
+// a script file adds timed events, one per line, seconds since start:
+//   # seconds  event     [argument]
+//   30         diff      0.01
+//   45         latency   250
+//   60         drop
+//   75         block
+//   80         malformed
+//   90         job
+//   120        quit
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#define DEFAULT_PORT 3333
+#define DEFAULT_DIFFICULTY 0.001        // ~1 share per 4.3M hashes
+#define DEFAULT_JOB_INTERVAL_MS 30000
+#define DEFAULT_CLEAN_EVERY 4           // every 4th job starts a new block
+#define DEFAULT_MAX_BRANCHES 6          // keeps a notify under 1 KB without --witness
+#define DEFAULT_NBITS 0x1703a30c
+#define DEFAULT_REPORT_SECONDS 10
+#define MAX_CLIENTS 64
+#define MAX_JOBS 16                     // jobs kept for share checks
+#define MAX_SESSIONS 64                 // subscriptions remembered for resumption
+#define MAX_LINE 4096                   // longest request accepted from a miner
+#define NTIME_MAX_AHEAD 7200            // seconds a share's ntime may run ahead of the clock
+
+// ---- sha256 (fips 180-4), just enough to verify submitted shares ----
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void sha256_block(uint32_t* h, const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+static void sha256(const uint8_t* data, size_t len, uint8_t* out) {
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t block[64];
+    size_t pos = 0;
+
+    for (; pos + 64 <= len; pos += 64) {
+        sha256_block(h, data + pos);
+    }
+
+    size_t rest = len - pos;
+    memset(block, 0, 64);
+    memcpy(block, data + pos, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) {
+        sha256_block(h, block);
+        memset(block, 0, 64);
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        block[63 - i] = (bits >> (8 * i)) & 0xFF;
+    }
+    sha256_block(h, block);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = h[i] >> 24;
+        out[i * 4 + 1] = h[i] >> 16;
+        out[i * 4 + 2] = h[i] >> 8;
+        out[i * 4 + 3] = h[i];
+    }
+}
+
+static void sha256d(const uint8_t* data, size_t len, uint8_t* out) {
+    uint8_t first[32];
+    sha256(data, len, first);
+    sha256(first, 32, out);
+}
+
+// ---- hex and little-endian fields ----
+
+static void put_u32(uint8_t* out, uint32_t v) { for (int i = 0; i < 4; i++) out[i] = v >> (8 * i); }
+
+static std::string to_hex(const uint8_t* bytes, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < len; i++) {
+        hex += digits[bytes[i] >> 4];
+        hex += digits[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+static std::string le_hex(uint64_t v, int bytes) {
+    uint8_t b[8];
+    for (int i = 0; i < bytes; i++) {
+        b[i] = v >> (8 * i);
+    }
+    return to_hex(b, bytes);
+}
+
+// false on odd length or a non-hex digit
+static bool from_hex(const std::string& hex, std::vector<uint8_t>& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int v = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = hex[i + j];
+            int d = (c >= '0' && c <= '9') ? c - '0' :
+                    (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                    (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (d < 0) {
+                return false;
+            }
+            v = v * 16 + d;
+        }
+        out.push_back(v);
+    }
+    return true;
+}
+
+// share difficulty of a little-endian hash, diff1 target = 0xffff * 2^208
+static double hash_difficulty(const uint8_t* hash) {
+    double value = 0.0;
+    for (int i = 31; i >= 0; i--) {
+        value = value * 256.0 + hash[i];
+    }
+    return value == 0.0 ? 1.0e300 : ldexp(65535.0, 208) / value;
+}
+
+// hash <= block target decoded from nbits, both little-endian
+static bool meets_nbits(const uint8_t* hash, uint32_t nbits) {
+    uint8_t target[32];
+    memset(target, 0, 32);
+    int exponent = nbits >> 24;
+    for (int i = 0; i < 3; i++) {
+        int pos = exponent - 3 + i;
+        if (pos >= 0 && pos < 32) {
+            target[pos] = (nbits >> (8 * i)) & 0xFF;
+        }
+    }
+    for (int i = 31; i >= 0; i--) {
+        if (hash[i] != target[i]) {
+            return hash[i] < target[i];
+        }
+    }
+    return true;
+}
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void random_bytes(uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = rand() & 0xFF;
+    }
+}
+
+static double random_unit() {
+    return rand() / ((double)RAND_MAX + 1.0);
+}
+
+// ---- configuration ----
+
+struct config_t {
+    int port;
+    double difficulty;
+    std::vector<double> difficulties;   // picked at random every diff_interval
+    int diff_interval;                  // seconds, 0 = fixed
+    int job_interval_ms;
+    int clean_every;
+    double clean_rate;
+    std::vector<int> en1_sizes;         // one picked per new session
+    std::vector<int> en2_sizes;
+    int max_branches;
+    bool witness;
+    uint32_t nbits;
+    int latency_ms;
+    int jitter_ms;
+    int drop_every;                     // seconds, 0 = never
+    double malformed_rate;
+    bool resume;
+    const char* script;
+    int duration;                       // seconds, 0 = until ctrl-c
+    int report_seconds;
+    bool strict;
+    unsigned seed;
+};
+
+static config_t config;
+
+// ---- jobs ----
+
+struct job_t {
+    uint32_t id;
+    bool clean;
+    uint32_t height;
+    uint8_t prev_hash[32];              // header order
+    std::vector<std::vector<uint8_t> > branches;
+    uint8_t commitment[32];             // witness commitment, with --witness
+    uint32_t version;
+    uint32_t ntime;
+    std::set<std::string> submitted;    // duplicate check
+};
+
+static job_t jobs[MAX_JOBS];
+static uint32_t next_job_id = 1;
+static uint32_t first_live_job = 1;     // older jobs were retired by a clean notify
+static uint32_t block_height = 840000;
+static uint8_t payout_hash[20];
+
+static job_t* find_job(uint32_t id) {
+    job_t* job = &jobs[id % MAX_JOBS];
+    return (id != 0 && job->id == id) ? job : NULL;
+}
+
+// coinbase split around extranonce1 + extranonce2, the scriptsig length
+// depends on the extranonce sizes so each session gets its own coinbase1
+static void coinbase_parts(const job_t* job, int extranonce_len, std::string& cb1, std::string& cb2) {
+    static const char tag[] = "/pool-sim/";
+    int tag_len = sizeof(tag) - 1;
+    int script_len = 4 + 1 + tag_len + extranonce_len;
+
+    cb1 = "01000000" "01";                      // version, one input
+    cb1 += std::string(64, '0') + "ffffffff";   // null prevout
+    cb1 += le_hex(script_len, 1);
+    cb1 += "03" + le_hex(job->height, 3);       // bip34 height push
+    cb1 += le_hex(tag_len, 1) + to_hex((const uint8_t*)tag, tag_len);
+
+    cb2 = "ffffffff";                           // sequence
+    cb2 += config.witness ? "02" : "01";
+    cb2 += le_hex(312500000ULL + job->height % 1000 * 1000, 8);
+    cb2 += "160014" + to_hex(payout_hash, 20);  // p2wpkh payout
+    if (config.witness) {
+        cb2 += le_hex(0, 8) + "266a24aa21a9ed" + to_hex(job->commitment, 32);
+    }
+    cb2 += "00000000";                          // locktime
+}
+
+static void build_job(bool clean) {
+    job_t* job = &jobs[next_job_id % MAX_JOBS];
+    job->id = next_job_id++;
+    job->clean = clean;
+    job->submitted.clear();
+
+    if (clean) {
+        // new block: fresh tip, older jobs are stale from here on
+        first_live_job = job->id;
+        block_height++;
+        random_bytes(job->prev_hash, 32);
+        memset(job->prev_hash + 24, 0, 8);      // leading zeros of a real block hash
+
+        int count = config.max_branches > 0 ? rand() % (config.max_branches + 1) : 0;
+        job->branches.assign(count, std::vector<uint8_t>(32));
+        for (int i = 0; i < count; i++) {
+            random_bytes(job->branches[i].data(), 32);
+        }
+    } else {
+        // same tip, new transactions: first branch changes
+        const job_t* prev = find_job(job->id - 1);
+        if (prev != NULL) {
+            memcpy(job->prev_hash, prev->prev_hash, 32);
+            job->branches = prev->branches;
+        }
+        if (!job->branches.empty()) {
+            random_bytes(job->branches[0].data(), 32);
+        }
+    }
+
+    job->height = block_height;
+    random_bytes(job->commitment, 32);
+    job->version = 0x20000000;
+    job->ntime = (uint32_t)time(NULL);
+}
+
+// ---- sessions and clients ----
+
+struct session_t {
+    char id[17];
+    uint8_t extranonce1[8];
+    int extranonce1_len;
+    int extranonce2_len;
+};
+
+struct out_line_t {
+    uint64_t due_us;
+    std::string line;
+    uint32_t job_id;                    // notify of this job, 0 for other lines
+    bool clean;
+};
+
+struct client_t {
+    int fd;
+    session_t session;
+    bool subscribed;
+    bool authorized;
+    double difficulty;
+    double prev_difficulty;             // still accepted on jobs sent before the change
+    uint64_t diff_changed_us;
+    uint64_t connected_us;
+    uint64_t drop_at_us;                // 0 = never
+    uint64_t notify_us[MAX_JOBS];       // when each job's notify went out to this client
+    uint32_t notify_job[MAX_JOBS];
+    uint64_t clean_us;                  // last clean notify sent
+    std::string recv;
+    std::deque<out_line_t> out;         // lines waiting for their injected delay
+};
+
+static client_t* clients[MAX_CLIENTS];
+static session_t sessions[MAX_SESSIONS];
+static uint32_t next_session = 0;
+
+// ---- statistics ----
+
+struct stats_t {
+    uint32_t accepted;
+    uint32_t stale;
+    uint32_t duplicate;
+    uint32_t invalid_job;
+    uint32_t invalid_extranonce;
+    uint32_t invalid_ntime;
+    uint32_t low_difficulty;
+    uint32_t blocks;
+    uint32_t bad_requests;              // lines that were not json-rpc we understand
+    uint32_t connections;
+    uint32_t resumed;
+    uint32_t drops;
+    uint32_t malformed_sent;
+    uint32_t jobs;
+    double accepted_difficulty;
+    std::vector<uint32_t> submit_latency_ms;
+    std::vector<uint32_t> stale_latency_ms;
+};
+
+static stats_t stats;
+static uint64_t start_us;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int signal) {
+    stop_requested = 1;
+}
+
+static uint32_t invalid_count() {
+    return stats.invalid_job + stats.invalid_extranonce + stats.invalid_ntime + stats.low_difficulty;
+}
+
+// ---- output with injected latency ----
+
+static void queue_line(client_t* client, const std::string& line, uint32_t job_id = 0, bool clean = false) {
+    uint64_t due = now_us() + (uint64_t)config.latency_ms * 1000;
+    if (config.jitter_ms > 0) {
+        due += (uint64_t)(rand() % (config.jitter_ms + 1)) * 1000;
+    }
+    // jitter never reorders, tcp would not either
+    if (!client->out.empty() && due < client->out.back().due_us) {
+        due = client->out.back().due_us;
+    }
+    out_line_t out = {due, line + "\n", job_id, clean};
+    client->out.push_back(out);
+}
+
+// write what is due, false if the connection is gone
+static bool flush_client(client_t* client, uint64_t now) {
+    while (!client->out.empty() && client->out.front().due_us <= now) {
+        const out_line_t& out = client->out.front();
+        if (send(client->fd, out.line.data(), out.line.size(), MSG_NOSIGNAL) != (ssize_t)out.line.size()) {
+            return false;
+        }
+
+        // notify timestamps count from when the line actually left
+        if (out.job_id != 0) {
+            client->notify_job[out.job_id % MAX_JOBS] = out.job_id;
+            client->notify_us[out.job_id % MAX_JOBS] = now;
+            if (out.clean) {
+                client->clean_us = now;
+            }
+        }
+        client->out.pop_front();
+    }
+    return true;
+}
+
+static void send_difficulty(client_t* client) {
+    char line[128];
+    snprintf(line, sizeof(line), "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.10g]}",
+             client->difficulty);
+    queue_line(client, line);
+}
+
+// malformed lines a pool or a broken proxy might produce
+static void send_malformed(client_t* client) {
+    static const char* lines[] = {
+        "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"",
+        "this is not json",
+        "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"1\"]}",
+        "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[]}",
+        "{\"id\":null,\"method\":\"client.show_message\",\"params\":[\"pool-sim\"]}",
+        "{\"id\":null,\"method\":\"mining.unknown\",\"params\":[1,2,3]}",
+        "[1,2,3]",
+    };
+    int count = sizeof(lines) / sizeof(lines[0]);
+    int pick = rand() % (count + 1);
+
+    if (pick == count) {
+        // longer than any sane line buffer
+        queue_line(client, "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"" + std::string(3000, 'f') + "\"]}");
+    } else {
+        queue_line(client, lines[pick]);
+    }
+    stats.malformed_sent++;
+}
+
+static void send_notify(client_t* client, const job_t* job, bool clean) {
+    if (config.malformed_rate > 0 && random_unit() < config.malformed_rate) {
+        send_malformed(client);
+    }
+
+    std::string cb1, cb2;
+    coinbase_parts(job, client->session.extranonce1_len + client->session.extranonce2_len, cb1, cb2);
+
+    // stratum sends the previous hash as 8 words with the bytes of each word reversed
+    uint8_t prev[32];
+    for (int i = 0; i < 32; i++) {
+        prev[i] = job->prev_hash[(i & ~3) + 3 - (i & 3)];
+    }
+
+    char head[64];
+    snprintf(head, sizeof(head), "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"%x\",\"", job->id);
+    std::string line = head;
+    line += to_hex(prev, 32) + "\",\"" + cb1 + "\",\"" + cb2 + "\",[";
+    for (size_t i = 0; i < job->branches.size(); i++) {
+        line += (i > 0 ? ",\"" : "\"") + to_hex(job->branches[i].data(), 32) + "\"";
+    }
+
+    char tail[96];
+    snprintf(tail, sizeof(tail), "],\"%08x\",\"%08x\",\"%08x\",%s]}",
+             job->version, config.nbits, job->ntime, clean ? "true" : "false");
+    line += tail;
+
+    queue_line(client, line, job->id, clean);
+}
+
+static void broadcast_job(bool clean) {
+    build_job(clean);
+    stats.jobs++;
+    const job_t* job = find_job(next_job_id - 1);
+
+    printf("job %x%s, %zu branches\n", job->id, clean ? " (clean, new block)" : "", job->branches.size());
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] != NULL && clients[i]->authorized) {
+            send_notify(clients[i], job, clean);
+        }
+    }
+}
+
+static void broadcast_difficulty(double difficulty) {
+    printf("difficulty %.10g\n", difficulty);
+    config.difficulty = difficulty;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t* client = clients[i];
+        if (client != NULL && client->subscribed) {
+            client->prev_difficulty = client->difficulty;
+            client->difficulty = difficulty;
+            client->diff_changed_us = now_us();
+            send_difficulty(client);
+        }
+    }
+}
+
+// ---- requests ----
+
+// value of "key": in a flat json object, raw (strings keep their quotes)
+static bool json_field(const std::string& line, const char* key, std::string& out) {
+    std::string pattern = std::string("\"") + key + "\"";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = line.find(':', pos + pattern.size());
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos++;
+    while (pos < line.size() && line[pos] == ' ') {
+        pos++;
+    }
+
+    // up to the matching bracket for arrays, the next , or } otherwise
+    size_t end = pos;
+    if (pos < line.size() && line[pos] == '[') {
+        int depth = 0;
+        bool in_string = false;
+        for (; end < line.size(); end++) {
+            char c = line[end];
+            if (in_string) {
+                if (c == '\\') end++;
+                else if (c == '"') in_string = false;
+            } else if (c == '"') {
+                in_string = true;
+            } else if (c == '[') {
+                depth++;
+            } else if (c == ']' && --depth == 0) {
+                end++;
+                break;
+            }
+        }
+    } else if (pos < line.size() && line[pos] == '"') {
+        end = line.find('"', pos + 1);
+        end = end == std::string::npos ? line.size() : end + 1;
+    } else {
+        while (end < line.size() && line[end] != ',' && line[end] != '}') {
+            end++;
+        }
+    }
+    out = line.substr(pos, end - pos);
+    return true;
+}
+
+// string elements of a json array (other element types are skipped)
+static std::vector<std::string> json_strings(const std::string& array) {
+    std::vector<std::string> items;
+    size_t pos = 0;
+    while ((pos = array.find('"', pos)) != std::string::npos) {
+        size_t end = array.find('"', pos + 1);
+        if (end == std::string::npos) {
+            break;
+        }
+        items.push_back(array.substr(pos + 1, end - pos - 1));
+        pos = end + 1;
+    }
+    return items;
+}
+
+static void reply(client_t* client, const std::string& id, const char* result, int error_code, const char* error) {
+    char line[256];
+    if (error != NULL) {
+        snprintf(line, sizeof(line), "{\"id\":%s,\"result\":null,\"error\":[%d,\"%s\",null]}",
+                 id.c_str(), error_code, error);
+    } else {
+        snprintf(line, sizeof(line), "{\"id\":%s,\"result\":%s,\"error\":null}", id.c_str(), result);
+    }
+    queue_line(client, line);
+}
+
+static void handle_subscribe(client_t* client, const std::string& id, const std::vector<std::string>& params) {
+    // resumption: a known subscription id gets its extranonce1 back
+    const session_t* resumed = NULL;
+    if (config.resume && params.size() >= 2) {
+        for (int i = 0; i < MAX_SESSIONS; i++) {
+            if (sessions[i].id[0] != '\0' && params[1] == sessions[i].id) {
+                resumed = &sessions[i];
+            }
+        }
+    }
+
+    if (resumed != NULL) {
+        client->session = *resumed;
+        stats.resumed++;
+    } else {
+        session_t* s = &client->session;
+        snprintf(s->id, sizeof(s->id), "%08x%08x", (unsigned)rand(), next_session);
+        s->extranonce1_len = config.en1_sizes[rand() % config.en1_sizes.size()];
+        s->extranonce2_len = config.en2_sizes[rand() % config.en2_sizes.size()];
+        random_bytes(s->extranonce1, s->extranonce1_len);
+        sessions[next_session++ % MAX_SESSIONS] = *s;
+    }
+    client->subscribed = true;
+
+    char result[256];
+    snprintf(result, sizeof(result), "[[[\"mining.set_difficulty\",\"%s\"],[\"mining.notify\",\"%s\"]],\"%s\",%d]",
+             client->session.id, client->session.id,
+             to_hex(client->session.extranonce1, client->session.extranonce1_len).c_str(),
+             client->session.extranonce2_len);
+    reply(client, id, result, 0, NULL);
+
+    printf("subscribe %s: extranonce1 %d bytes, extranonce2 %d bytes%s\n", client->session.id,
+           client->session.extranonce1_len, client->session.extranonce2_len, resumed ? " (resumed)" : "");
+}
+
+static void handle_authorize(client_t* client, const std::string& id, const std::vector<std::string>& params) {
+    if (!client->subscribed) {
+        reply(client, id, NULL, 25, "Not subscribed");
+        return;
+    }
+
+    client->authorized = true;
+    reply(client, id, "true", 0, NULL);
+    printf("authorize %s\n", params.empty() ? "?" : params[0].c_str());
+
+    // difficulty first, then the current job as clean work
+    send_difficulty(client);
+    const job_t* job = find_job(next_job_id - 1);
+    if (job != NULL) {
+        send_notify(client, job, true);
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+// mining.submit: [worker, job_id, extranonce2, ntime, nonce]
+static void handle_submit(client_t* client, const std::string& id, const std::vector<std::string>& params) {
+    uint64_t now = now_us();
+
+    if (!client->authorized) {
+        reply(client, id, NULL, 24, "Unauthorized worker");
+        return;
+    }
+    if (params.size() < 5) {
+        stats.bad_requests++;
+        reply(client, id, NULL, 20, "Missing parameters");
+        return;
+    }
+
+    uint32_t job_id = strtoul(params[1].c_str(), NULL, 16);
+    job_t* job = find_job(job_id);
+    std::vector<uint8_t> extranonce2;
+    uint32_t ntime = strtoul(params[3].c_str(), NULL, 16);
+    uint32_t nonce = strtoul(params[4].c_str(), NULL, 16);
+
+    if (job == NULL) {
+        stats.invalid_job++;
+        reply(client, id, NULL, 21, "Job not found");
+        printf("share job %s: unknown job\n", params[1].c_str());
+        return;
+    }
+
+    if (job_id < first_live_job) {
+        stats.stale++;
+        if (client->clean_us != 0) {
+            stats.stale_latency_ms.push_back((now - client->clean_us) / 1000);
+        }
+        reply(client, id, NULL, 21, "Stale");
+        printf("share job %x: stale\n", job_id);
+        return;
+    }
+
+    if (!from_hex(params[2], extranonce2) || (int)extranonce2.size() != client->session.extranonce2_len) {
+        stats.invalid_extranonce++;
+        reply(client, id, NULL, 20, "Invalid extranonce2 size");
+        printf("share job %x: extranonce2 \"%s\" is not %d bytes\n", job_id, params[2].c_str(),
+               client->session.extranonce2_len);
+        return;
+    }
+
+    if (ntime < job->ntime || ntime > (uint32_t)time(NULL) + NTIME_MAX_AHEAD) {
+        stats.invalid_ntime++;
+        reply(client, id, NULL, 20, "Time out of range");
+        printf("share job %x: ntime %08x out of range\n", job_id, ntime);
+        return;
+    }
+
+    std::string key = to_hex(client->session.extranonce1, client->session.extranonce1_len) + ":" +
+                      params[2] + ":" + params[3] + ":" + params[4];
+    if (!job->submitted.insert(key).second) {
+        stats.duplicate++;
+        reply(client, id, NULL, 22, "Duplicate share");
+        printf("share job %x nonce %08x: duplicate\n", job_id, nonce);
+        return;
+    }
+
+    // coinbase = coinbase1 + extranonce1 + extranonce2 + coinbase2
+    std::string cb1, cb2;
+    coinbase_parts(job, client->session.extranonce1_len + client->session.extranonce2_len, cb1, cb2);
+    std::vector<uint8_t> coinbase, part;
+    from_hex(cb1, coinbase);
+    coinbase.insert(coinbase.end(), client->session.extranonce1,
+                    client->session.extranonce1 + client->session.extranonce1_len);
+    coinbase.insert(coinbase.end(), extranonce2.begin(), extranonce2.end());
+    from_hex(cb2, part);
+    coinbase.insert(coinbase.end(), part.begin(), part.end());
+
+    uint8_t root[32];
+    sha256d(coinbase.data(), coinbase.size(), root);
+    for (size_t i = 0; i < job->branches.size(); i++) {
+        uint8_t concat[64];
+        memcpy(concat, root, 32);
+        memcpy(concat + 32, job->branches[i].data(), 32);
+        sha256d(concat, 64, root);
+    }
+
+    uint8_t header[80];
+    put_u32(header, job->version);
+    memcpy(header + 4, job->prev_hash, 32);
+    memcpy(header + 36, root, 32);
+    put_u32(header + 68, ntime);
+    put_u32(header + 72, config.nbits);
+    put_u32(header + 76, nonce);
+
+    uint8_t hash[32];
+    sha256d(header, 80, hash);
+    double share_difficulty = hash_difficulty(hash);
+
+    // shares found before a difficulty change arrived are still worth the old one
+    double required = client->difficulty;
+    uint64_t sent = client->notify_job[job_id % MAX_JOBS] == job_id ? client->notify_us[job_id % MAX_JOBS] : 0;
+    if (sent != 0 && sent < client->diff_changed_us && client->prev_difficulty < required) {
+        required = client->prev_difficulty;
+    }
+
+    // difficulty from a double target rounds a little, don't reject on the last bit
+    if (share_difficulty < required * (1.0 - 1e-9)) {
+        stats.low_difficulty++;
+        reply(client, id, NULL, 23, "Low difficulty share");
+        printf("share job %x nonce %08x: low difficulty %.6g < %.6g\n", job_id, nonce, share_difficulty, required);
+        return;
+    }
+
+    stats.accepted++;
+    stats.accepted_difficulty += required;
+    if (sent != 0) {
+        stats.submit_latency_ms.push_back((now - sent) / 1000);
+    }
+    reply(client, id, "true", 0, NULL);
+
+    bool block = meets_nbits(hash, config.nbits);
+    if (block) {
+        stats.blocks++;
+    }
+    printf("share job %x nonce %08x: accepted, difficulty %.6g%s\n", job_id, nonce, share_difficulty,
+           block ? " - block!" : "");
+}
+
+static void handle_line(client_t* client, const std::string& line) {
+    std::string id, method, params;
+    if (!json_field(line, "id", id) || !json_field(line, "method", method) || !json_field(line, "params", params) ||
+        method.size() < 2 || params.empty() || params[0] != '[') {
+        stats.bad_requests++;
+        printf("bad request: %.120s\n", line.c_str());
+        return;
+    }
+    method = method.substr(1, method.size() - 2);
+    std::vector<std::string> items = json_strings(params);
+
+    if (method == "mining.subscribe") {
+        handle_subscribe(client, id, items);
+    } else if (method == "mining.authorize") {
+        handle_authorize(client, id, items);
+    } else if (method == "mining.submit") {
+        handle_submit(client, id, items);
+    } else {
+        reply(client, id, NULL, 20, "Method not supported");
+    }
+}
+
+// ---- connections ----
+
+static void close_client(int index, const char* why) {
+    client_t* client = clients[index];
+    printf("miner %d disconnected (%s)\n", index, why);
+    close(client->fd);
+    delete client;
+    clients[index] = NULL;
+}
+
+static void accept_client(int server) {
+    int fd = accept(server, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < MAX_CLIENTS && slot < 0; i++) {
+        if (clients[i] == NULL) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        close(fd);
+        return;
+    }
+
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    client_t* client = new client_t();
+    client->fd = fd;
+    client->difficulty = config.difficulty;
+    client->prev_difficulty = config.difficulty;
+    client->connected_us = now_us();
+    if (config.drop_every > 0) {
+        // +-25% so several miners don't reconnect in lockstep
+        double seconds = config.drop_every * (0.75 + 0.5 * random_unit());
+        client->drop_at_us = client->connected_us + (uint64_t)(seconds * 1e6);
+    }
+    clients[slot] = client;
+    stats.connections++;
+    printf("miner %d connected\n", slot);
+}
+
+// false if the connection closed
+static bool read_client(client_t* client) {
+    char buf[2048];
+    for (;;) {
+        ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        client->recv.append(buf, n);
+        size_t newline;
+        while ((newline = client->recv.find('\n')) != std::string::npos) {
+            std::string line = client->recv.substr(0, newline);
+            client->recv.erase(0, newline + 1);
+            if (!line.empty()) {
+                handle_line(client, line);
+            }
+        }
+        if (client->recv.size() > MAX_LINE) {
+            stats.bad_requests++;
+            client->recv.clear();
+        }
+    }
+}
+
+static void drop_all(const char* why) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] != NULL) {
+            close_client(i, why);
+        }
+    }
+}
+
+// ---- script ----
+
+struct event_t {
+    double at;                          // seconds since start
+    std::string name;
+    double value;
+};
+
+static std::vector<event_t> events;
+static size_t next_event = 0;
+
+static bool load_script(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    int number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        char name[32];
+        event_t event;
+        event.value = 0;
+        int fields = sscanf(line, "%lf %31s %lf", &event.at, name, &event.value);
+        if (fields <= 0 || line[strspn(line, " \t")] == '#') {
+            continue;
+        }
+        if (fields < 2) {
+            fprintf(stderr, "%s:%d: expected \"<seconds> <event> [value]\"\n", path, number);
+            fclose(file);
+            return false;
+        }
+        event.name = name;
+        events.push_back(event);
+    }
+    fclose(file);
+
+    std::stable_sort(events.begin(), events.end(), [](const event_t& a, const event_t& b) { return a.at < b.at; });
+    return true;
+}
+
+static void run_event(const event_t& event) {
+    printf("script %.1fs: %s\n", event.at, event.name.c_str());
+    if (event.name == "job") {
+        broadcast_job(false);
+    } else if (event.name == "block") {
+        broadcast_job(true);
+    } else if (event.name == "diff") {
+        broadcast_difficulty(event.value);
+    } else if (event.name == "latency") {
+        config.latency_ms = (int)event.value;
+    } else if (event.name == "jitter") {
+        config.jitter_ms = (int)event.value;
+    } else if (event.name == "drop") {
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            stats.drops += clients[i] != NULL;
+        }
+        drop_all("script");
+    } else if (event.name == "malformed") {
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i] != NULL) {
+                send_malformed(clients[i]);
+            }
+        }
+    } else if (event.name == "quit") {
+        stop_requested = 1;
+    } else {
+        printf("script: unknown event %s\n", event.name.c_str());
+    }
+}
+
+// ---- reports ----
+
+static void print_report() {
+    double seconds = (now_us() - start_us) / 1e6;
+    printf("[%.0fs] accepted %u  stale %u  duplicate %u  invalid %u  blocks %u  ~%.2f MH/s credited\n",
+           seconds, stats.accepted, stats.stale, stats.duplicate, invalid_count(), stats.blocks,
+           seconds > 0 ? stats.accepted_difficulty * 4294967296.0 / seconds / 1e6 : 0.0);
+}
+
+static void print_summary() {
+    double seconds = (now_us() - start_us) / 1e6;
+    printf("\n---- summary after %.1f s ----\n", seconds);
+    printf("connections %u (resumed %u, dropped %u), jobs %u, malformed lines sent %u, bad requests %u\n",
+           stats.connections, stats.resumed, stats.drops, stats.jobs, stats.malformed_sent, stats.bad_requests);
+    printf("accepted  %u (difficulty %.6g, ~%.2f MH/s credited)\n", stats.accepted, stats.accepted_difficulty,
+           seconds > 0 ? stats.accepted_difficulty * 4294967296.0 / seconds / 1e6 : 0.0);
+    printf("stale     %u\n", stats.stale);
+    printf("duplicate %u\n", stats.duplicate);
+    printf("invalid   %u (unknown job %u, extranonce2 %u, ntime %u, low difficulty %u)\n", invalid_count(),
+           stats.invalid_job, stats.invalid_extranonce, stats.invalid_ntime, stats.low_difficulty);
+    printf("blocks    %u\n", stats.blocks);
+    printf("submit latency ms (notify -> submit): p50 %u  p90 %u  p99 %u  max %u  (%zu shares)\n",
+           percentile(stats.submit_latency_ms, 0.50), percentile(stats.submit_latency_ms, 0.90),
+           percentile(stats.submit_latency_ms, 0.99), percentile(stats.submit_latency_ms, 1.0),
+           stats.submit_latency_ms.size());
+    printf("stale latency ms (clean notify -> stale submit): p50 %u  p99 %u  max %u\n",
+           percentile(stats.stale_latency_ms, 0.50), percentile(stats.stale_latency_ms, 0.99),
+           percentile(stats.stale_latency_ms, 1.0));
+}
+
+// ---- main ----
+
+static void print_usage(const char* program) {
+    printf("usage: %s [options]\n", program);
+    printf("  --port <n>             listen port (%d)\n", DEFAULT_PORT);
+    printf("  --diff <d>             share difficulty (%g)\n", DEFAULT_DIFFICULTY);
+    printf("  --diffs <a,b,..>       difficulties picked at random every --diff-interval seconds\n");
+    printf("  --diff-interval <s>    0 keeps the difficulty\n");
+    printf("  --job-interval <ms>    time between jobs (%d)\n", DEFAULT_JOB_INTERVAL_MS);
+    printf("  --clean-every <n>      every nth job is a new block with clean_jobs (%d)\n", DEFAULT_CLEAN_EVERY);
+    printf("  --clean-rate <p>       chance any other job is a new block too\n");
+    printf("  --en1-sizes <a,b,..>   extranonce1 sizes, one picked per session (4)\n");
+    printf("  --en2-sizes <a,b,..>   extranonce2 sizes, one picked per session (4)\n");
+    printf("  --max-branches <n>     merkle branches per block, 0..n (%d)\n", DEFAULT_MAX_BRANCHES);
+    printf("  --witness              add a witness commitment output to the coinbase\n");
+    printf("  --nbits <hex>          network bits (%08x), 207fffff finds blocks\n", DEFAULT_NBITS);
+    printf("  --latency <ms>         delay every line sent\n");
+    printf("  --jitter <ms>          extra random delay, order is kept\n");
+    printf("  --drop-every <s>       close each connection after about s seconds\n");
+    printf("  --malformed-rate <p>   chance of a malformed line before each notify\n");
+    printf("  --no-resume            ignore subscription ids on reconnect\n");
+    printf("  --script <file>        timed events: job, block, diff, latency, jitter, drop, malformed, quit\n");
+    printf("  --duration <s>         stop after s seconds\n");
+    printf("  --report <s>           stats line every s seconds (%d)\n", DEFAULT_REPORT_SECONDS);
+    printf("  --strict               exit status 1 if any share was invalid\n");
+    printf("  --seed <n>             random seed\n");
+}
+
+template <typename T>
+static std::vector<T> parse_list(const char* text) {
+    std::vector<T> values;
+    const char* p = text;
+    while (*p != '\0') {
+        char* end;
+        double v = strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+        values.push_back((T)v);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+static bool parse_args(int argc, char** argv) {
+    config.port = DEFAULT_PORT;
+    config.difficulty = DEFAULT_DIFFICULTY;
+    config.diff_interval = 0;
+    config.job_interval_ms = DEFAULT_JOB_INTERVAL_MS;
+    config.clean_every = DEFAULT_CLEAN_EVERY;
+    config.clean_rate = 0;
+    config.en1_sizes.assign(1, 4);
+    config.en2_sizes.assign(1, 4);
+    config.max_branches = DEFAULT_MAX_BRANCHES;
+    config.witness = false;
+    config.nbits = DEFAULT_NBITS;
+    config.latency_ms = 0;
+    config.jitter_ms = 0;
+    config.drop_every = 0;
+    config.malformed_rate = 0;
+    config.resume = true;
+    config.script = NULL;
+    config.duration = 0;
+    config.report_seconds = DEFAULT_REPORT_SECONDS;
+    config.strict = false;
+    config.seed = (unsigned)time(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool used = value != NULL;
+
+        if (strcmp(arg, "--witness") == 0) {
+            config.witness = true;
+            used = false;
+        } else if (strcmp(arg, "--no-resume") == 0) {
+            config.resume = false;
+            used = false;
+        } else if (strcmp(arg, "--strict") == 0) {
+            config.strict = true;
+            used = false;
+        } else if (value == NULL) {
+            return false;
+        } else if (strcmp(arg, "--port") == 0) {
+            config.port = atoi(value);
+        } else if (strcmp(arg, "--diff") == 0) {
+            config.difficulty = atof(value);
+        } else if (strcmp(arg, "--diffs") == 0) {
+            config.difficulties = parse_list<double>(value);
+        } else if (strcmp(arg, "--diff-interval") == 0) {
+            config.diff_interval = atoi(value);
+        } else if (strcmp(arg, "--job-interval") == 0) {
+            config.job_interval_ms = atoi(value);
+        } else if (strcmp(arg, "--clean-every") == 0) {
+            config.clean_every = atoi(value);
+        } else if (strcmp(arg, "--clean-rate") == 0) {
+            config.clean_rate = atof(value);
+        } else if (strcmp(arg, "--en1-sizes") == 0) {
+            config.en1_sizes = parse_list<int>(value);
+        } else if (strcmp(arg, "--en2-sizes") == 0) {
+            config.en2_sizes = parse_list<int>(value);
+        } else if (strcmp(arg, "--max-branches") == 0) {
+            config.max_branches = atoi(value);
+        } else if (strcmp(arg, "--nbits") == 0) {
+            config.nbits = strtoul(value, NULL, 16);
+        } else if (strcmp(arg, "--latency") == 0) {
+            config.latency_ms = atoi(value);
+        } else if (strcmp(arg, "--jitter") == 0) {
+            config.jitter_ms = atoi(value);
+        } else if (strcmp(arg, "--drop-every") == 0) {
+            config.drop_every = atoi(value);
+        } else if (strcmp(arg, "--malformed-rate") == 0) {
+            config.malformed_rate = atof(value);
+        } else if (strcmp(arg, "--script") == 0) {
+            config.script = value;
+        } else if (strcmp(arg, "--duration") == 0) {
+            config.duration = atoi(value);
+        } else if (strcmp(arg, "--report") == 0) {
+            config.report_seconds = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoul(value, NULL, 10);
+        } else {
+            return false;
+        }
+        if (used) {
+            i++;
+        }
+    }
+
+    // extranonce1 is kept in 8 bytes, extranonce2 goes up to 8 like real pools
+    for (size_t i = 0; i < config.en1_sizes.size(); i++) {
+        if (config.en1_sizes[i] < 1 || config.en1_sizes[i] > 8) return false;
+    }
+    for (size_t i = 0; i < config.en2_sizes.size(); i++) {
+        if (config.en2_sizes[i] < 1 || config.en2_sizes[i] > 8) return false;
+    }
+    return !config.en1_sizes.empty() && !config.en2_sizes.empty() && config.job_interval_ms > 0;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (config.script != NULL && !load_script(config.script)) {
+        return 2;
+    }
+
+    srand(config.seed);
+    random_bytes(payout_hash, 20);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(config.port);
+
+    if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 8) < 0) {
+        perror("listen");
+        return 1;
+    }
+    printf("stratum pool sim on port %d, difficulty %.10g, job every %d ms, seed %u\n",
+           config.port, config.difficulty, config.job_interval_ms, config.seed);
+
+    start_us = now_us();
+    broadcast_job(true);
+    uint64_t next_job_us = start_us + (uint64_t)config.job_interval_ms * 1000;
+    uint64_t next_diff_us = start_us + (uint64_t)config.diff_interval * 1000000;
+    uint64_t next_report_us = start_us + (uint64_t)config.report_seconds * 1000000;
+    uint32_t jobs_in_block = 1;
+
+    while (!stop_requested) {
+        uint64_t now = now_us();
+
+        if (config.duration > 0 && now - start_us >= (uint64_t)config.duration * 1000000) {
+            break;
+        }
+        while (next_event < events.size() && now - start_us >= (uint64_t)(events[next_event].at * 1e6)) {
+            run_event(events[next_event++]);
+        }
+
+        if (now >= next_job_us) {
+            bool clean = (config.clean_every > 0 && jobs_in_block >= (uint32_t)config.clean_every) ||
+                         random_unit() < config.clean_rate;
+            broadcast_job(clean);
+            jobs_in_block = clean ? 1 : jobs_in_block + 1;
+            next_job_us = now + (uint64_t)config.job_interval_ms * 1000;
+        }
+        if (config.diff_interval > 0 && !config.difficulties.empty() && now >= next_diff_us) {
+            broadcast_difficulty(config.difficulties[rand() % config.difficulties.size()]);
+            next_diff_us = now + (uint64_t)config.diff_interval * 1000000;
+        }
+        if (config.report_seconds > 0 && now >= next_report_us) {
+            print_report();
+            next_report_us = now + (uint64_t)config.report_seconds * 1000000;
+        }
+
+        // write due lines, drop connections that are due
+        uint64_t wake = std::min(next_job_us, now + 100000);
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            client_t* client = clients[i];
+            if (client == NULL) {
+                continue;
+            }
+            if (client->drop_at_us != 0 && now >= client->drop_at_us) {
+                stats.drops++;
+                close_client(i, "drop-every");
+                continue;
+            }
+            if (!flush_client(client, now)) {
+                close_client(i, "send failed");
+                continue;
+            }
+            if (!client->out.empty()) {
+                wake = std::min(wake, client->out.front().due_us);
+            }
+        }
+
+        struct pollfd fds[MAX_CLIENTS + 1];
+        int index[MAX_CLIENTS + 1];
+        int count = 0;
+        fds[count].fd = server;
+        fds[count].events = POLLIN;
+        index[count++] = -1;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i] != NULL) {
+                fds[count].fd = clients[i]->fd;
+                fds[count].events = POLLIN;
+                index[count++] = i;
+            }
+        }
+
+        int timeout_ms = wake > now ? (int)((wake - now + 999) / 1000) : 0;
+        if (poll(fds, count, timeout_ms) <= 0) {
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                continue;
+            }
+            if (index[i] < 0) {
+                accept_client(server);
+            } else if (!read_client(clients[index[i]])) {
+                close_client(index[i], "closed by miner");
+            }
+        }
+    }
+
+    drop_all("shutdown");
+    print_summary();
+    return config.strict && invalid_count() > 0 ? 1 : 0;
+}
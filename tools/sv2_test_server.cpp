@@ -0,0 +1,397 @@
+// sv2_test_server.cpp
+// minimal stratum v2 mining server for testing Sv2Client on a lan
+//
+// speaks the unencrypted mining protocol on a standard channel: answers
+// SetupConnection and OpenStandardMiningChannel, hands out header-only jobs
+// and checks every SubmitSharesStandard against the channel target
+//
+// build and run on any posix host:
+//   g++ -O2 -o sv2_test_server tools/sv2_test_server.cpp
+//   ./sv2_test_server [port] [target_zero_bits]
+// then point the miner's pool address at "sv2://<host ip>:<port>"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define DEFAULT_PORT 34255
+#define DEFAULT_TARGET_ZERO_BITS 22     // ~1 share per 4M hashes
+#define NEW_BLOCK_INTERVAL 60           // seconds between SetNewPrevHash
+#define NEW_JOB_INTERVAL 20             // seconds between non-future jobs on the same tip
+#define MAX_JOBS 4
+
+// message types (mining protocol)
+#define MSG_SETUP_CONNECTION 0x00
+#define MSG_SETUP_CONNECTION_SUCCESS 0x01
+#define MSG_OPEN_STANDARD_CHANNEL 0x10
+#define MSG_OPEN_STANDARD_CHANNEL_SUCCESS 0x11
+#define MSG_NEW_MINING_JOB 0x15
+#define MSG_SUBMIT_SHARES_STANDARD 0x1a
+#define MSG_SUBMIT_SHARES_SUCCESS 0x1c
+#define MSG_SUBMIT_SHARES_ERROR 0x1d
+#define MSG_SET_NEW_PREV_HASH 0x20
+#define CHANNEL_MSG_BIT 0x8000
+
+// ---- sha256 (fips 180-4), just enough to verify submitted headers ----
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void sha256_block(uint32_t* h, const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+static void sha256(const uint8_t* data, size_t len, uint8_t* out) {
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t block[64];
+    size_t pos = 0;
+
+    for (; pos + 64 <= len; pos += 64) {
+        sha256_block(h, data + pos);
+    }
+
+    size_t rest = len - pos;
+    memset(block, 0, 64);
+    memcpy(block, data + pos, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) {
+        sha256_block(h, block);
+        memset(block, 0, 64);
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        block[63 - i] = (bits >> (8 * i)) & 0xFF;
+    }
+    sha256_block(h, block);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = h[i] >> 24;
+        out[i * 4 + 1] = h[i] >> 16;
+        out[i * 4 + 2] = h[i] >> 8;
+        out[i * 4 + 3] = h[i];
+    }
+}
+
+static void sha256d(const uint8_t* data, size_t len, uint8_t* out) {
+    uint8_t first[32];
+    sha256(data, len, first);
+    sha256(first, 32, out);
+}
+
+// ---- little-endian fields ----
+
+static void put_u16(uint8_t* out, uint16_t v) { out[0] = v; out[1] = v >> 8; }
+static void put_u32(uint8_t* out, uint32_t v) { for (int i = 0; i < 4; i++) out[i] = v >> (8 * i); }
+static uint32_t get_u32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// ---- server state ----
+
+struct job_t {
+    uint32_t job_id;
+    uint32_t version;
+    uint8_t merkle_root[32];
+    bool valid;
+};
+
+static const uint32_t CHANNEL_ID = 1;
+static const uint32_t NBITS = 0x1d00ffff;
+
+static uint8_t target[32];
+static uint8_t prev_hash[32];
+static uint32_t tip_ntime;
+static job_t jobs[MAX_JOBS];
+static uint32_t next_job_id = 1;
+static uint32_t accepted = 0;
+static uint32_t rejected = 0;
+
+static bool send_frame(int fd, uint16_t extension_type, uint8_t msg_type, const uint8_t* payload, uint32_t len) {
+    uint8_t frame[6 + 256];
+    put_u16(frame, extension_type);
+    frame[2] = msg_type;
+    frame[3] = len;
+    frame[4] = len >> 8;
+    frame[5] = len >> 16;
+    memcpy(frame + 6, payload, len);
+    return send(fd, frame, 6 + len, 0) == (ssize_t)(6 + len);
+}
+
+static bool read_exact(int fd, uint8_t* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, len - got, 0);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+static void random_bytes(uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = rand() & 0xFF;
+    }
+}
+
+// NewMiningJob - future jobs wait for SetNewPrevHash, others apply right away
+static void send_new_job(int fd, bool future) {
+    job_t* job = &jobs[next_job_id % MAX_JOBS];
+    job->job_id = next_job_id++;
+    job->version = 0x20000000;
+    random_bytes(job->merkle_root, 32);
+    job->valid = true;
+
+    uint8_t p[64];
+    size_t pos = 0;
+    put_u32(p + pos, CHANNEL_ID); pos += 4;
+    put_u32(p + pos, job->job_id); pos += 4;
+    if (future) {
+        p[pos++] = 0;                   // min_ntime: none
+    } else {
+        p[pos++] = 1;
+        put_u32(p + pos, tip_ntime); pos += 4;
+    }
+    put_u32(p + pos, job->version); pos += 4;
+    memcpy(p + pos, job->merkle_root, 32); pos += 32;
+
+    send_frame(fd, CHANNEL_MSG_BIT, MSG_NEW_MINING_JOB, p, pos);
+    printf("job %u (%s)\n", job->job_id, future ? "future" : "active");
+}
+
+// new tip: future job followed by SetNewPrevHash naming it
+static void send_new_block(int fd) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        jobs[i].valid = false;
+    }
+
+    uint32_t job_id = next_job_id;
+    send_new_job(fd, true);
+
+    random_bytes(prev_hash, 32);
+    tip_ntime = (uint32_t)time(NULL);
+
+    uint8_t p[48];
+    put_u32(p, CHANNEL_ID);
+    put_u32(p + 4, job_id);
+    memcpy(p + 8, prev_hash, 32);
+    put_u32(p + 40, tip_ntime);
+    put_u32(p + 44, NBITS);
+    send_frame(fd, CHANNEL_MSG_BIT, MSG_SET_NEW_PREV_HASH, p, sizeof(p));
+    printf("new prev hash, job %u\n", job_id);
+}
+
+// hash <= target, both little-endian
+static bool meets_target(const uint8_t* hash) {
+    for (int i = 31; i >= 0; i--) {
+        if (hash[i] != target[i]) {
+            return hash[i] < target[i];
+        }
+    }
+    return true;
+}
+
+static void handle_submit(int fd, const uint8_t* p, uint32_t len) {
+    if (len < 24) {
+        return;
+    }
+
+    uint32_t sequence = get_u32(p + 4);
+    uint32_t job_id = get_u32(p + 8);
+    uint32_t nonce = get_u32(p + 12);
+    uint32_t ntime = get_u32(p + 16);
+    uint32_t version = get_u32(p + 20);
+
+    const job_t* job = &jobs[job_id % MAX_JOBS];
+    const char* error = NULL;
+
+    if (!job->valid || job->job_id != job_id) {
+        error = "invalid-job-id";
+    } else {
+        uint8_t header[80];
+        put_u32(header, version);
+        memcpy(header + 4, prev_hash, 32);
+        memcpy(header + 36, job->merkle_root, 32);
+        put_u32(header + 68, ntime);
+        put_u32(header + 72, NBITS);
+        put_u32(header + 76, nonce);
+
+        uint8_t hash[32];
+        sha256d(header, 80, hash);
+        if (!meets_target(hash)) {
+            error = "difficulty-too-low";
+        }
+    }
+
+    uint8_t r[64];
+    if (error == NULL) {
+        accepted++;
+        put_u32(r, CHANNEL_ID);
+        put_u32(r + 4, sequence);
+        put_u32(r + 8, 1);
+        memset(r + 12, 0, 8);
+        r[12] = 1;                      // new_shares_sum u64
+        send_frame(fd, CHANNEL_MSG_BIT, MSG_SUBMIT_SHARES_SUCCESS, r, 20);
+    } else {
+        rejected++;
+        size_t error_len = strlen(error);
+        put_u32(r, CHANNEL_ID);
+        put_u32(r + 4, sequence);
+        r[8] = error_len;
+        memcpy(r + 9, error, error_len);
+        send_frame(fd, CHANNEL_MSG_BIT, MSG_SUBMIT_SHARES_ERROR, r, 9 + error_len);
+    }
+
+    printf("share seq %u job %u nonce %08x: %s (accepted %u, rejected %u)\n",
+           sequence, job_id, nonce, error ? error : "ok", accepted, rejected);
+}
+
+static void serve(int fd) {
+    time_t last_block = 0;
+    time_t last_job = 0;
+    bool channel_open = false;
+
+    for (;;) {
+        time_t now = time(NULL);
+        if (channel_open && now - last_block >= NEW_BLOCK_INTERVAL) {
+            send_new_block(fd);
+            last_block = now;
+            last_job = now;
+        } else if (channel_open && now - last_job >= NEW_JOB_INTERVAL) {
+            send_new_job(fd, false);
+            last_job = now;
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 1000) <= 0) {
+            continue;
+        }
+
+        uint8_t header[6];
+        if (!read_exact(fd, header, 6)) {
+            return;
+        }
+        uint32_t len = header[3] | (header[4] << 8) | ((uint32_t)header[5] << 16);
+        if (len > 4096) {
+            return;
+        }
+        uint8_t payload[4096];
+        if (!read_exact(fd, payload, len)) {
+            return;
+        }
+
+        uint8_t r[64];
+        switch (header[2]) {
+            case MSG_SETUP_CONNECTION:
+                put_u16(r, 2);          // used_version
+                put_u32(r + 2, 0);      // flags
+                send_frame(fd, 0, MSG_SETUP_CONNECTION_SUCCESS, r, 6);
+                printf("setup connection\n");
+                break;
+
+            case MSG_OPEN_STANDARD_CHANNEL: {
+                // request_id u32 | user_identity str0_255 | ...
+                uint8_t user_len = payload[4];
+                printf("open channel for %.*s\n", user_len, (const char*)payload + 5);
+
+                memcpy(r, payload, 4);
+                put_u32(r + 4, CHANNEL_ID);
+                memcpy(r + 8, target, 32);
+                r[40] = 0;              // extranonce_prefix b0_32, empty
+                put_u32(r + 41, 0);     // group_channel_id
+                send_frame(fd, 0, MSG_OPEN_STANDARD_CHANNEL_SUCCESS, r, 45);
+
+                channel_open = true;
+                last_block = 0;
+                break;
+            }
+
+            case MSG_SUBMIT_SHARES_STANDARD:
+                handle_submit(fd, payload, len);
+                break;
+
+            default:
+                printf("ignored message 0x%02x\n", header[2]);
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : DEFAULT_PORT;
+    int zero_bits = argc > 2 ? atoi(argv[2]) : DEFAULT_TARGET_ZERO_BITS;
+    srand(time(NULL));
+
+    // target = 2^(256 - zero_bits) - 1, little-endian
+    memset(target, 0xFF, 32);
+    for (int bit = 255; bit >= 256 - zero_bits; bit--) {
+        target[bit / 8] &= ~(1 << (bit % 8));
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 1) < 0) {
+        perror("listen");
+        return 1;
+    }
+    printf("sv2 test server on port %d, target %d zero bits\n", port, zero_bits);
+
+    for (;;) {
+        int fd = accept(server, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        printf("miner connected\n");
+
+        memset(jobs, 0, sizeof(jobs));
+        serve(fd);
+
+        close(fd);
+        printf("miner disconnected\n");
+    }
+}
@@ -0,0 +1,248 @@
+// telemetry_decode.cpp
+// host-side decoder for the miner's binary telemetry frames
+//
+// reads a serial port (or stdin, or a saved log), splits the stream at 0x00,
+// checks each chunk's cobs framing and crc and prints one line per stats
+// frame, as text or as json lines for a dashboard scraper. the text log the
+// miner prints on the same port is dropped, or passed through with --text.
+// frame layout and codec are include/mining/telemetry_frame.h, the same
+// header the firmware builds with
+//
+// turn the frames on with MiningManager::set_telemetry_enabled(true) on the
+// device, or --telemetry on for the native daemon
+//
+// build and run on any posix host:
+//   g++ -O2 -Iinclude -o telemetry_decode tools/telemetry_decode.cpp
+//   ./telemetry_decode /dev/ttyACM0 [--baud 115200] [--json] [--text]
+//   esp32btcminer --telemetry on | ./telemetry_decode - --json
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "mining/telemetry_frame.h"
+
+#define CHUNK_MAX 2048                  // longer runs without a zero are text, cut
+
+static const char* const STATE_NAMES[] = { "stopped", "connecting", "mining", "paused", "error" };
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int) {
+    stop_requested = 1;
+}
+
+struct decoder_t {
+    bool json;
+    bool text;
+    bool have_sequence;
+    uint32_t next_sequence;
+    uint64_t frames;
+    uint64_t lost;                      // sequence gaps
+    uint64_t bad;                       // chunks that looked binary but failed cobs or crc
+};
+
+static speed_t baud_constant(long baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B115200;
+    }
+}
+
+// raw 8n1, usb cdc ignores the rate but real uarts don't
+static bool configure_tty(int fd, long baud) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, baud_constant(baud));
+    cfsetospeed(&tio, baud_constant(baud));
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static void print_frame(decoder_t* decoder, const telemetry_stats_frame_t* f) {
+    const char* state = f->state < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]) ? STATE_NAMES[f->state] : "?";
+    bool has_temperature = f->temperature_centi != TELEMETRY_NO_TEMPERATURE;
+
+    if (decoder->json) {
+        printf("{\"device\":%u,\"seq\":%u,\"millis\":%u,\"state\":\"%s\",\"pool_connected\":%s,"
+               "\"hashrate_suspect\":%s,\"kernel_suspect\":%s,\"workers\":%u,\"uptime_s\":%u,"
+               "\"hashrate_1m\":%.1f,\"hashrate_5m\":%.1f,\"hashrate_15m\":%.1f,\"hashrate_effective\":%.1f,"
+               "\"shares_found\":%u,\"shares_accepted\":%u,\"shares_rejected\":%u,"
+               "\"shares_dropped\":%u,\"shares_replayed\":%u,\"pool_difficulty\":%g,\"best_difficulty\":%g,"
+               "\"pool_latency_ms\":%u,\"job_switch_us\":%u,",
+               f->device_id, f->sequence, f->millis, state,
+               (f->flags & TELEMETRY_FLAG_POOL_CONNECTED) ? "true" : "false",
+               (f->flags & TELEMETRY_FLAG_HASHRATE_SUSPECT) ? "true" : "false",
+               (f->flags & TELEMETRY_FLAG_KERNEL_SUSPECT) ? "true" : "false",
+               f->workers, f->uptime_seconds,
+               f->hashrate_1m, f->hashrate_5m, f->hashrate_15m, f->hashrate_effective,
+               f->shares_found, f->shares_accepted, f->shares_rejected,
+               f->shares_dropped, f->shares_replayed, f->pool_difficulty, f->best_difficulty,
+               f->pool_latency_ms, f->job_switch_us);
+        if (has_temperature) {
+            printf("\"temperature_c\":%.2f,", f->temperature_centi / 100.0);
+        } else {
+            printf("\"temperature_c\":null,");
+        }
+        printf("\"heap_free\":%u,\"heap_min_free\":%u,\"psram_free\":%u}\n",
+               f->heap_free, f->heap_min_free, f->psram_free);
+    } else {
+        char temperature[16];
+        if (has_temperature) {
+            snprintf(temperature, sizeof(temperature), "%.1fC", f->temperature_centi / 100.0);
+        } else {
+            strcpy(temperature, "-");
+        }
+        printf("%04x #%-6u %-10s %s %9.1f kh/s (5m %9.1f, 15m %9.1f, pool %9.1f)  shares %u/%u/%u "
+               "drop %u  diff %g  rtt %u ms  switch %u us  %s  heap %u (min %u)\n",
+               f->device_id, f->sequence, state,
+               (f->flags & TELEMETRY_FLAG_POOL_CONNECTED) ? "up  " : "down",
+               f->hashrate_1m / 1000.0, f->hashrate_5m / 1000.0, f->hashrate_15m / 1000.0,
+               f->hashrate_effective / 1000.0,
+               f->shares_accepted, f->shares_rejected, f->shares_found, f->shares_dropped,
+               f->pool_difficulty, f->pool_latency_ms, f->job_switch_us, temperature,
+               f->heap_free, f->heap_min_free);
+    }
+    fflush(stdout);
+}
+
+// text log lines carry no zeros and are plain ascii, a frame always has a
+// byte outside that range - its crc or a small count field
+static bool looks_like_text(const uint8_t* chunk, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = chunk[i];
+        if (c >= 0x7F || (c < 0x20 && c != '\r' && c != '\n' && c != '\t')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void handle_chunk(decoder_t* decoder, const uint8_t* chunk, size_t len) {
+    if (len == 0) {
+        return;
+    }
+
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+    size_t n = telemetry_decode(chunk, len, payload, sizeof(payload));
+    if (n == 0) {
+        if (looks_like_text(chunk, len)) {
+            if (decoder->text) {
+                fwrite(chunk, 1, len, stderr);
+            }
+        } else {
+            decoder->bad++;
+        }
+        return;
+    }
+
+    // newer firmware appends fields, older decoders read the prefix they know
+    if (payload[0] != TELEMETRY_TYPE_STATS || n < sizeof(telemetry_stats_frame_t)) {
+        return;
+    }
+    telemetry_stats_frame_t frame;
+    memcpy(&frame, payload, sizeof(frame));
+
+    if (decoder->have_sequence && frame.sequence != decoder->next_sequence) {
+        // a reboot starts over at 0, only count forward gaps
+        if (frame.sequence > decoder->next_sequence) {
+            decoder->lost += frame.sequence - decoder->next_sequence;
+        }
+    }
+    decoder->have_sequence = true;
+    decoder->next_sequence = frame.sequence + 1;
+    decoder->frames++;
+
+    print_frame(decoder, &frame);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "usage: %s <serial port | file | -> [--baud <rate>] [--json] [--text]\n", program);
+    fprintf(stderr, "  --json prints one json object per frame\n");
+    fprintf(stderr, "  --text passes the device's text log through to stderr\n");
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    long baud = 115200;
+    decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            decoder.json = true;
+        } else if (strcmp(argv[i], "--text") == 0) {
+            decoder.text = true;
+        } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = atol(argv[++i]);
+        } else if (path == NULL && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    int fd = STDIN_FILENO;
+    if (strcmp(path, "-") != 0) {
+        fd = open(path, O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+            return 1;
+        }
+        if (isatty(fd) && !configure_tty(fd, baud)) {
+            fprintf(stderr, "cannot configure %s: %s\n", path, strerror(errno));
+            return 1;
+        }
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    static uint8_t chunk[CHUNK_MAX];
+    size_t chunk_len = 0;
+    uint8_t buffer[4096];
+
+    while (!stop_requested) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (buffer[i] == 0) {
+                handle_chunk(&decoder, chunk, chunk_len);
+                chunk_len = 0;
+            } else if (chunk_len < CHUNK_MAX) {
+                chunk[chunk_len++] = buffer[i];
+            }
+        }
+    }
+    handle_chunk(&decoder, chunk, chunk_len);
+
+    fprintf(stderr, "%llu frames, %llu lost, %llu bad\n", (unsigned long long)decoder.frames,
+            (unsigned long long)decoder.lost, (unsigned long long)decoder.bad);
+    return 0;
+}
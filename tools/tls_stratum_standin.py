@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+# tls_stratum_standin.py
+# local stratum+ssl pool stand-in for timing full vs resumed tls handshakes
+#
+# answers subscribe/authorize, hands out one job and accepts every share.
+# with --drop-after the connection is closed after that many seconds, so the
+# miner reconnects and offers its saved session. each handshake is timed here
+# and reported as full or resumed, the miner logs its own view as
+# "[tls] handshake <ms> ms (full|resumed, ...)"
+#
+# make a throwaway certificate once:
+#   openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+#       -keyout standin.key -out standin.crt -days 365 -subj /CN=standin
+# run it and set the pool address to "stratum+ssl://<host ip>:3334":
+#   python3 tools/tls_stratum_standin.py --cert standin.crt --key standin.key --drop-after 30
+
+import argparse
+import json
+import socket
+import ssl
+import statistics
+import time
+
+NOTIFY = {
+    "id": None,
+    "method": "mining.notify",
+    "params": [
+        "1",
+        "00" * 32,
+        "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff20",
+        "ffffffff0100f2052a010000001976a914000000000000000000000000000000000000000088ac00000000",
+        [],
+        "20000000",
+        "1d00ffff",
+        "%08x",
+        True,
+    ],
+}
+
+
+def serve_session(conn, drop_after, difficulty):
+    conn.settimeout(1.0)
+    start = time.monotonic()
+    buffer = b""
+
+    def send(message):
+        conn.sendall((json.dumps(message) + "\n").encode())
+
+    while drop_after <= 0 or time.monotonic() - start < drop_after:
+        try:
+            data = conn.recv(4096)
+        except socket.timeout:
+            continue
+        if not data:
+            return
+        buffer += data
+
+        while b"\n" in buffer:
+            line, buffer = buffer.split(b"\n", 1)
+            try:
+                request = json.loads(line)
+            except ValueError:
+                continue
+
+            method = request.get("method")
+            request_id = request.get("id")
+            if method == "mining.subscribe":
+                send({"id": request_id, "error": None,
+                      "result": [[["mining.notify", "standin"]], "00000001", 4]})
+            elif method == "mining.authorize":
+                send({"id": request_id, "error": None, "result": True})
+                send({"id": None, "method": "mining.set_difficulty", "params": [difficulty]})
+                notify = dict(NOTIFY)
+                notify["params"] = list(NOTIFY["params"])
+                notify["params"][7] = "%08x" % int(time.time())
+                send(notify)
+            elif method == "mining.submit":
+                send({"id": request_id, "error": None, "result": True})
+                print("  share", request["params"][4])
+            else:
+                send({"id": request_id, "error": None, "result": True})
+
+
+def main():
+    parser = argparse.ArgumentParser(description="stratum+ssl pool stand-in")
+    parser.add_argument("--port", type=int, default=3334)
+    parser.add_argument("--cert", required=True)
+    parser.add_argument("--key", required=True)
+    parser.add_argument("--drop-after", type=float, default=30.0,
+                        help="close each session after this many seconds (0 = never)")
+    parser.add_argument("--difficulty", type=float, default=0.001)
+    parser.add_argument("--no-tickets", action="store_true",
+                        help="disable session tickets, resumption then relies on the session cache")
+    args = parser.parse_args()
+
+    # tls 1.2 like the miner, resumption by ticket or by session id
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.minimum_version = ssl.TLSVersion.TLSv1_2
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(args.cert, args.key)
+    if args.no_tickets:
+        context.options |= ssl.OP_NO_TICKET
+
+    timings = {"full": [], "resumed": []}
+
+    with socket.create_server(("", args.port)) as server:
+        print("tls stratum stand-in on port %d" % args.port)
+        while True:
+            raw, address = server.accept()
+            raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+            # handshake timed from the first byte of the client hello
+            raw.settimeout(30.0)
+            raw.recv(1, socket.MSG_PEEK)
+            start = time.monotonic()
+            try:
+                conn = context.wrap_socket(raw, server_side=True)
+            except (ssl.SSLError, OSError) as error:
+                print("%s: handshake failed: %s" % (address[0], error))
+                raw.close()
+                continue
+            elapsed_ms = (time.monotonic() - start) * 1000
+
+            kind = "resumed" if conn.session_reused else "full"
+            timings[kind].append(elapsed_ms)
+            print("%s: %s handshake %.0f ms (%s)" % (address[0], kind, elapsed_ms, conn.cipher()[0]))
+            for name, values in timings.items():
+                if values:
+                    print("  %-7s n=%-3d median %.0f ms" % (name, len(values), statistics.median(values)))
+
+            try:
+                serve_session(conn, args.drop_after, args.difficulty)
+            except (ssl.SSLError, OSError):
+                pass
+            finally:
+                conn.close()
+            print("%s: session closed" % address[0])
+
+
+if __name__ == "__main__":
+    main()